@@ -7,90 +7,106 @@
  ============================================================================
  */
 
-#include <stdbool.h>
+#include <fcntl.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
-#include "shared.h"
+#include <unistd.h>
+#include "zkboo.h"
 
 
-void printbits(uint32_t n) {
-	if (n) {
-		printbits(n >> 1);
-		printf("%d", n & 1);
-	}
-
-}
-
 
-
-int main(void) {
+int main(int argc, char* argv[]) {
 	setbuf(stdout, NULL);
-	init_EVP();
-	openmp_thread_setup();
-	
-	printf("Iterations of SHA: %d\n", NUM_ROUNDS);
+	int minRounds = ZKBOO_DEFAULT_ROUNDS; //-r and -b
+	const char* path = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			minRounds = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			minRounds = zkboo_rounds_for_soundness(atoi(argv[++i]));
+		} else if (!path) {
+			path = argv[i];
+		} else {
+			minRounds = -1;
+		}
+		if (minRounds < 1 || minRounds > ZKBOO_MAX_ROUNDS) {
+			printf("Usage: %s [-r rounds | -b bits] [proof file]\n", argv[0]);
+			printf("  -r  the fewest rounds to accept, %d by default\n", ZKBOO_DEFAULT_ROUNDS);
+			printf("  -b  accept no more than a 2^-bits chance that a false proof verifies\n");
+			return EXIT_FAILURE;
+		}
+	}
 
-	clock_t begin = clock(), delta, deltaFiles;
+	clock_t begin = clock(), delta;
 	
-	a as[NUM_ROUNDS];
-	z zs[NUM_ROUNDS];
-	FILE *file;
-
+	//The proof is read in place through mmap
 	char outputFile[3*sizeof(int) + 8];
-	sprintf(outputFile, "out%i.bin", NUM_ROUNDS);
-	file = fopen(outputFile, "rb");
-	if (!file) {
-		printf("Unable to open file!");
+	sprintf(outputFile, "out%i.bin", minRounds);
+	if (!path) {
+		path = outputFile;
+	}
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		printf("Unable to open file!\n");
+		return EXIT_FAILURE;
+	}
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		printf("Unable to open file!\n");
+		return EXIT_FAILURE;
 	}
-	fread(&as, sizeof(a), NUM_ROUNDS, file);
-	fread(&zs, sizeof(z), NUM_ROUNDS, file);
-	fclose(file);
 
+	//verify all rounds in parallel, OMP_NUM_THREADS picks the thread count
+	zkboo_ctx* ctx = zkboo_ctx_new(NULL, 0);
+	if (!ctx) {
+		printf("Out of memory\n");
+		return EXIT_FAILURE;
+	}
+	zkboo_ctx_set_min_rounds(ctx, minRounds);
+	zkboo_result result;
+	zkboo_status status = zkboo_verify_sha1(ctx, data, st.st_size, &result);
+	if (status == ZKBOO_OTHER_CIRCUIT && result.circuit == ZKBOO_SHA256) {
+		printf("SHA-256 proof\n");
+		status = zkboo_verify_sha256(ctx, data, st.st_size, &result);
+	}
+	munmap(data, st.st_size);
+	zkboo_ctx_free(ctx);
+	if (status == ZKBOO_WRONG_ROUNDS) {
+		printf("The proof has %d rounds, expected %d to %d\n", result.rounds, minRounds, ZKBOO_MAX_ROUNDS);
+		return EXIT_FAILURE;
+	}
+	if (status == ZKBOO_BAD_PROOF) {
+		printf("Unrecognised proof file\n");
+		return EXIT_FAILURE;
+	}
+	if (status != ZKBOO_OK && status != ZKBOO_NOT_VERIFIED) {
+		printf("Unable to verify: %s\n", zkboo_status_string(status));
+		return EXIT_FAILURE;
+	}
 
-	uint32_t y[8];
-	reconstruct(as[0].yp[0],as[0].yp[1],as[0].yp[2],y);
+	printf("Iterations of SHA: %d (%.1f bits)\n", result.rounds, zkboo_soundness_bits(result.rounds));
 	printf("Proof for hash: ");
-	for(int i=0;i<8;i++) {
-		printf("%02X", y[i]);
+	for(int i=0;i<result.hashWords;i++) {
+		printf("%02X", result.hash[i]);
 	}
 	printf("\n");
-
-	deltaFiles = clock() - begin;
-	int inMilliFiles = deltaFiles * 1000 / CLOCKS_PER_SEC;
-	printf("Loading files: %ju\n", (uintmax_t)inMilliFiles);
-
-
-	clock_t beginE = clock(), deltaE;
-	int es[NUM_ROUNDS];
-	H3(y, as, NUM_ROUNDS, es);
-	deltaE = clock() - beginE;
-	int inMilliE = deltaE * 1000 / CLOCKS_PER_SEC;
-	printf("Generating E: %ju\n", (uintmax_t)inMilliE);
-
-
-	clock_t beginV = clock(), deltaV;
-	#pragma omp parallel for
-	for(int i = 0; i<NUM_ROUNDS; i++) {
-		int verifyResult = verify(as[i], es[i], zs[i]);
-		if (verifyResult != 0) {
-			printf("Not Verified %d\n", i);
-		}
+	if (status == ZKBOO_NOT_VERIFIED) {
+		printf("Not Verified %d\n", result.failedRound);
 	}
-	deltaV = clock() - beginV;
-	int inMilliV = deltaV * 1000 / CLOCKS_PER_SEC;
-	printf("Verifying: %ju\n", (uintmax_t)inMilliV);
-	
-	
+
 	delta = clock() - begin;
 	int inMilli = delta * 1000 / CLOCKS_PER_SEC;
 
 	printf("Total time: %ju\n", (uintmax_t)inMilli);
-	
-
-	openmp_thread_cleanup();
-	cleanup_EVP();
-	return EXIT_SUCCESS;
+	return status == ZKBOO_OK ? EXIT_SUCCESS : EXIT_FAILURE;
 }
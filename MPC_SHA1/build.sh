@@ -1,4 +1,4 @@
 #!/bin/bash
-gcc -g MPC_SHA1.c -fopenmp -lcrypto -o MPC_SHA1
-gcc -g MPC_SHA1_VERIFIER.c -fopenmp -lcrypto -o MPC_SHA1_VERIFIER
-
+bash ../libzkboo/build.sh || exit 1
+gcc -Wall -g -O2 MPC_SHA1.c -I../libzkboo ../libzkboo/libzkboo.a -fopenmp -lcrypto -o MPC_SHA1
+gcc -Wall -g -O2 MPC_SHA1_VERIFIER.c -I../libzkboo ../libzkboo/libzkboo.a -fopenmp -lcrypto -o MPC_SHA1_VERIFIER
@@ -0,0 +1,238 @@
+ /*
+ ============================================================================
+ Name        : prover.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : MPC SHA1 prover for one block only
+ ============================================================================
+ */
+
+/*
+ * The prover side of the circuit: mpc_sha1, which runs sha1Circuit as the
+ * three parties, and the commitment of a round. zkboo_sha1.c draws the
+ * randomness, commits every round and writes out the proof.
+ */
+
+#ifndef PROVER_H_
+#define PROVER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shared.h"
+#include "omp.h"
+
+#define CH(e,f,g) ((e & f) ^ ((~e) & g))
+//Rounds whose three views are hashed together through commitHashes
+#define COMMIT_BATCH 16
+
+
+//static View views[3];
+
+uint32_t rand32() {
+	uint32_t x;
+	x = rand() & 0xff;
+	x |= (rand() & 0xff) << 8;
+	x |= (rand() & 0xff) << 16;
+	x |= (rand() & 0xff) << 24;
+
+	return x;
+}
+
+void printbits(uint32_t n) {
+	if (n) {
+		printbits(n >> 1);
+		printf("%d", n & 1);
+	}
+
+}
+
+
+
+int sha1(unsigned char* result, unsigned char* input, int numBits) {
+	uint32_t hA[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+			0xC3D2E1F0};
+
+
+	if (numBits > 447) {
+		printf("Input too long, aborting!");
+		return -1;
+	}
+	int chars = numBits >> 3;
+	unsigned char* chunk = calloc(64, 1); //512 bits
+	memcpy(chunk, input, chars);
+	chunk[chars] = 0x80;
+	//Last 8 chars used for storing length of input without padding, in big-endian.
+	//Since we only care for one block, we are safe with just using last 9 bits and 0'ing the rest
+
+	//chunk[60] = numBits >> 24;
+	//chunk[61] = numBits >> 16;
+	chunk[62] = numBits >> 8;
+	chunk[63] = numBits;
+
+	uint32_t w[80];
+	int i;
+	for (i = 0; i < 16; i++) {
+		w[i] = (chunk[i * 4] << 24) | (chunk[i * 4 + 1] << 16)
+						| (chunk[i * 4 + 2] << 8) | chunk[i * 4 + 3];
+	}
+
+	for (i = 16; i < 80; i++) {
+		w[i] = LEFTROTATE((w[i - 3] ^ w[i-8] ^ w[i-14] ^ w[i-16]), 1);
+		printf("W[%d]: %02X\n", i, w[i]);
+	}
+
+	uint32_t a, b, c, d, e, f, k, temp;
+	a = hA[0];
+	b = hA[1];
+	c = hA[2];
+	d = hA[3];
+	e = hA[4];
+
+	for (i = 0; i < 80; i++) {
+		if(i <= 19) {
+			f = (b & c) | ((~b) & d);
+			k = 0x5A827999;
+		}
+		else if(i <= 39) {
+			f = b ^ c ^ d;
+			k = 0x6ED9EBA1;
+		}
+		else if(i <= 59) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8F1BBCDC;
+		}
+		else {
+			f = b ^c ^ d;
+			k = 0xCA62C1D6;
+		}
+		printf("F[%d]: %04X\n", i, f);
+
+		temp = (LEFTROTATE(a,5))+f+e+k+w[i];
+		e = d;
+		d = c;
+		c = LEFTROTATE(b,30);
+		b = a;
+		a = temp;
+	}
+
+	hA[0] += a;
+	hA[1] += b;
+	hA[2] += c;
+	hA[3] += d;
+	hA[4] += e;
+
+	for (i = 0; i < 5; i++) {
+		result[i * 4] = (hA[i] >> 24);
+		result[i * 4 + 1] = (hA[i] >> 16);
+		result[i * 4 + 2] = (hA[i] >> 8);
+		result[i * 4 + 3] = hA[i];
+	}
+	return 0;
+}
+
+//Runs sha1Circuit on the three shares of the input as the three parties, writing their y words
+//to views and their shares of the hash to results
+int mpc_sha1(uint32_t results[3][5], unsigned char* inputs[3], int numBits, unsigned char *randomness[3], View views[3], int* countY) {
+
+	if (numBits > 447) {
+		printf("Input too long, aborting!");
+		return -1;
+	}
+
+	const circuit* c = sha1Circuit();
+	parties regs[CIRCUIT_MAX_REGISTERS];
+	int chars = numBits >> 3;
+
+	for (int i = 0; i < 3; i++) {
+		unsigned char* chunk = views[i].x; //512 bits
+		memset(chunk, 0, 64);
+		memcpy(chunk, inputs[i], chars);
+		chunk[chars] = 0x80;
+		//Last 8 chars used for storing length of input without padding, in big-endian.
+		//Since we only care for one block, we are safe with just using last 9 bits and 0'ing the rest
+		chunk[62] = numBits >> 8;
+		chunk[63] = numBits;
+
+		for (int j = 0; j < 16; j++) {
+			regs[j][i] = (chunk[j * 4] << 24) | (chunk[j * 4 + 1] << 16)
+							| (chunk[j * 4 + 2] << 8) | chunk[j * 4 + 3];
+		}
+	}
+	for (int i = 0; i < 5; i++) {
+		regs[SHA1_STATE_REGISTER + i] = (parties) { hA[i], hA[i], hA[i] };
+	}
+
+	uint32_t* y[3] = { views[0].y, views[1].y, views[2].y };
+	sha1ProveKernel(regs, randomness, y, countY);
+
+	for (int i = 0; i < 5; i++) {
+		for (int p = 0; p < 3; p++) {
+			results[p][i] = regs[c->output[i]][p];
+		}
+	}
+	return 0;
+}
+
+
+int writeToFile(char filename[], void* data, int size, int numItems) {
+	FILE *file;
+
+	file = fopen(filename, "wb");
+	if (!file) {
+		printf("Unable to open file!");
+		return 1;
+	}
+	fwrite(data, size, numItems, file);
+	fclose(file);
+	return 0;
+}
+
+
+
+
+
+
+
+a commit(int numBytes,unsigned char shares[3][numBytes], unsigned char *randomness[3], unsigned char rs[3][4], View views[3]) {
+
+	unsigned char* inputs[3];
+	inputs[0] = shares[0];
+	inputs[1] = shares[1];
+	inputs[2] = shares[2];
+	uint32_t results[3][5];
+
+	int countY = 0;
+	mpc_sha1(results, inputs, numBytes * 8, randomness, views, &countY);
+
+	//Explicitly add y to view
+	for(int i = 0; i<5; i++) {
+		views[0].y[countY] = results[0][i];
+		views[1].y[countY] = results[1][i];
+		views[2].y[countY] = results[2][i];
+		countY += 1;
+	}
+
+	a a = { 0 };
+	output(&views[0], a.yp[0]);
+	output(&views[1], a.yp[1]);
+	output(&views[2], a.yp[2]);
+
+	return a;
+}
+
+z prove(int e, unsigned char keys[3][16], unsigned char rs[3][4], View views[3]) {
+	z z;
+	memcpy(z.ke, keys[e], 16);
+	memcpy(z.ke1, keys[(e + 1) % 3], 16);
+	z.ve = views[e];
+	z.ve1 = views[(e + 1) % 3];
+	memcpy(z.re, rs[e],4);
+	memcpy(z.re1, rs[(e + 1) % 3],4);
+
+	return z;
+}
+
+#endif /* PROVER_H_ */
@@ -0,0 +1,106 @@
+ /*
+ ============================================================================
+ Name        : sha1_circuit.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : The SHA-1 compression function as a circuit
+ ============================================================================
+ */
+
+/*
+ * Kept apart from shared.h so that ../libzkboo/circuit_gen.c can build the
+ * circuit at build time and write out its straight-line kernels.
+ */
+
+#ifndef SHA1_CIRCUIT_H_
+#define SHA1_CIRCUIT_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libzkboo/circuit.h"
+
+//The AND, ADD, ADDK and MAJ gates of sha1Circuit: an AND or MAJ in 40 of the rounds, 4 ADDs
+//per round and the 5 ADDs onto the chaining value. Checked when the circuit is built.
+#define SHA1_GATES (20 + 20 + 80 * 4 + 5)
+
+//The registers of sha1Circuit's inputs, the 16 message words and then the chaining value
+#define SHA1_STATE_REGISTER 16
+
+//The register to put a new value in once register r is dead: r itself unless it is an input
+static inline int sha1Reuse(circuit* c, int r) {
+	return r >= c->inputs ? r : circuitRegister(c);
+}
+
+//One SHA-1 compression as a circuit, the gates in the order the three parties have always run
+//them. The working variables move along by renaming registers, not by copying them.
+static void buildSha1Circuit(circuit* c) {
+	circuitBegin(c, SHA1_STATE_REGISTER + 5);
+	int f = circuitRegister(c), temp = circuitRegister(c);
+
+	int w[80];
+	for (int j = 0; j < 16; j++) {
+		w[j] = j;
+	}
+	for (int j = 16; j < 80; j++) {
+		w[j] = circuitRegister(c);
+		circuitXor(c, w[j], w[j-3], w[j-8]);
+		circuitXor(c, w[j], w[j], w[j-14]);
+		circuitXor(c, w[j], w[j], w[j-16]);
+		circuitRotl(c, w[j], w[j], 1);
+	}
+
+	int v[5]; //a to e
+	for (int i = 0; i < 5; i++) {
+		v[i] = SHA1_STATE_REGISTER + i;
+	}
+	for (int i = 0; i < 80; i++) {
+		int a = v[0], b = v[1], cc = v[2], d = v[3], e = v[4];
+		uint32_t k;
+		if(i <= 19) {
+			//f = d ^ (b & (c ^ d))
+			circuitXor(c, f, cc, d);
+			circuitAnd(c, f, b, f);
+			circuitXor(c, f, d, f);
+			k = 0x5A827999;
+		}
+		else if(i <= 39) {
+			circuitXor(c, f, b, cc);
+			circuitXor(c, f, d, f);
+			k = 0x6ED9EBA1;
+		}
+		else if(i <= 59) {
+			circuitMaj(c, f, b, cc, d);
+			k = 0x8F1BBCDC;
+		}
+		else {
+			circuitXor(c, f, b, cc);
+			circuitXor(c, f, d, f);
+			k = 0xCA62C1D6;
+		}
+
+		//temp = (a leftrotate 5) + f + e + k + w[i], which goes where e was
+		circuitRotl(c, temp, a, 5);
+		circuitAdd(c, temp, f, temp);
+		circuitAdd(c, temp, e, temp);
+		circuitAddK(c, temp, temp, k);
+		int newA = sha1Reuse(c, e);
+		circuitAdd(c, newA, w[i], temp);
+		int newC = sha1Reuse(c, b);
+		circuitRotl(c, newC, b, 30);
+		int next[5] = { newA, a, newC, cc, d };
+		memcpy(v, next, sizeof(v));
+	}
+
+	for (int i = 0; i < 5; i++) {
+		circuitAdd(c, v[i], SHA1_STATE_REGISTER + i, v[i]);
+	}
+	circuitEnd(c, v, 5);
+	if (c->words != SHA1_GATES || c->registers > CIRCUIT_MAX_REGISTERS || c->gates > CIRCUIT_MAX_GATES) {
+		fprintf(stderr, "sha1Circuit has %d gates, SHA1_GATES is %d\n", c->words, SHA1_GATES);
+		abort();
+	}
+}
+
+#endif /* SHA1_CIRCUIT_H_ */
@@ -18,7 +18,7 @@
 #endif
 #include <openssl/rand.h>
 #include "omp.h"
-const int NUM_ROUNDS = 136;
+#include "sha1_circuit.h"
 #define VERBOSE FALSE
 
 
@@ -39,7 +39,12 @@ static const uint32_t k[64] = { 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
 		0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814,
 		0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
 
-#define ySize 370
+//The AND, ADD, ADDK and MAJ gates of sha1Circuit, see sha1_circuit.h
+#define NUM_GATES SHA1_GATES
+//A y word per gate, then the 5 output words
+#define ySize (NUM_GATES + 5)
+//32 bits of randomness per gate and key, in whole AES blocks
+#define TAPE_BYTES CIRCUIT_TAPE_BYTES(NUM_GATES)
 
 typedef struct {
 	unsigned char x[64];
@@ -65,19 +70,35 @@ typedef struct {
 #define GETBIT(x, i) (((x) >> (i)) & 0x01)
 #define SETBIT(x, i, b)   x= (b)&1 ? (x)|(1 << (i)) : (x)&(~(1 << (i)))
 
+//The circuit of one compression, built on first use by whichever thread gets there first
+static const circuit* sha1Circuit(void) {
+	static circuit c;
+	static int built = 0;
+	int done;
+#pragma omp atomic read seq_cst
+	done = built;
+	if (!done) {
+#pragma omp critical(sha1Circuit)
+		{
+			if (!built) {
+				buildSha1Circuit(&c);
+#pragma omp atomic write seq_cst
+				built = 1;
+			}
+		}
+	}
+	return &c;
+}
 
 
 
-void handleErrors(void)
-{
-	ERR_print_errors_fp(stderr);
-	abort();
-}
-
 
-EVP_CIPHER_CTX* setupAES(unsigned char key[16]) {
+//An AES-128-CTR context keyed with key, or NULL if OpenSSL fails
+EVP_CIPHER_CTX* setupAES(const unsigned char key[16]) {
 	EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-	EVP_CIPHER_CTX_init(ctx);
+	if (!ctx) {
+		return NULL;
+	}
 
 	///* A 128 bit key */
 	//unsigned char *key = (unsigned char *)"01234567890123456";
@@ -85,52 +106,62 @@ EVP_CIPHER_CTX* setupAES(unsigned char key[16]) {
 	/* A 128 bit IV */
 	unsigned char *iv = (unsigned char *)"01234567890123456";
 
-	/* Create and initialise the context */
-	//if(!(ctx = EVP_CIPHER_CTX_new())) handleErrors();
-
 	/* Initialise the encryption operation. IMPORTANT - ensure you use a key
 	 * and IV size appropriate for your cipher
 	 * In this example we are using 256 bit AES (i.e. a 256 bit key). The
 	 * IV size for *most* modes is the same as the block size. For AES this
 	 * is 128 bits */
-	if(1 != EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), NULL, key, iv))
-		handleErrors();
+	if(1 != EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), NULL, key, iv)) {
+		EVP_CIPHER_CTX_free(ctx);
+		return NULL;
+	}
 
 	return ctx;
-
-
 }
 
-void getAllRandomness(unsigned char key[16], unsigned char randomness[1472]) {
+//Returns 0 on success, or 1 with randomness left zero if OpenSSL fails
+int getAllRandomness(const unsigned char key[16], unsigned char randomness[TAPE_BYTES]) {
 	//Generate randomness: We use 365*32 bit of randomness per key.
-	//Since AES block size is 128 bit, we need to run 365*32/128 = 91.25 iterations. Let's just round up.
+	//Since AES block size is 128 bit, we need to run 365*32/128 = 91.25 iterations, rounded up in TAPE_BYTES.
 
 	EVP_CIPHER_CTX* ctx;
 	ctx = setupAES(key);
 	unsigned char *plaintext =
 			(unsigned char *)"0000000000000000";
 	int len;
-	for(int j=0;j<92;j++) {
-		if(1 != EVP_EncryptUpdate(ctx, &randomness[j*16], &len, plaintext, strlen ((char *)plaintext)))
-			handleErrors();
-
+	int ok = ctx != NULL;
+	for(int j=0;j<TAPE_BYTES/16 && ok;j++) {
+		ok = 1 == EVP_EncryptUpdate(ctx, &randomness[j*16], &len, plaintext, strlen ((char *)plaintext));
+	}
+	EVP_CIPHER_CTX_free(ctx);
+	if (!ok) {
+		memset(randomness, 0, TAPE_BYTES);
+		return 1;
 	}
-	EVP_CIPHER_CTX_cleanup(ctx);
+	return 0;
 }
 
-uint32_t getRandom32(unsigned char randomness[1472], int randCount) {
+uint32_t getRandom32(unsigned char randomness[TAPE_BYTES], int randCount) {
 	uint32_t ret;
 //	printf("Randomness at %d: %02X %02X %02X %02X\n", randCount, randomness[randCount], randomness[randCount+1], randomness[randCount+2], randomness[randCount+3]);
 	memcpy(&ret, &randomness[randCount], 4);
 	return ret;
 }
 
+#define CIRCUIT_TAPE unsigned char*
+#define CIRCUIT_RAND(n, tapes, randCount, r) \
+	do { for (int tape = 0; tape < (n); tape++) (r)[tape] = getRandom32((tapes)[tape], (randCount)); } while (0)
+#include "../libzkboo/circuit_mpc.h"
+#include "sha1_kernels.h"
+
 
 void init_EVP() {
 	/* Initialise the library */
 	ERR_load_crypto_strings();
 	OpenSSL_add_all_algorithms();
-	OPENSSL_config(NULL);
+	#if OPENSSL_VERSION_NUMBER < 0x10100000L
+		OPENSSL_config(NULL); // not needed anylonger with current openssl versions
+	#endif
 }
 
 void cleanup_EVP() {
@@ -139,17 +170,67 @@ void cleanup_EVP() {
 	ERR_free_strings();
 }
 
-void H(unsigned char k[16], View v, unsigned char r[4], unsigned char hash[SHA256_DIGEST_LENGTH]) {
+void H(const unsigned char k[16], const View* v, const unsigned char r[4], unsigned char hash[SHA256_DIGEST_LENGTH]) {
 	SHA256_CTX ctx;
 	SHA256_Init(&ctx);
 	SHA256_Update(&ctx, k, 16);
-	SHA256_Update(&ctx, &v, sizeof(v));
+	SHA256_Update(&ctx, v, sizeof(*v));
 	SHA256_Update(&ctx, r, 4);
 	SHA256_Final(hash, &ctx);
 }
 
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA_LANES 8
+#define SHA_TARGET "avx2"
+#include "../libzkboo/sha256_lanes.h"
+#undef SHA_TARGET
+#undef SHA_LANES
+
+#define SHA_LANES 16
+#define SHA_TARGET "avx512f"
+#include "../libzkboo/sha256_lanes.h"
+#undef SHA_TARGET
+#undef SHA_LANES
+
+#include <cpuid.h>
+//SHA-NI, read from CPUID directly as not every gcc's __builtin_cpu_supports knows "sha"
+int cpuHasSHA(void) {
+	unsigned int eax, ebx, ecx, edx;
+	return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA);
+}
+#endif
 
-void H3(uint32_t y[8], a* as, int s, int* es) {
+//Largest multi-buffer width commitHashes() uses for a batch of remaining commitments, 1 meaning
+//one at a time through H. 8 lanes only pay off without SHA-NI, and 4 SSE2 lanes never do.
+int commitHashLanes(int remaining) {
+#if defined(__x86_64__) || defined(__i386__)
+	if (remaining >= 16 && __builtin_cpu_supports("avx512f")) {
+		return 16;
+	}
+	if (remaining >= 8 && !cpuHasSHA() && __builtin_cpu_supports("avx2")) {
+		return 8;
+	}
+#endif
+	return 1;
+}
+
+//H for count commitments, hashing up to 16 of them side by side
+void commitHashes(int count, const unsigned char* keys[], const View* views[], const unsigned char* rs[], unsigned char* hashes[]) {
+	for (int i = 0; i < count; ) {
+		int lanes = commitHashLanes(count - i);
+		switch (lanes) {
+#if defined(__x86_64__) || defined(__i386__)
+		case 16: commitHashLanes_x16(&keys[i], &views[i], &rs[i], &hashes[i]); break;
+		case 8: commitHashLanes_x8(&keys[i], &views[i], &rs[i], &hashes[i]); break;
+#endif
+		default: H(keys[i], views[i], rs[i], hashes[i]); break;
+		}
+		i += lanes;
+	}
+}
+
+
+void H3(const uint32_t y[8], const a* as, int s, int* es) {
 
 	unsigned char hash[SHA256_DIGEST_LENGTH];
 	SHA256_CTX ctx;
@@ -199,26 +280,16 @@ void H3(uint32_t y[8], a* as, int s, int* es) {
 	}*/
 }
 
-void output(View v, uint32_t* result) {
-	memcpy(result, &v.y[ySize - 5], 20);
+void output(const View* v, uint32_t* result) {
+	memcpy(result, &v->y[ySize - 5], 20);
 }
 
-void reconstruct(uint32_t* y0, uint32_t* y1, uint32_t* y2, uint32_t* result) {
+void reconstruct(const uint32_t* y0, const uint32_t* y1, const uint32_t* y2, uint32_t* result) {
 	for (int i = 0; i < 8; i++) {
 		result[i] = y0[i] ^ y1[i] ^ y2[i];
 	}
 }
 
-void mpc_XOR2(uint32_t x[2], uint32_t y[2], uint32_t z[2]) {
-	z[0] = x[0] ^ y[0];
-	z[1] = x[1] ^ y[1];
-}
-
-void mpc_NEGATE2(uint32_t x[2], uint32_t z[2]) {
-	z[0] = ~x[0];
-	z[1] = ~x[1];
-}
-
 omp_lock_t *locks;
 
 // Locking callback
@@ -266,283 +337,247 @@ void openmp_thread_cleanup(void)
 }
 
 
-int mpc_AND_verify(uint32_t x[2], uint32_t y[2], uint32_t z[2], View ve, View ve1, unsigned char *randomness[2], int* randCount, int* countY) {
-	uint32_t r[2] = { getRandom32(randomness[0], *randCount), getRandom32(randomness[1], *randCount) };
-	*randCount += 4;
-
-	uint32_t t = 0;
-
-	t = (x[0] & y[1]) ^ (x[1] & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
-	if(ve.y[*countY] != t) {
-		return 1;
-	}
-	z[0] = t;
-	z[1] = ve1.y[*countY];
-
-	(*countY)++;
-	return 0;
-}
-
-
-int mpc_ADD_verify(uint32_t x[2], uint32_t y[2], uint32_t z[2], View ve, View ve1, unsigned char *randomness[2], int* randCount, int* countY) {
-	uint32_t r[2] = { getRandom32(randomness[0], *randCount), getRandom32(randomness[1], *randCount) };
-	*randCount += 4;
-
-	uint8_t a[2], b[2];
-
-	uint8_t t;
-
-	for(int i=0;i<31;i++)
-	{
-		a[0]=GETBIT(x[0]^ve.y[*countY],i);
-		a[1]=GETBIT(x[1]^ve1.y[*countY],i);
-
-		b[0]=GETBIT(y[0]^ve.y[*countY],i);
-		b[1]=GETBIT(y[1]^ve1.y[*countY],i);
-
-		t = (a[0]&b[1]) ^ (a[1]&b[0]) ^ GETBIT(r[1],i);
-		if(GETBIT(ve.y[*countY],i+1) != (t ^ (a[0]&b[0]) ^ GETBIT(ve.y[*countY],i) ^ GETBIT(r[0],i))) {
-			return 1;
-		}
-	}
-
-	z[0]=x[0]^y[0]^ve.y[*countY];
-	z[1]=x[1]^y[1]^ve1.y[*countY];
-	(*countY)++;
-	return 0;
-}
-
-void mpc_RIGHTROTATE2(uint32_t x[], int i, uint32_t z[]) {
-	z[0] = RIGHTROTATE(x[0], i);
-	z[1] = RIGHTROTATE(x[1], i);
-}
-
-void mpc_LEFTROTATE2(uint32_t x[], int i, uint32_t z[]) {
-	z[0] = LEFTROTATE(x[0], i);
-	z[1] = LEFTROTATE(x[1], i);
-}
-
-void mpc_RIGHTSHIFT2(uint32_t x[2], int i, uint32_t z[2]) {
-	z[0] = x[0] >> i;
-	z[1] = x[1] >> i;
-}
-
-
-int mpc_MAJ_verify(uint32_t a[2], uint32_t b[2], uint32_t c[2], uint32_t z[3], View ve, View ve1, unsigned char *randomness[2], int* randCount, int* countY) {
-	uint32_t t0[3];
-	uint32_t t1[3];
-
-	mpc_XOR2(a, b, t0);
-	mpc_XOR2(a, c, t1);
-	if(mpc_AND_verify(t0, t1, z, ve, ve1, randomness, randCount, countY) == 1) {
-		return 1;
-	}
-	mpc_XOR2(z, a, z);
-	return 0;
-}
-
-int mpc_CH_verify(uint32_t e[2], uint32_t f[2], uint32_t g[2], uint32_t z[2], View ve, View ve1, unsigned char *randomness[2], int* randCount, int* countY) {
-
-	uint32_t t0[3];
-	mpc_XOR2(f,g,t0);
-	if(mpc_AND_verify(e, t0, t0, ve, ve1, randomness, randCount, countY) == 1) {
-		return 1;
-	}
-	mpc_XOR2(t0,g,z);
-
-
-	return 0;
-}
-
-
-int verify(a a, int e, z z) {
-	unsigned char* hash = malloc(SHA256_DIGEST_LENGTH);
-	H(z.ke, z.ve, z.re, hash);
+//Rounds whose opened views the verifier hashes together through commitHashes
+#define VERIFY_BATCH 8
 
-	if (memcmp(a.h[e], hash, 32) != 0) {
+//Compares the hashes of the two opened views, computed by the caller, with the commitments
+int verifyCommitments(const a* a, int e, unsigned char hashes[2][SHA256_DIGEST_LENGTH]) {
+	if (memcmp(a->h[e], hashes[0], 32) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
-	H(z.ke1, z.ve1, z.re1, hash);
-	if (memcmp(a.h[(e + 1) % 3], hash, 32) != 0) {
+	if (memcmp(a->h[(e + 1) % 3], hashes[1], 32) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
-	free(hash);
+	return 0;
+}
 
-	uint32_t* result = malloc(20);
-	output(z.ve, result);
-	if (memcmp(a.yp[e], result, 20) != 0) {
+//Everything verify() checks apart from the commitments. 2 if OpenSSL failed making the tapes,
+//which says nothing about the proof.
+int verifyViews(const a* a, int e, const z* z) {
+	uint32_t result[5];
+	output(&z->ve, result);
+	if (memcmp(a->yp[e], result, 20) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
 
-	output(z.ve1, result);
-	if (memcmp(a.yp[(e + 1) % 3], result, 20) != 0) {
+	output(&z->ve1, result);
+	if (memcmp(a->yp[(e + 1) % 3], result, 20) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
 		return 1;
 	}
 
-	free(result);
-
-	unsigned char *randomness[2];
-	randomness[0] = malloc(1472*sizeof(unsigned char));
-	randomness[1] = malloc(1472*sizeof(unsigned char));
-	getAllRandomness(z.ke, randomness[0]);
-	getAllRandomness(z.ke1, randomness[1]);
-
-	int* randCount = calloc(1, sizeof(int));
-	int* countY = calloc(1, sizeof(int));
-
-	uint32_t w[80][2];
+	unsigned char tapes[2][TAPE_BYTES];
+	unsigned char *randomness[2] = { tapes[0], tapes[1] };
+	if (getAllRandomness(z->ke, randomness[0]) != 0 || getAllRandomness(z->ke1, randomness[1]) != 0) {
+		return 2;
+	}
 
+	const circuit* c = sha1Circuit();
+	branches regs[CIRCUIT_MAX_REGISTERS];
 	for (int j = 0; j < 16; j++) {
-		w[j][0] = (z.ve.x[j * 4] << 24) | (z.ve.x[j * 4 + 1] << 16)
-								| (z.ve.x[j * 4 + 2] << 8) | z.ve.x[j * 4 + 3];
-		w[j][1] = (z.ve1.x[j * 4] << 24) | (z.ve1.x[j * 4 + 1] << 16)
-								| (z.ve1.x[j * 4 + 2] << 8) | z.ve1.x[j * 4 + 3];
+		regs[j][0] = (z->ve.x[j * 4] << 24) | (z->ve.x[j * 4 + 1] << 16)
+								| (z->ve.x[j * 4 + 2] << 8) | z->ve.x[j * 4 + 3];
+		regs[j][1] = (z->ve1.x[j * 4] << 24) | (z->ve1.x[j * 4 + 1] << 16)
+								| (z->ve1.x[j * 4 + 2] << 8) | z->ve1.x[j * 4 + 3];
 	}
-
-	uint32_t temp[3];
-	for (int j = 16; j < 80; j++) {
-		mpc_XOR2(w[j-3], w[j-8], temp);
-		mpc_XOR2(temp, w[j-14], temp);
-		mpc_XOR2(temp, w[j-16], temp);
-		mpc_LEFTROTATE2(temp,1,w[j]);
-
-		//printf("W[%d]: %02X\n", j, w[j][0]^w[j][1]^w[j][2]);
+	for (int i = 0; i < 5; i++) {
+		regs[SHA1_STATE_REGISTER + i][0] = hA[i];
+		regs[SHA1_STATE_REGISTER + i][1] = hA[i];
 	}
 
-
-
-	uint32_t va[2] = { hA[0],hA[0] };
-	uint32_t vb[2] = { hA[1],hA[1] };
-	uint32_t vc[2] = { hA[2],hA[2] };
-	uint32_t vd[2] = { hA[3],hA[3] };
-	uint32_t ve[2] = { hA[4],hA[4] };
-	uint32_t f[2];
-	uint32_t k;
-	uint32_t temp1[2];
-	for (int i = 0; i < 80; i++) {
-		if(i <= 19) {
-			//f = d ^ (b & (c ^ d))
-			mpc_XOR2(vc,vd,f);
-			if(mpc_AND_verify(vb, f, f, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+	int countY = 0;
+	int gate = sha1VerifyKernel(regs, randomness, z->ve.y, z->ve1.y, NULL, &countY);
+	if (gate >= 0) {
 #if VERBOSE
-				if(i == 0) {
-					printf("*countY: %d\n", *countY);
-					printf("F[%d]: %02X\n", i, f[0]^f[1]);
-					printf("View_1: %02X\n", z.ve.y[(*countY)]);
-					printf("View_2: %02X\n", z.ve1.y[(*countY)]);
-				}
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-				return 1;
-			}
-			mpc_XOR2(vd,f,f);
-			k = 0x5A827999;
-		}
-		else if(i <= 39) {
-			mpc_XOR2(vb,vc,f);
-			mpc_XOR2(vd,f,f);
-			k = 0x6ED9EBA1;
-		}
-		else if(i <= 59) {
-			//f = MAJ(b,c,d)
-			if(mpc_MAJ_verify(vb,vc,vd,f, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-				printf("Failing at %d, iteration %d", __LINE__, i);
+		printf("Failing at %d, gate %d", __LINE__, gate);
 #endif
-				return 1;
-			}
-			k = 0x8F1BBCDC;
-		}
-		else {
-			mpc_XOR2(vb,vc,f);
-			mpc_XOR2(vd,f,f);
-			k = 0xCA62C1D6;
-		}
-
+		return 1;
+	}
 
-		//temp = (a leftrotate 5) + f + e + k + w[i]
-		mpc_LEFTROTATE2(va,5,temp);
-		if(mpc_ADD_verify(f,temp,temp, z.ve, z.ve1, randomness, randCount, countY) == 1) {
+	//The output words the views claim must be the ones the circuit computed
+	for (int i = 0; i < 5; i++) {
+		if (z->ve.y[countY + i] != regs[c->output[i]][0] || z->ve1.y[countY + i] != regs[c->output[i]][1]) {
 #if VERBOSE
-			printf("Failing at %d, iteration %d", __LINE__, i);
+			printf("Failing at %d", __LINE__);
 #endif
 			return 1;
 		}
-		if(mpc_ADD_verify(ve,temp,temp, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-			printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
+	}
+
+	return 0;
+}
+
+int verify(const a* a, int e, const z* z) {
+	unsigned char hashes[2][SHA256_DIGEST_LENGTH];
+	H(z->ke, &z->ve, z->re, hashes[0]);
+	H(z->ke1, &z->ve1, z->re1, hashes[1]);
+	if (verifyCommitments(a, e, hashes) != 0) {
+		return 1;
+	}
+	return verifyViews(a, e, z);
+}
+
+//Verifies all rounds on up to threads threads (0 means the OpenMP default), hashing the two
+//opened views of VERIFY_BATCH rounds together before checking each round. Returns the lowest
+//failing round for any thread count, or -1 if all verify. *badCommitment says whether it
+//failed on its commitments or on its views, *opensslFailed whether a round could not be checked.
+int verifyProof(const a* as, const int* es, const z* zs, int rounds, int threads, int* badCommitment, int* opensslFailed) {
+	int firstFail = rounds;
+	*badCommitment = 0;
+	*opensslFailed = 0;
+	if (threads <= 0) {
+		threads = omp_get_max_threads();
+	}
+
+	#pragma omp parallel for schedule(dynamic) num_threads(threads)
+	for(int first = 0; first<rounds; first += VERIFY_BATCH) {
+		int stop;
+		#pragma omp atomic read
+		stop = firstFail;
+		if (first > stop) {
+			continue;
 		}
-		temp1[0] = k;
-		temp1[1] = k;
-		if(mpc_ADD_verify(temp,temp1,temp, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-			printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
+		int count = rounds - first < VERIFY_BATCH ? rounds - first : VERIFY_BATCH;
+		const unsigned char* keys[2 * VERIFY_BATCH];
+		const View* views[2 * VERIFY_BATCH];
+		const unsigned char* rs[2 * VERIFY_BATCH];
+		unsigned char hashes[VERIFY_BATCH][2][SHA256_DIGEST_LENGTH];
+		unsigned char* hashPtrs[2 * VERIFY_BATCH];
+		for(int j = 0; j<count; j++) {
+			const z* zj = &zs[first + j];
+			keys[2 * j] = zj->ke;
+			keys[2 * j + 1] = zj->ke1;
+			views[2 * j] = &zj->ve;
+			views[2 * j + 1] = &zj->ve1;
+			rs[2 * j] = zj->re;
+			rs[2 * j + 1] = zj->re1;
+			hashPtrs[2 * j] = hashes[j][0];
+			hashPtrs[2 * j + 1] = hashes[j][1];
 		}
-		if(mpc_ADD_verify(w[i],temp,temp, z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-			printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
+		commitHashes(2 * count, keys, views, rs, hashPtrs);
+
+		for(int j = 0; j<count; j++) {
+			int i = first + j;
+			int commitment = verifyCommitments(&as[i], es[i], hashes[j]) != 0;
+			int views = commitment ? 0 : verifyViews(&as[i], es[i], &zs[i]);
+			if (views == 2) {
+				#pragma omp atomic write
+				*opensslFailed = 1;
+			}
+			if (commitment || views != 0) {
+				#pragma omp critical(verifyProofFirstFail)
+				{
+					if (i < firstFail) {
+						#pragma omp atomic write
+						firstFail = i;
+						*badCommitment = commitment;
+					}
+				}
+				break;
+			}
 		}
+	}
+	return firstFail < rounds ? firstFail : -1;
+}
 
-		memcpy(ve, vd, sizeof(uint32_t) * 2);
-		memcpy(vd, vc, sizeof(uint32_t) * 2);
-		mpc_LEFTROTATE2(vb,30,vc);
-		memcpy(vb, va, sizeof(uint32_t) * 2);
-		memcpy(va, temp, sizeof(uint32_t) * 2);
+#include "../libzkboo/container.h"
+
+_Static_assert(sizeof(a) % CONTAINER_ALIGN == 0 && sizeof(z) % CONTAINER_ALIGN == 0,
+		"proofs are written and read in place as bare a and z arrays");
+
+//The container header and round index (rounds + 1 entries) of a proof of rounds rounds. The
+//a array follows the index, then the z array.
+void proofLayout(int rounds, containerHeader* header, uint64_t index[]) {
+	memset(header, 0, sizeof(*header));
+	header->circuit = CIRCUIT_SHA1;
+	header->rounds = rounds;
+	header->viewWords = ySize;
+	header->outputWords = 5;
+	header->publicBytes = sizeof(a) * rounds;
+	size_t openingBytes[rounds];
+	for (int i = 0; i < rounds; i++) {
+		openingBytes[i] = sizeof(z);
 	}
+	containerLayout(header, openingBytes, index);
+}
 
-	uint32_t hHa[8][3] = { { hA[0],hA[0],hA[0]  }, { hA[1],hA[1],hA[1] }, { hA[2],hA[2],hA[2] }, { hA[3],hA[3],hA[3] },
-			{ hA[4],hA[4],hA[4] }, { hA[5],hA[5],hA[5] }, { hA[6],hA[6],hA[6] }, { hA[7],hA[7],hA[7] } };
-	if(mpc_ADD_verify(hHa[0], va, hHa[0], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+//The bytes of a proof of rounds rounds as laid out by proofLayout, which leaves no padding:
+//the header, index, a and z are all multiples of CONTAINER_ALIGN
+size_t proofSize(int rounds) {
+	return sizeof(containerHeader) + sizeof(uint64_t) * (rounds + 1) + (sizeof(a) + sizeof(z)) * rounds;
+}
+
+typedef enum {
+	PROOF_OK = 0,
+	PROOF_UNRECOGNISED,
+	PROOF_OTHER_CIRCUIT, //a proof for another hash function, see mappedProof.circuit
+	PROOF_WRONG_ROUNDS
+} proofStatus;
+
+//A proof file read in place: the pointers are into its mapping
+typedef struct {
+	CircuitId circuit;
+	int rounds;
+	const containerHeader* header; //NULL for a file in the original headerless format
+	const a* as;
+	const z* zs;
+} mappedProof;
+
+//Makes sense of a mapped proof file of minRounds rounds or more, either a container or the
+//original bare a and z arrays
+proofStatus openProof(const proofMap* map, int minRounds, mappedProof* proof) {
+	memset(proof, 0, sizeof(*proof));
+	proof->circuit = CIRCUIT_SHA1;
+	proof->rounds = CONTAINER_LEGACY_ROUNDS;
+	if (map->size == (sizeof(a) + sizeof(z)) * CONTAINER_LEGACY_ROUNDS && !isContainer(map)) {
+		proof->as = (const a*)map->data;
+		proof->zs = (const z*)(map->data + sizeof(a) * CONTAINER_LEGACY_ROUNDS);
+		return CONTAINER_LEGACY_ROUNDS >= minRounds ? PROOF_OK : PROOF_WRONG_ROUNDS;
 	}
-	if(mpc_ADD_verify(hHa[1], vb, hHa[1], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+
+	const containerHeader* header = containerCheck(map);
+	if (!header) {
+		return PROOF_UNRECOGNISED;
 	}
-	if(mpc_ADD_verify(hHa[2], vc, hHa[2], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	proof->header = header;
+	proof->circuit = header->circuit;
+	proof->rounds = header->rounds > CONTAINER_MAX_ROUNDS ? CONTAINER_MAX_ROUNDS + 1 : (int)header->rounds;
+	int rounds = proof->rounds;
+	if (header->circuit != CIRCUIT_SHA1) {
+		return PROOF_OTHER_CIRCUIT;
 	}
-	if(mpc_ADD_verify(hHa[3], vd, hHa[3], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	if (rounds < minRounds || rounds > CONTAINER_MAX_ROUNDS) {
+		return PROOF_WRONG_ROUNDS;
 	}
-	if(mpc_ADD_verify(hHa[4], ve, hHa[4], z.ve, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	//SHA-1 proofs only come with full openings, AES-128-CTR tapes and SHA-256 commitments, and without a prefix or hash chain.
+	//Their single block does not depend on the input's length, which is not recorded.
+	if (header->viewWords != ySize || header->outputWords != 5 || header->prg != 0 || header->hash != 0
+			|| header->flags != 0 || header->inputLen != 0 || header->prefixLen != 0 || header->rehashes != 0
+			|| header->publicBytes != sizeof(a) * rounds) {
+		return PROOF_UNRECOGNISED;
 	}
-	//printf("CountY: %d\n", countY);
-
-	return 0;
+	for (int round = 0; round < rounds; round++) {
+		size_t bytes;
+		containerOpening(map, header, round, &bytes);
+		if (bytes != sizeof(z)) {
+			return PROOF_UNRECOGNISED;
+		}
+	}
+	proof->as = containerPublic(map, header);
+	size_t bytes;
+	proof->zs = containerOpening(map, header, 0, &bytes);
+	return PROOF_OK;
 }
 
 
@@ -0,0 +1,259 @@
+ /*
+ ============================================================================
+ Name        : zkboo_sha1.c
+ Author      : Sobuno
+ Version     : 0.1
+ Description : The SHA-1 calls of libzkboo, see zkboo.h
+ ============================================================================
+ */
+
+/*
+ * Built as its own object of the library: the SHA-256 code uses the same
+ * names for its own functions, so ../libzkboo/build.sh hides everything
+ * here but the zkboo_ calls. SHA-1 proofs always have full openings,
+ * AES-128-CTR tapes and SHA-256 commitments.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "prover.h"
+#include "../libzkboo/context.h"
+
+//Writes all bytes of data to fd. Returns 0 on success.
+static int writeAll(int fd, const unsigned char* data, size_t bytes) {
+	while (bytes > 0) {
+		ssize_t written = write(fd, data, bytes);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return 1;
+		}
+		data += written;
+		bytes -= written;
+	}
+	return 0;
+}
+
+//Proves knowledge of input into fd, or into out when fd is -1, in rounds rounds. The proof is
+//put together in place, in out or in the context's scratch block, and the openings are packed
+//straight into it. Always inlined into proveSha1, which has a copy for each of the SPECIALIZED_ROUNDS.
+static inline __attribute__((always_inline)) zkboo_status proveRounds(zkboo_ctx* ctx, const unsigned char* input, int i, int fd, zkboo_buffer* out, int rounds) {
+	int threads = ctx->threads > 0 ? ctx->threads : omp_get_max_threads();
+	size_t proofBytes = proofSize(rounds);
+	unsigned char (*keys)[3][16] = NULL;
+	unsigned char (*rs)[3][4] = NULL;
+	unsigned char (*shares)[3][i] = NULL;
+	unsigned char (*randomness)[3][TAPE_BYTES] = NULL;
+	View (*localViews)[3] = NULL;
+	int* es = NULL;
+	unsigned char* proof = NULL; //fd only, out otherwise
+	unsigned char* base = NULL;
+	for (int pass = 0; pass < 2; pass++) {
+		size_t offset = 0;
+		keys = scratchPiece(base, &offset, sizeof(*keys) * rounds);
+		rs = scratchPiece(base, &offset, sizeof(*rs) * rounds);
+		shares = scratchPiece(base, &offset, sizeof(*shares) * rounds);
+		randomness = scratchPiece(base, &offset, sizeof(*randomness) * rounds);
+		localViews = scratchPiece(base, &offset, sizeof(*localViews) * rounds);
+		es = scratchPiece(base, &offset, sizeof(int) * rounds);
+		proof = scratchPiece(base, &offset, fd >= 0 ? proofBytes : 0);
+		if (pass == 0 && !(base = ctxScratch(ctx, offset))) {
+			return ZKBOO_NO_MEMORY;
+		}
+	}
+	if (fd < 0) {
+		if (bufferReserve(ctx, out, proofBytes) != 0) {
+			return ZKBOO_NO_MEMORY;
+		}
+		proof = out->data;
+	}
+	//The index goes straight after the header, and the a array straight after the index
+	containerHeader header;
+	uint64_t* index = (uint64_t*)(proof + sizeof(containerHeader));
+	proofLayout(rounds, &header, index);
+	a* as = (a*)(proof + header.publicOffset);
+	z* zs = (z*)(proof + index[0]);
+
+	//Generating keys
+	if(RAND_bytes((unsigned char*)keys, rounds*3*16) != 1) {
+		return ZKBOO_NO_RANDOMNESS;
+	}
+	if(RAND_bytes((unsigned char*)rs, rounds*3*4) != 1) {
+		return ZKBOO_NO_RANDOMNESS;
+	}
+
+	//Sharing secrets
+	if(RAND_bytes((unsigned char*)shares, rounds*3*i) != 1) {
+		return ZKBOO_NO_RANDOMNESS;
+	}
+	#pragma omp parallel for num_threads(threads)
+	for(int k=0; k<rounds; k++) {
+		for (int j = 0; j < i; j++) {
+			shares[k][2][j] = input[j] ^ shares[k][0][j] ^ shares[k][1][j];
+		}
+	}
+
+	//Generating randomness
+	int failed = 0;
+	#pragma omp parallel for num_threads(threads) reduction(|:failed)
+	for(int k=0; k<rounds; k++) {
+		for(int j = 0; j<3; j++) {
+			failed |= getAllRandomness(keys[k][j], randomness[k][j]);
+		}
+	}
+	if (failed) {
+		return ZKBOO_CRYPTO_ERROR;
+	}
+
+	//Running MPC-SHA1
+	#pragma omp parallel for num_threads(threads)
+	for(int k=0; k<rounds; k++) {
+		unsigned char* tapes[3] = { randomness[k][0], randomness[k][1], randomness[k][2] };
+		as[k] = commit(i, shares[k], tapes, rs[k], localViews[k]);
+	}
+
+	//Committing
+	//The three views of COMMIT_BATCH rounds are hashed together so the multi-buffer widths fill up
+	#pragma omp parallel for num_threads(threads)
+	for(int first=0; first<rounds; first+=COMMIT_BATCH) {
+		int count = rounds - first < COMMIT_BATCH ? rounds - first : COMMIT_BATCH;
+		const unsigned char* batchKeys[3 * COMMIT_BATCH];
+		const View* batchViews[3 * COMMIT_BATCH];
+		const unsigned char* batchRs[3 * COMMIT_BATCH];
+		unsigned char* batchHashes[3 * COMMIT_BATCH];
+		for(int k=0; k<count; k++) {
+			for(int j=0; j<3; j++) {
+				batchKeys[3 * k + j] = keys[first + k][j];
+				batchViews[3 * k + j] = &localViews[first + k][j];
+				batchRs[3 * k + j] = rs[first + k][j];
+				batchHashes[3 * k + j] = as[first + k].h[j];
+			}
+		}
+		commitHashes(3 * count, batchKeys, batchViews, batchRs, batchHashes);
+	}
+
+	//Generating E
+	uint32_t finalHash[8];
+	for (int j = 0; j < 8; j++) {
+		finalHash[j] = as[0].yp[0][j]^as[0].yp[1][j]^as[0].yp[2][j];
+	}
+	H3(finalHash, as, rounds, es);
+
+	//Packing Z, straight into the proof
+	#pragma omp parallel for num_threads(threads)
+	for(int k = 0; k<rounds; k++) {
+		zs[k] = prove(es[k],keys[k],rs[k], localViews[k]);
+	}
+
+	memcpy(proof, &header, sizeof(header));
+	if (fd >= 0 && writeAll(fd, proof, proofBytes) != 0) {
+		return ZKBOO_IO_ERROR;
+	}
+	return ZKBOO_OK;
+}
+
+static zkboo_status proveSha1(zkboo_ctx* ctx, const unsigned char* input, size_t len, const zkboo_params* params, int fd, zkboo_buffer* out) {
+	int rounds = paramsRounds(params);
+	if (len > ZKBOO_MAX_BLOCK_INPUT || rounds < 0) {
+		return ZKBOO_BAD_INPUT;
+	}
+	if (params && (params->prg != ZKBOO_PRG_AES_CTR || params->hash != ZKBOO_HASH_SHA256 || params->compact || params->lowMemory || params->prefixLen > 0 || params->chain > 1 || params->hmac)) {
+		return ZKBOO_UNSUPPORTED;
+	}
+	return SPECIALIZED_ROUNDS(rounds, proveRounds, ctx, input, len, fd, out);
+}
+
+zkboo_status zkboo_prove_sha1(zkboo_ctx* ctx, const unsigned char* input, size_t len, const zkboo_params* params, zkboo_buffer* out) {
+	zkboo_status status = proveSha1(ctx, input, len, params, -1, out);
+	if (status != ZKBOO_OK) {
+		out->size = 0;
+	}
+	return status;
+}
+
+zkboo_status zkboo_prove_sha1_fd(zkboo_ctx* ctx, const unsigned char* input, size_t len, const zkboo_params* params, int fd) {
+	return fd < 0 ? ZKBOO_IO_ERROR : proveSha1(ctx, input, len, params, fd, NULL);
+}
+
+//Verifies a proof opened in place, of rounds rounds, with its challenges in the context's
+//scratch block. Inlined into verifyOpened for each of the SPECIALIZED_ROUNDS.
+static inline __attribute__((always_inline)) zkboo_status verifyRounds(zkboo_ctx* ctx, const mappedProof* proof, zkboo_result* result, int rounds) {
+	int* es = ctxScratch(ctx, sizeof(int) * rounds);
+	if (!es) {
+		return ZKBOO_NO_MEMORY;
+	}
+	uint32_t y[8];
+	reconstruct(proof->as[0].yp[0], proof->as[0].yp[1], proof->as[0].yp[2], y);
+	memcpy(result->hash, y, sizeof(uint32_t) * 5);
+	result->hashWords = 5;
+
+	H3(y, proof->as, rounds, es);
+	int badCommitment, opensslFailed;
+	int failed = verifyProof(proof->as, es, proof->zs, rounds, ctx->threads, &badCommitment, &opensslFailed);
+	if (opensslFailed) {
+		return ZKBOO_CRYPTO_ERROR;
+	}
+	if (failed >= 0) {
+		result->failedRound = failed;
+		result->reason = badCommitment ? "commitment mismatch" : "inconsistent view";
+		return ZKBOO_NOT_VERIFIED;
+	}
+	return ZKBOO_OK;
+}
+
+static zkboo_status verifyOpened(zkboo_ctx* ctx, const mappedProof* proof, zkboo_result* result) {
+	return SPECIALIZED_ROUNDS(proof->rounds, verifyRounds, ctx, proof, result);
+}
+
+zkboo_status zkboo_verify_sha1(zkboo_ctx* ctx, const void* data, size_t len, zkboo_result* result) {
+	zkboo_result unused;
+	if (!result) {
+		result = &unused;
+	}
+	memset(result, 0, sizeof(*result));
+	result->circuit = ZKBOO_SHA1;
+	result->failedRound = -1;
+
+	//The proof is read in place as a and z structs, which needs it aligned. The copy cannot be
+	//in the scratch block, which holds the challenges.
+	void* copy = NULL;
+	if ((uintptr_t)data % CONTAINER_ALIGN != 0) {
+		if (!(copy = ctxAlloc(ctx, len))) {
+			return ZKBOO_NO_MEMORY;
+		}
+		memcpy(copy, data, len);
+		data = copy;
+	}
+	proofMap map = { data, len };
+	mappedProof proof;
+	proofStatus status = openProof(&map, ctx->minRounds, &proof);
+	result->circuit = (zkboo_circuit)proof.circuit;
+	result->rounds = proof.rounds;
+	result->params.rounds = proof.rounds;
+	result->params.chain = 1;
+	zkboo_status ret = ZKBOO_BAD_PROOF;
+	if (status == PROOF_OTHER_CIRCUIT) {
+		ret = ZKBOO_OTHER_CIRCUIT;
+	} else if (status == PROOF_WRONG_ROUNDS) {
+		ret = ZKBOO_WRONG_ROUNDS;
+	} else if (status == PROOF_OK && ctx->prefixLen > 0) {
+		//SHA-1 proofs never have a prefix or a hash chain
+		result->reason = "public prefix mismatch";
+		ret = ZKBOO_NOT_VERIFIED;
+	} else if (status == PROOF_OK && ctx->chain != 1) {
+		result->reason = "hash chain length mismatch";
+		ret = ZKBOO_NOT_VERIFIED;
+	} else if (status == PROOF_OK && ctx->hmac) {
+		result->reason = "proof of a hash, not an HMAC";
+		ret = ZKBOO_NOT_VERIFIED;
+	} else if (status == PROOF_OK) {
+		ret = verifyOpened(ctx, &proof, result);
+	}
+	ctxFree(ctx, copy);
+	return ret;
+}
@@ -0,0 +1,1198 @@
+/*
+ ============================================================================
+ Name        : MPC_SHA256_BENCH.c
+ Author      : Sobuno
+ Version     : 0.1
+ Description : Microbenchmarks for the SHA-256 prover and verifier kernels
+ ============================================================================
+ */
+
+#include "zkboo_sha256.c"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_ITERATIONS 200000
+#define NUM_ROUNDS ZKBOO_DEFAULT_ROUNDS //rounds of the proofs the kernels are timed on
+
+//The gate schedule of the 32 byte inputs most benchmarks prove, set up by main
+static messagePlan benchPlans;
+
+//Cycle counter where there is one, nanoseconds otherwise
+static inline uint64_t benchTicks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+//Opens a counter for this thread's cache misses at the given perf cache level, or returns -1
+//where hardware counters are not available (non-Linux, VMs, perf_event_paranoid)
+static int benchOpenMisses(int cache) {
+#ifdef __linux__
+	struct perf_event_attr pe;
+	memset(&pe, 0, sizeof(pe));
+	pe.size = sizeof(pe);
+	pe.type = PERF_TYPE_HW_CACHE;
+	pe.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	pe.exclude_kernel = 1;
+	pe.exclude_hv = 1;
+	return syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+#else
+	return -1;
+#endif
+}
+
+static long long benchReadMisses(int fd) {
+	long long count = 0;
+	if (fd < 0 || read(fd, &count, sizeof(count)) != sizeof(count)) {
+		return -1;
+	}
+	return count;
+}
+
+static double benchMicros(struct timespec begin, struct timespec end) {
+	return ((end.tv_sec - begin.tv_sec) * 1e9 + (end.tv_nsec - begin.tv_nsec)) / 1e3;
+}
+
+static uint32_t benchRand32(void) {
+	return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+//The bit-serial mpc_ADD carry loop the prover used before mpc_ADD_carries, kept as the baseline
+static void mpc_ADD_bitwise(uint32_t x[NUM_BRANCHES], uint32_t y[NUM_BRANCHES], uint32_t r[NUM_BRANCHES], uint32_t c[NUM_BRANCHES]) {
+	uint8_t a[NUM_BRANCHES];
+	uint8_t b[NUM_BRANCHES];
+	uint8_t t;
+
+	c[0] = c[1] = c[2] = 0;
+	for(int i=0;i<31;i++)
+	{
+		a[0]=GETBIT(x[0] ^ c[0], i);
+		a[1]=GETBIT(x[1] ^ c[1], i);
+		a[2]=GETBIT(x[2] ^ c[2], i);
+
+		b[0]=GETBIT(y[0] ^ c[0], i);
+		b[1]=GETBIT(y[1] ^ c[1], i);
+		b[2]=GETBIT(y[2] ^ c[2], i);
+
+		t = (a[0] & b[1]) ^ (a[1] & b[0]) ^ GETBIT(r[1],i);
+		SETBIT(c[0], i+1, t ^ (a[0] & b[0]) ^ GETBIT(c[0],i) ^ GETBIT(r[0],i));
+
+		t = (a[1] & b[2]) ^ (a[2] & b[1]) ^ GETBIT(r[2], i);
+		SETBIT(c[1], i+1, t ^ (a[1] & b[1]) ^ GETBIT(c[1], i) ^ GETBIT(r[1],i));
+
+		t = (a[2] & b[0]) ^ (a[0] & b[2]) ^ GETBIT(r[0], i);
+		SETBIT(c[2], i+1, t ^ (a[2] & b[2]) ^ GETBIT(c[2],i) ^ GETBIT(r[2],i));
+	}
+}
+
+//Ticks per three-party ADD carry chain, bit-serial versus packed parties
+void benchADD(void) {
+	static uint32_t in[BENCH_ITERATIONS][3][NUM_BRANCHES];
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		for (int j = 0; j < 3; j++) {
+			for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+				in[i][j][branch] = benchRand32();
+			}
+		}
+	}
+
+	//Chain the carries into the next input so neither loop can be hoisted or overlapped
+	uint32_t c[NUM_BRANCHES] = { 0 };
+	uint64_t begin = benchTicks();
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		uint32_t x[NUM_BRANCHES] = { in[i][0][0] ^ c[0], in[i][0][1] ^ c[1], in[i][0][2] ^ c[2] };
+		mpc_ADD_bitwise(x, in[i][1], in[i][2], c);
+	}
+	uint64_t bitwise = benchTicks() - begin;
+	uint32_t bitwiseCheck = c[0] ^ c[1] ^ c[2];
+
+	parties pc = { 0 };
+	begin = benchTicks();
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		parties x = { in[i][0][0] ^ pc[0], in[i][0][1] ^ pc[1], in[i][0][2] ^ pc[2] };
+		parties y = { in[i][1][0], in[i][1][1], in[i][1][2] };
+		parties r = { in[i][2][0], in[i][2][1], in[i][2][2] };
+		pc = mpc_ADD_carries(x, y, r);
+	}
+	uint64_t packed = benchTicks() - begin;
+	uint32_t packedCheck = pc[0] ^ pc[1] ^ pc[2];
+
+	printf("ADD carry chain (ticks per call)\n");
+	printf("	bit-serial GETBIT/SETBIT: %.1f\n", (double)bitwise / BENCH_ITERATIONS);
+	printf("	packed parties:           %.1f\n", (double)packed / BENCH_ITERATIONS);
+	if (bitwiseCheck != packedCheck) {
+		printf("	carry words differ!\n");
+	}
+}
+
+//Ticks per tape, one EVP key at a time versus the batched engine, for the prover's batch width
+//and the verifier's two keys. Every batched tape is compared with its EVP tape.
+void benchTapes(void) {
+	int numTapes = NUM_ROUNDS * NUM_BRANCHES;
+	unsigned char (*keys)[16] = malloc(16 * numTapes);
+	unsigned char (*evp)[TAPE_BYTES] = malloc(TAPE_BYTES * numTapes);
+	unsigned char (*batched)[TAPE_BYTES] = malloc(TAPE_BYTES * numTapes);
+	const unsigned char* keyPtrs[numTapes];
+	unsigned char* tapePtrs[numTapes];
+	for (int i = 0; i < numTapes; i++) {
+		for (int j = 0; j < 16; j++) keys[i][j] = rand();
+		keyPtrs[i] = keys[i];
+		tapePtrs[i] = batched[i];
+	}
+
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, defaultBackends);
+	int repeats = 20;
+	uint64_t begin = benchTicks();
+	for (int r = 0; r < repeats; r++) {
+		for (int i = 0; i < numTapes; i++) {
+			getAllRandomnessEVP(&crypto, keys[i], evp[i]);
+		}
+	}
+	uint64_t single = benchTicks() - begin;
+
+	begin = benchTicks();
+	for (int r = 0; r < repeats; r++) {
+		getRandomnessForKeys(&crypto, numTapes, keyPtrs, tapePtrs);
+	}
+	uint64_t batch = benchTicks() - begin;
+	int mismatches = memcmp(evp, batched, TAPE_BYTES * numTapes) != 0;
+
+	begin = benchTicks();
+	for (int r = 0; r < repeats; r++) {
+		for (int i = 0; i < numTapes; i += TWO_BRANCHES) {
+			getRandomnessForKeys(&crypto, TWO_BRANCHES, &keyPtrs[i], &tapePtrs[i]);
+		}
+	}
+	uint64_t pairs = benchTicks() - begin;
+	mismatches += memcmp(evp, batched, TAPE_BYTES * numTapes) != 0;
+
+	//Streamed a chunk at a time, one round's three branches in lockstep as commit() reads them.
+	//The first read of a chunk produces it; every word is read back once for the check.
+	Tape* streams = malloc(sizeof(Tape) * NUM_BRANCHES);
+	uint32_t first[NUM_BRANCHES];
+	begin = benchTicks();
+	for (int r = 0; r < repeats; r++) {
+		for (int i = 0; i < numTapes; i += NUM_BRANCHES) {
+			for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+				tapeInit(&streams[branch], &crypto, keys[i + branch]);
+			}
+			for (int randCount = 0; randCount < TAPE_BYTES; randCount += TAPE_CHUNK) {
+				tapesGet32(NUM_BRANCHES, streams, randCount, first);
+			}
+		}
+	}
+	uint64_t streamed = benchTicks() - begin;
+	memset(batched, 0, TAPE_BYTES * numTapes);
+	for (int i = 0; i < numTapes; i += NUM_BRANCHES) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			tapeInit(&streams[branch], &crypto, keys[i + branch]);
+		}
+		for (int randCount = 0; randCount < TAPE_BYTES; randCount += 4) {
+			uint32_t words[NUM_BRANCHES];
+			tapesGet32(NUM_BRANCHES, streams, randCount, words);
+			for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+				memcpy(&batched[i + branch][randCount], &words[branch], 4);
+			}
+		}
+	}
+	mismatches += memcmp(evp, batched, TAPE_BYTES * numTapes) != 0;
+	free(streams);
+
+	//Every batch width the switch in aesniKeystreamBatch specialises
+	for (int n = 1; n <= TAPE_KEYS; n++) {
+		memset(batched, 0, TAPE_BYTES * n);
+		getRandomnessForKeys(&crypto, n, keyPtrs, tapePtrs);
+		mismatches += memcmp(evp, batched, TAPE_BYTES * n) != 0;
+	}
+
+	printf("Tape generation, %d bytes (ticks per tape)\n", TAPE_BYTES);
+	printf("	EVP, one key at a time:   %.0f\n", (double)single / repeats / numTapes);
+	printf("	%d keys per batch:         %.0f\n", TAPE_KEYS, (double)batch / repeats / numTapes);
+	printf("	2 keys per batch:         %.0f\n", (double)pairs / repeats / numTapes);
+	printf("	streamed, %d-byte chunks: %.0f\n", TAPE_CHUNK, (double)streamed / repeats / numTapes);
+	if (mismatches != 0) {
+		printf("	batched tapes differ from EVP!\n");
+	}
+	cleanupCryptoCtx(&crypto);
+	free(keys);
+	free(evp);
+	free(batched);
+}
+
+//Ticks per commitment hash, one at a time through EVP versus each multi-buffer width.
+//Every digest is compared with the EVP one.
+void benchCommitHashes(void) {
+	enum { count = 48, repeats = 50 };
+	unsigned char (*keys)[16] = malloc(16 * count);
+	unsigned char (*rs)[4] = malloc(4 * count);
+	View* views = malloc(sizeof(View) * count);
+	unsigned char (*expected)[32] = malloc(32 * count);
+	unsigned char (*hashes)[32] = malloc(32 * count);
+	const unsigned char* keyPtrs[count];
+	const unsigned char* rPtrs[count];
+	const View* viewPtrs[count];
+	unsigned char* hashPtrs[count];
+	for (int i = 0; i < count; i++) {
+		for (int j = 0; j < 16; j++) keys[i][j] = rand();
+		for (int j = 0; j < 4; j++) rs[i][j] = rand();
+		for (size_t j = 0; j < sizeof(View); j++) ((unsigned char*)&views[i])[j] = rand();
+		keyPtrs[i] = keys[i];
+		rPtrs[i] = rs[i];
+		viewPtrs[i] = &views[i];
+		hashPtrs[i] = hashes[i];
+	}
+
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, defaultBackends);
+	printf("Commitment hashes, %d bytes (ticks per hash)\n", (int)COMMIT_BYTES);
+	uint64_t begin = benchTicks();
+	for (int r = 0; r < repeats; r++) {
+		for (int i = 0; i < count; i++) {
+			calculateHashForBranch(&crypto, keys[i], &views[i], rs[i], expected[i]);
+		}
+	}
+	printf("	EVP, one at a time: %.0f\n", (double)(benchTicks() - begin) / repeats / count);
+
+#if defined(__x86_64__) || defined(__i386__)
+	struct { int lanes; const char* feature; void (*hash)(const unsigned char**, const View**, const unsigned char**, unsigned char**); } widths[] = {
+		{ 8, "avx2", commitHashLanes_x8 }, { 16, "avx512f", commitHashLanes_x16 }
+	};
+	for (int w = 0; w < 2; w++) {
+		if ((w == 0 && !__builtin_cpu_supports("avx2")) || (w == 1 && !__builtin_cpu_supports("avx512f"))) {
+			continue;
+		}
+		memset(hashes, 0, 32 * count);
+		begin = benchTicks();
+		for (int r = 0; r < repeats; r++) {
+			for (int i = 0; i < count; i += widths[w].lanes) {
+				widths[w].hash(&keyPtrs[i], &viewPtrs[i], &rPtrs[i], &hashPtrs[i]);
+			}
+		}
+		printf("	%2d lanes, %-7s:   %.0f%s\n", widths[w].lanes, widths[w].feature, (double)(benchTicks() - begin) / repeats / count,
+				memcmp(hashes, expected, 32 * count) != 0 ? "  digests differ!" : "");
+	}
+#endif
+	cleanupCryptoCtx(&crypto);
+	free(keys);
+	free(rs);
+	free(views);
+	free(expected);
+	free(hashes);
+}
+
+//Ticks and cache misses for committing and hashing every round: all commits first and then
+//a hashing pass over every view (how the prover used to run), versus commitAndHashRounds()
+//hashing each batch's views right after computing them
+void benchCommitHash(void) {
+	int inputLen = 32, repeats = 10;
+	unsigned char (*shares)[NUM_BRANCHES][inputLen] = malloc(sizeof(*shares) * NUM_ROUNDS);
+	unsigned char (*keys)[NUM_BRANCHES][16] = malloc(sizeof(*keys) * NUM_ROUNDS);
+	unsigned char (*rs)[NUM_BRANCHES][4] = malloc(sizeof(*rs) * NUM_ROUNDS);
+	View (*views)[NUM_BRANCHES] = malloc(sizeof(*views) * NUM_ROUNDS);
+	a* twoPass = malloc(sizeof(a) * NUM_ROUNDS);
+	a* fused = malloc(sizeof(a) * NUM_ROUNDS);
+	for (int round = 0; round < NUM_ROUNDS; round++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			for (int i = 0; i < 16; i++) keys[round][branch][i] = rand();
+			for (int i = 0; i < 4; i++) rs[round][branch][i] = rand();
+			for (int i = 0; i < inputLen; i++) shares[round][branch][i] = rand();
+		}
+	}
+
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, defaultBackends);
+	int fds[2] = { benchOpenMisses(PERF_COUNT_HW_CACHE_L1D), benchOpenMisses(PERF_COUNT_HW_CACHE_LL) };
+	uint64_t ticks[2] = { 0, 0 };
+	long long misses[2][2];
+	for (int fusedRun = 0; fusedRun < 2; fusedRun++) {
+		long long before[2] = { benchReadMisses(fds[0]), benchReadMisses(fds[1]) };
+		uint64_t begin = benchTicks();
+		for (int r = 0; r < repeats; r++) {
+			for (int round = 0; round < NUM_ROUNDS; ) {
+				int count = commitBatchSize(NUM_ROUNDS - round);
+				if (fusedRun) {
+					commitAndHashRounds(count, inputLen, &shares[round], &keys[round], &rs[round], &views[round], &fused[round], &benchPlans.first, &crypto);
+				} else {
+					commitRounds(count, inputLen, &shares[round], &keys[round], &views[round], &twoPass[round], &benchPlans.first, &crypto);
+				}
+				round += count;
+			}
+			for (int round = 0; round < NUM_ROUNDS && !fusedRun; round++) {
+				for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+					calculateHashForBranch(&crypto, keys[round][branch], &views[round][branch], rs[round][branch], twoPass[round].h[branch]);
+				}
+			}
+		}
+		ticks[fusedRun] = benchTicks() - begin;
+		for (int level = 0; level < 2; level++) {
+			long long after = benchReadMisses(fds[level]);
+			misses[fusedRun][level] = before[level] < 0 || after < 0 ? -1 : (after - before[level]) / repeats;
+		}
+	}
+
+	printf("Commit and hash %d rounds (ticks per round, L1D/LLC read misses per proof)\n", NUM_ROUNDS);
+	const char* names[2] = { "separate hashing pass:", "fused per batch:      " };
+	for (int run = 0; run < 2; run++) {
+		printf("	%s %.0f", names[run], (double)ticks[run] / repeats / NUM_ROUNDS);
+		if (misses[run][0] < 0 || misses[run][1] < 0) {
+			printf(", misses n/a (no hardware counters)\n");
+		} else {
+			printf(", %lld / %lld\n", misses[run][0], misses[run][1]);
+		}
+	}
+	if (memcmp(twoPass, fused, sizeof(a) * NUM_ROUNDS) != 0) {
+		printf("	commitments differ!\n");
+	}
+	for (int level = 0; level < 2; level++) {
+		if (fds[level] >= 0) {
+			close(fds[level]);
+		}
+	}
+	cleanupCryptoCtx(&crypto);
+	free(shares);
+	free(keys);
+	free(rs);
+	free(views);
+	free(twoPass);
+	free(fused);
+}
+
+//Builds a valid NUM_ROUNDS proof for a random input of plan->inputLen bytes in memory, like
+//the prover does
+void benchProof(Backends backends, const gatePlan* plan, a* as, z* zs, int* es) {
+	int inputLen = plan->inputLen;
+	unsigned char (*shares)[NUM_BRANCHES][inputLen] = malloc(sizeof(*shares) * NUM_ROUNDS);
+	unsigned char (*keys)[NUM_BRANCHES][16] = malloc(sizeof(*keys) * NUM_ROUNDS);
+	unsigned char (*rs)[NUM_BRANCHES][4] = malloc(sizeof(*rs) * NUM_ROUNDS);
+	View (*localViews)[NUM_BRANCHES] = malloc(sizeof(*localViews) * NUM_ROUNDS);
+
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, backends);
+	for (int round = 0; round < NUM_ROUNDS; round++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			for (int i = 0; i < 16; i++) keys[round][branch][i] = rand();
+			for (int i = 0; i < 4; i++) rs[round][branch][i] = rand();
+			for (int i = 0; i < inputLen; i++) shares[round][branch][i] = rand();
+		}
+	}
+	for (int round = 0; round < NUM_ROUNDS; ) {
+		int count = commitBatchSize(NUM_ROUNDS - round);
+		commitAndHashRounds(count, inputLen, &shares[round], &keys[round], &rs[round], &localViews[round], &as[round], plan, &crypto);
+		round += count;
+	}
+	uint32_t y[8];
+	reconstruct(as[0].yp[0], as[0].yp[1], as[0].yp[2], y);
+	calculateEs(&crypto, NULL, y, as, NUM_ROUNDS, es);
+	for (int round = 0; round < NUM_ROUNDS; round++) {
+		zs[round] = getProveOfTwoBranchesByE(es[round], keys[round], rs[round], localViews[round]);
+	}
+	cleanupCryptoCtx(&crypto);
+	free(shares);
+	free(keys);
+	free(rs);
+	free(localViews);
+}
+
+//Wall time of verifying every round of a proof, round by round and through verifyProof
+void benchVerify(void) {
+	a* as = malloc(sizeof(a) * NUM_ROUNDS);
+	z* zs = malloc(sizeof(z) * NUM_ROUNDS);
+	int* es = malloc(sizeof(int) * NUM_ROUNDS);
+	benchProof(defaultBackends, &benchPlans.first, as, zs, es);
+
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, defaultBackends);
+	int repeats = 20, failures = 0;
+	struct timespec begin, end;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (int i = 0; i < repeats; i++) {
+		for (int round = 0; round < NUM_ROUNDS; round++) {
+			failures += verifyRound(&as[round], es[round], &zs[round], &benchPlans.first, &crypto);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double us = ((end.tv_sec - begin.tv_sec) * 1e9 + (end.tv_nsec - begin.tv_nsec)) / 1e3 / repeats;
+
+	//verifyProof on one thread, which hashes VERIFY_BATCH rounds' views together
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (int i = 0; i < repeats; i++) {
+		failures += verifyProof(defaultBackends, as, es, zs, &benchPlans, NUM_ROUNDS, 1).reason != VERIFY_OK;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double batchedUs = ((end.tv_sec - begin.tv_sec) * 1e9 + (end.tv_nsec - begin.tv_nsec)) / 1e3 / repeats;
+
+	printf("Verifying %d rounds\n", NUM_ROUNDS);
+	printf("	verifyRound per round: %.0f us per proof, %.1f us per round\n", us, us / NUM_ROUNDS);
+	printf("	verifyProof, 1 thread: %.0f us per proof, %.1f us per round\n", batchedUs, batchedUs / NUM_ROUNDS);
+	if (failures != 0) {
+		printf("	%d rounds failed to verify!\n", failures);
+	}
+	cleanupCryptoCtx(&crypto);
+	free(as);
+	free(zs);
+	free(es);
+}
+
+//Time to write out the openings of a proof with full openings to a file: assembled into z
+//structs and fwritten, as the prover used to, and with writev straight from the views
+void benchOutput(void) {
+	int inputLen = 32, repeats = 50;
+	unsigned char (*shares)[NUM_BRANCHES][inputLen] = malloc(sizeof(*shares) * NUM_ROUNDS);
+	unsigned char (*keys)[NUM_BRANCHES][16] = malloc(sizeof(*keys) * NUM_ROUNDS);
+	unsigned char (*rs)[NUM_BRANCHES][4] = malloc(sizeof(*rs) * NUM_ROUNDS);
+	View (*views)[NUM_BRANCHES] = malloc(sizeof(*views) * NUM_ROUNDS);
+	a* as = malloc(sizeof(a) * NUM_ROUNDS);
+	int es[NUM_ROUNDS];
+	for (int round = 0; round < NUM_ROUNDS; round++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			for (int i = 0; i < 16; i++) keys[round][branch][i] = rand();
+			for (int i = 0; i < 4; i++) rs[round][branch][i] = rand();
+			for (int i = 0; i < inputLen; i++) shares[round][branch][i] = rand();
+		}
+	}
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, defaultBackends);
+	for (int round = 0; round < NUM_ROUNDS; ) {
+		int count = commitBatchSize(NUM_ROUNDS - round);
+		commitAndHashRounds(count, inputLen, &shares[round], &keys[round], &rs[round], &views[round], &as[round], &benchPlans.first, &crypto);
+		round += count;
+	}
+	uint32_t y[8];
+	ProofParams params = { defaultBackends, 0, inputLen, 1 };
+	reconstruct(as[0].yp[0], as[0].yp[1], as[0].yp[2], y);
+	calculateEs(&crypto, &params, y, as, NUM_ROUNDS, es);
+	cleanupCryptoCtx(&crypto);
+
+	char path[] = "/tmp/zkboo_benchXXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		printf("Unable to create a file for benchOutput\n");
+		return;
+	}
+	unlink(path);
+	double us[2];
+	for (int method = 0; method < 2; method++) {
+		struct timespec begin, end;
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+		for (int r = 0; r < repeats; r++) {
+			if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0) {
+				printf("Unable to reset the file for benchOutput\n");
+			}
+			if (method == 0) {
+				FILE* file = fdopen(dup(fd), "wb");
+				z* zs = malloc(sizeof(z) * NUM_ROUNDS);
+				for (int round = 0; round < NUM_ROUNDS; round++) {
+					zs[round] = getProveOfTwoBranchesByE(es[round], keys[round], rs[round], views[round]);
+				}
+				writeProofHead(file, &params, es, NUM_ROUNDS);
+				fwrite(as, sizeof(a), NUM_ROUNDS, file);
+				fwrite(zs, sizeof(z), NUM_ROUNDS, file);
+				fclose(file);
+				free(zs);
+			} else {
+				proofWriter* writer = malloc(sizeof(proofWriter));
+				containerHeader header;
+				uint64_t index[NUM_ROUNDS + 1];
+				writerInit(writer, fd);
+				proofLayout(&params, es, NUM_ROUNDS, &header, index);
+				writerAdd(writer, &header, sizeof(header));
+				writerAdd(writer, index, sizeof(index));
+				writerAdd(writer, as, sizeof(a) * NUM_ROUNDS);
+				for (int round = 0; round < NUM_ROUNDS; round++) {
+					writerAddOpening(writer, es[round], keys[round], rs[round], views[round]);
+				}
+				writerFlush(writer);
+				free(writer);
+			}
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		us[method] = benchMicros(begin, end) / repeats;
+	}
+	close(fd);
+
+	printf("Writing a proof with full openings, %d rounds\n", NUM_ROUNDS);
+	printf("	z structs and fwrite: %.0f us\n", us[0]);
+	printf("	writev from the views: %.0f us\n", us[1]);
+	free(shares);
+	free(keys);
+	free(rs);
+	free(views);
+	free(as);
+}
+
+//Single-thread proving and verifying time of the copies SPECIALIZED_ROUNDS makes, against
+//the same body with a round count only known at runtime
+void benchRounds(void) {
+	int roundCounts[2] = { ZKBOO_DEFAULT_ROUNDS, ROUNDS_128_BIT }, repeats = 20;
+	const unsigned char input[] = "hello world";
+	int inputLen = sizeof(input) - 1;
+	zkboo_ctx* ctx = zkboo_ctx_new(NULL, 1);
+	zkboo_buffer proof = { 0 };
+	ProofParams params = { defaultBackends, 0, inputLen, 1 };
+	printf("Round counts (us per proof, 1 thread, specialized / runtime)\n");
+	for (int i = 0; i < 2; i++) {
+		double proveUs[2], verifyUs[2];
+		proveRounds(ctx, input, inputLen, &params, 0, -1, &proof, roundCounts[i]); //grows the scratch block and proof
+		for (int specialized = 1; specialized >= 0; specialized--) {
+			volatile int runtimeRounds = roundCounts[i];
+			struct timespec begin, end;
+			clock_gettime(CLOCK_MONOTONIC, &begin);
+			for (int r = 0; r < repeats; r++) {
+				if (specialized) {
+					SPECIALIZED_ROUNDS(roundCounts[i], proveRounds, ctx, input, inputLen, &params, 0, -1, &proof);
+				} else {
+					proveRounds(ctx, input, inputLen, &params, 0, -1, &proof, runtimeRounds);
+				}
+			}
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			proveUs[specialized] = benchMicros(begin, end) / repeats;
+
+			proofMap map = { proof.data, proof.size };
+			mappedProof opened;
+			zkboo_result result;
+			int failures = openProof(&map, 1, &opened) != PROOF_OK;
+			clock_gettime(CLOCK_MONOTONIC, &begin);
+			for (int r = 0; r < repeats; r++) {
+				if (specialized) {
+					failures += verifyOpened(ctx, &map, &opened, &result) != ZKBOO_OK;
+				} else {
+					failures += verifyRounds(ctx, &map, &opened, &result, runtimeRounds) != ZKBOO_OK;
+				}
+			}
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			verifyUs[specialized] = benchMicros(begin, end) / repeats;
+			if (failures) {
+				printf("	%d rounds: %d proofs did not verify\n", roundCounts[i], failures);
+			}
+		}
+		printf("	%d rounds (%.1f bits): prove %.0f / %.0f, verify %.0f / %.0f\n", roundCounts[i], zkboo_soundness_bits(roundCounts[i]),
+				proveUs[1], proveUs[0], verifyUs[1], verifyUs[0]);
+	}
+	zkboo_buffer_free(ctx, &proof);
+	zkboo_ctx_free(ctx);
+}
+
+//Bytes and single-thread verification time of one proof with full openings and with compact
+//(ZKB++) ones. Both are openings of the same commitments.
+void benchCompact(void) {
+	int inputLen = 32, repeats = 20;
+	unsigned char input[inputLen];
+	unsigned char (*shares)[NUM_BRANCHES][inputLen] = malloc(sizeof(*shares) * NUM_ROUNDS);
+	unsigned char (*keys)[NUM_BRANCHES][16] = malloc(sizeof(*keys) * NUM_ROUNDS);
+	unsigned char (*rs)[NUM_BRANCHES][4] = malloc(sizeof(*rs) * NUM_ROUNDS);
+	View (*views)[NUM_BRANCHES] = malloc(sizeof(*views) * NUM_ROUNDS);
+	a* as = malloc(sizeof(a) * NUM_ROUNDS);
+	z* zs = malloc(sizeof(z) * NUM_ROUNDS);
+	zCompact* zcs = malloc(sizeof(zCompact) * NUM_ROUNDS);
+	const zCompact** zcPtrs = malloc(sizeof(zCompact*) * NUM_ROUNDS);
+	a* rebuilt = malloc(sizeof(a) * NUM_ROUNDS); //the commitments verifyCompactProof rebuilds
+	View (*batchViews)[VERIFY_BATCH][TWO_BRANCHES] = malloc(sizeof(*batchViews));
+	int es[NUM_ROUNDS], compactEs[NUM_ROUNDS];
+
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, defaultBackends);
+	for (int i = 0; i < inputLen; i++) input[i] = rand();
+	for (int round = 0; round < NUM_ROUNDS; round++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			for (int i = 0; i < 16; i++) keys[round][branch][i] = rand();
+		}
+		compactShares(&crypto, inputLen, input, keys[round], shares[round], rs[round]);
+	}
+	for (int round = 0; round < NUM_ROUNDS; ) {
+		int count = commitBatchSize(NUM_ROUNDS - round);
+		commitAndHashRounds(count, inputLen, &shares[round], &keys[round], &rs[round], &views[round], &as[round], &benchPlans.first, &crypto);
+		round += count;
+	}
+	//The kind of openings is part of the statement the challenges are drawn from, so the two
+	//proofs open different branches
+	ProofParams params = { defaultBackends, 0, inputLen, 1 };
+	ProofParams compactParams = { defaultBackends, 1, inputLen, 1 };
+	uint32_t y[8];
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	reconstruct(as[0].yp[0], as[0].yp[1], as[0].yp[2], y);
+	calculateEs(&crypto, &params, y, as, NUM_ROUNDS, es);
+	challengeDigest(&crypto, &compactParams, y, as, NUM_ROUNDS, digest);
+	esFromDigest(&crypto, digest, NUM_ROUNDS, compactEs);
+	for (int round = 0; round < NUM_ROUNDS; round++) {
+		zs[round] = getProveOfTwoBranchesByE(es[round], keys[round], rs[round], views[round]);
+		zcs[round] = getCompactProof(compactEs[round], &benchPlans.first, keys[round], views[round], &as[round]);
+		zcPtrs[round] = &zcs[round];
+	}
+	cleanupCryptoCtx(&crypto);
+
+	//File sizes from the container layout, which ends at the last round's index entry
+	containerHeader header;
+	uint64_t index[NUM_ROUNDS + 1];
+	proofLayout(&params, es, NUM_ROUNDS, &header, index);
+	size_t fullBytes = index[NUM_ROUNDS];
+	proofLayout(&compactParams, compactEs, NUM_ROUNDS, &header, index);
+	size_t compactBytes = index[NUM_ROUNDS];
+
+	int failures = 0;
+	struct timespec begin, middle, end;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (int r = 0; r < repeats; r++) {
+		failures += verifyProof(defaultBackends, as, es, zs, &benchPlans, NUM_ROUNDS, 1).reason != VERIFY_OK;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &middle);
+	for (int r = 0; r < repeats; r++) {
+		failures += verifyCompactProof(&compactParams, y, digest, compactEs, zcPtrs, NUM_ROUNDS, &benchPlans.first, 1, rebuilt, batchViews).reason != VERIFY_OK;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	//The same proofs as files, verified while they are read through stream.h
+	char* files[2];
+	size_t fileBytes[2];
+	for (int compact = 0; compact < 2; compact++) {
+		FILE* file = open_memstream(&files[compact], &fileBytes[compact]);
+		writeProofHead(file, compact ? &compactParams : &params, compact ? compactEs : es, NUM_ROUNDS);
+		if (compact) {
+			fwrite(y, sizeof(uint32_t), 8, file);
+			fwrite(digest, 1, SHA256_DIGEST_LENGTH, file);
+			for (int round = 0; round < NUM_ROUNDS; round++) {
+				writeCompactOpening(file, &zcs[round], compactEs[round], &benchPlans.first);
+			}
+		} else {
+			fwrite(as, sizeof(a), NUM_ROUNDS, file);
+			fwrite(zs, sizeof(z), NUM_ROUNDS, file);
+		}
+		fclose(file);
+	}
+	double streamedUs[2];
+	for (int compact = 0; compact < 2; compact++) {
+		struct timespec streamBegin, streamEnd;
+		clock_gettime(CLOCK_MONOTONIC, &streamBegin);
+		for (int r = 0; r < repeats; r++) {
+			FILE* file = fmemopen(files[compact], fileBytes[compact], "rb");
+			proofStream stream;
+			if (openProofStream(file, NUM_ROUNDS, NULL, &stream) != PROOF_OK) {
+				failures++;
+			} else {
+				failures += verifyProofStream(&stream, 1).reason != VERIFY_OK;
+			}
+			closeProofStream(&stream);
+			fclose(file);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &streamEnd);
+		streamedUs[compact] = benchMicros(streamBegin, streamEnd) / repeats;
+		free(files[compact]);
+	}
+
+	printf("Full and compact openings, %d rounds (bytes per proof, us to verify on 1 thread in memory and streamed)\n", NUM_ROUNDS);
+	printf("	full:    %zu bytes, %.0f us, streamed %.0f us\n", fullBytes, benchMicros(begin, middle) / repeats, streamedUs[0]);
+	printf("	compact: %zu bytes (%.1f%%), %.0f us, streamed %.0f us\n", compactBytes, 100.0 * compactBytes / fullBytes,
+			benchMicros(middle, end) / repeats, streamedUs[1]);
+	if (failures != 0) {
+		printf("	%d proofs failed to verify!\n", failures);
+	}
+	free(shares);
+	free(keys);
+	free(rs);
+	free(views);
+	free(as);
+	free(zs);
+	free(zcs);
+	free(zcPtrs);
+	free(rebuilt);
+	free(batchViews);
+}
+
+//Every tape PRG and hash of backends.h on its own, then every pairing ranked by the time
+//to prove and verify a proof on one thread
+void benchBackends(void) {
+	enum { numTapes = 48, repeats = 10 };
+	unsigned char (*keys)[16] = malloc(16 * numTapes);
+	unsigned char (*tapes)[TAPE_BYTES] = malloc(TAPE_BYTES * numTapes);
+	unsigned char (*rs)[4] = malloc(4 * numTapes);
+	View* views = malloc(sizeof(View) * numTapes);
+	unsigned char (*hashes)[32] = malloc(32 * numTapes);
+	const unsigned char* keyPtrs[numTapes];
+	const unsigned char* rPtrs[numTapes];
+	const View* viewPtrs[numTapes];
+	unsigned char* tapePtrs[numTapes];
+	unsigned char* hashPtrs[numTapes];
+	for (int i = 0; i < numTapes; i++) {
+		for (int j = 0; j < 16; j++) keys[i][j] = rand();
+		for (int j = 0; j < 4; j++) rs[i][j] = rand();
+		for (size_t j = 0; j < sizeof(View); j++) ((unsigned char*)&views[i])[j] = rand();
+		keyPtrs[i] = keys[i];
+		rPtrs[i] = rs[i];
+		viewPtrs[i] = &views[i];
+		tapePtrs[i] = tapes[i];
+		hashPtrs[i] = hashes[i];
+	}
+
+	printf("Tape PRGs, %d bytes (ticks per tape)\n", TAPE_BYTES);
+	for (int prg = 0; prg < NUM_PRGS; prg++) {
+		Backends backends = { prg, HASH_SHA256 };
+		CryptoCtx crypto;
+		initCryptoCtx(&crypto, backends);
+		uint64_t begin = benchTicks();
+		for (int r = 0; r < repeats; r++) {
+			getRandomnessForKeys(&crypto, numTapes, keyPtrs, tapePtrs);
+		}
+		uint64_t ticks = benchTicks() - begin;
+		//The streamed tapes must match the whole ones
+		int mismatches = 0;
+		Tape tape;
+		tapeInit(&tape, &crypto, keys[0]);
+		for (int randCount = 0; randCount < TAPE_BYTES; randCount += 4) {
+			uint32_t word = tapeGet32(&tape, randCount);
+			mismatches += memcmp(&word, &tapes[0][randCount], 4) != 0;
+		}
+		printf("	%-10s %.0f%s\n", prgNames[prg], (double)ticks / repeats / numTapes, mismatches ? " (streamed tape differs!)" : "");
+		cleanupCryptoCtx(&crypto);
+	}
+
+	printf("Commitment hashes, %d bytes (ticks per hash)\n", (int)COMMIT_BYTES);
+	for (int hash = 0; hash < NUM_HASHES; hash++) {
+		Backends backends = { PRG_AES_CTR, hash };
+		CryptoCtx crypto;
+		initCryptoCtx(&crypto, backends);
+		uint64_t begin = benchTicks();
+		for (int r = 0; r < repeats; r++) {
+			commitHashes(&crypto, numTapes, keyPtrs, viewPtrs, rPtrs, hashPtrs);
+		}
+		uint64_t ticks = benchTicks() - begin;
+		printf("	%-10s %.0f\n", hashNames[hash], (double)ticks / repeats / numTapes);
+		cleanupCryptoCtx(&crypto);
+	}
+
+	a* as = malloc(sizeof(a) * NUM_ROUNDS);
+	z* zs = malloc(sizeof(z) * NUM_ROUNDS);
+	int* es = malloc(sizeof(int) * NUM_ROUNDS);
+	Backends pairs[NUM_PRGS * NUM_HASHES];
+	double proveUs[NUM_PRGS * NUM_HASHES], verifyUs[NUM_PRGS * NUM_HASHES];
+	int failures[NUM_PRGS * NUM_HASHES];
+	int numPairs = 0;
+	for (int prg = 0; prg < NUM_PRGS; prg++) {
+		for (int hash = 0; hash < NUM_HASHES; hash++, numPairs++) {
+			Backends backends = { prg, hash };
+			struct timespec begin, middle, end;
+			proveUs[numPairs] = verifyUs[numPairs] = 0;
+			failures[numPairs] = 0;
+			for (int r = 0; r < repeats; r++) {
+				clock_gettime(CLOCK_MONOTONIC, &begin);
+				benchProof(backends, &benchPlans.first, as, zs, es);
+				clock_gettime(CLOCK_MONOTONIC, &middle);
+				failures[numPairs] += verifyProof(backends, as, es, zs, &benchPlans, NUM_ROUNDS, 1).reason != VERIFY_OK;
+				clock_gettime(CLOCK_MONOTONIC, &end);
+				proveUs[numPairs] += benchMicros(begin, middle) / repeats;
+				verifyUs[numPairs] += benchMicros(middle, end) / repeats;
+			}
+			pairs[numPairs] = backends;
+		}
+	}
+
+	//Insertion sort on prove + verify time
+	int order[NUM_PRGS * NUM_HASHES];
+	for (int i = 0; i < numPairs; i++) {
+		int j = i;
+		for (; j > 0 && proveUs[order[j - 1]] + verifyUs[order[j - 1]] > proveUs[i] + verifyUs[i]; j--) {
+			order[j] = order[j - 1];
+		}
+		order[j] = i;
+	}
+	printf("Tape PRG and hash pairs, fastest first (us per %d-round proof, 1 thread)\n", NUM_ROUNDS);
+	for (int i = 0; i < numPairs; i++) {
+		int p = order[i];
+		printf("	%2d. -p %-10s -h %-9s prove %6.0f, verify %6.0f, total %6.0f%s\n", i + 1, prgNames[pairs[p].prg], hashNames[pairs[p].hash],
+				proveUs[p], verifyUs[p], proveUs[p] + verifyUs[p], failures[p] ? " (did not verify!)" : "");
+	}
+	free(as);
+	free(zs);
+	free(es);
+	free(keys);
+	free(tapes);
+	free(rs);
+	free(views);
+	free(hashes);
+}
+
+//Ticks per compression of the 32 byte input's first block, sha256Circuit run by circuitProve
+//and circuitVerify and by the kernels circuit_gen writes out for it, tape reads included. The
+//kernels' y words and outputs are compared with the interpreter's.
+void benchKernels(void) {
+	const circuit* c = sha256Circuit();
+	const gatePlan* plan = &benchPlans.first;
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, defaultBackends);
+	unsigned char keys[NUM_BRANCHES][16];
+	static View views[2][NUM_BRANCHES]; //interpreted, generated
+	parties in[CIRCUIT_MAX_REGISTERS] = { { 0 } };
+	for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+		for (int j = 0; j < 16; j++) {
+			keys[branch][j] = rand();
+			in[j][branch] = benchRand32();
+		}
+		for (int i = 0; i < 8; i++) {
+			in[SHA256_STATE_REGISTER + i][branch] = plan->iv[i];
+		}
+	}
+
+	int repeats = 5000;
+	uint64_t proveTicks[2], verifyTicks[2];
+	parties out[2][CIRCUIT_MAX_REGISTERS];
+	int countY[2];
+	for (int generated = 0; generated < 2; generated++) {
+		Tape tapes[NUM_BRANCHES];
+		uint32_t* y[NUM_BRANCHES] = { views[generated][0].y, views[generated][1].y, views[generated][2].y };
+		uint64_t begin = benchTicks();
+		for (int r = 0; r < repeats; r++) {
+			for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+				tapeInit(&tapes[branch], &crypto, keys[branch]);
+			}
+			memcpy(out[generated], in, sizeof(parties) * c->inputs);
+			countY[generated] = 0;
+			if (generated) {
+				sha256ProveKernel(plan->local, out[generated], tapes, y, &countY[generated]);
+			} else {
+				circuitProve(c, plan->local, out[generated], tapes, y, &countY[generated]);
+			}
+		}
+		proveTicks[generated] = benchTicks() - begin;
+	}
+	int mismatches = countY[0] != countY[1];
+	for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+		mismatches += memcmp(views[0][branch].y, views[1][branch].y, sizeof(uint32_t) * countY[0]) != 0;
+		for (int i = 0; i < 8; i++) {
+			mismatches += out[0][c->output[i]][branch] != out[1][c->output[i]][branch];
+		}
+	}
+
+	for (int generated = 0; generated < 2; generated++) {
+		Tape tapes[TWO_BRANCHES];
+		branches regs[CIRCUIT_MAX_REGISTERS];
+		uint64_t begin = benchTicks();
+		for (int r = 0; r < repeats; r++) {
+			for (int branch = 0; branch < TWO_BRANCHES; branch++) {
+				tapeInit(&tapes[branch], &crypto, keys[branch]);
+			}
+			for (int j = 0; j < c->inputs; j++) {
+				regs[j] = (branches) { in[j][0], in[j][1] };
+			}
+			int count = 0;
+			int failing = generated
+					? sha256VerifyKernel(plan->local, regs, tapes, views[0][0].y, views[0][1].y, NULL, &count)
+					: circuitVerify(c, plan->local, regs, tapes, views[0][0].y, views[0][1].y, NULL, &count);
+			mismatches += failing != -1 || count != countY[0];
+		}
+		verifyTicks[generated] = benchTicks() - begin;
+	}
+	cleanupCryptoCtx(&crypto);
+
+	printf("Circuit kernels, 32 byte input (ticks per compression, interpreted / generated)\n");
+	printf("	prove:  %.0f / %.0f\n", (double)proveTicks[0] / repeats, (double)proveTicks[1] / repeats);
+	printf("	verify: %.0f / %.0f\n", (double)verifyTicks[0] / repeats, (double)verifyTicks[1] / repeats);
+	if (mismatches) {
+		printf("	kernels differ from the interpreter!\n");
+	}
+}
+
+//Gate words of a view, compact proof bytes and single-thread time to build and to verify a
+//proof in memory, with every gate a three-party one and with the gates on public values
+//computed in the clear, for inputs of a few lengths
+void benchPublicGates(void) {
+	int lengths[] = { 3, 11, 32, 55 }, repeats = 10;
+	a* as = malloc(sizeof(a) * NUM_ROUNDS);
+	z* zs = malloc(sizeof(z) * NUM_ROUNDS);
+	int* es = malloc(sizeof(int) * NUM_ROUNDS);
+	printf("Gates on public values (y words, compact bytes, us per %d-round proof to prove and verify, 1 thread, three-party / in the clear)\n", NUM_ROUNDS);
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+		messagePlan plans;
+		int words[2], failures = 0;
+		size_t compactBytes[2];
+		double proveUs[2] = { 0, 0 }, verifyUs[2] = { 0, 0 };
+		for (int publicGates = 0; publicGates < 2; publicGates++) {
+			planMessage(lengths[i], publicGates, &plans);
+			for (int r = 0; r < repeats; r++) {
+				struct timespec begin, middle, end;
+				clock_gettime(CLOCK_MONOTONIC, &begin);
+				benchProof(defaultBackends, &plans.first, as, zs, es);
+				clock_gettime(CLOCK_MONOTONIC, &middle);
+				failures += verifyProof(defaultBackends, as, es, zs, &plans, NUM_ROUNDS, 1).reason != VERIFY_OK;
+				clock_gettime(CLOCK_MONOTONIC, &end);
+				proveUs[publicGates] += benchMicros(begin, middle) / repeats;
+				verifyUs[publicGates] += benchMicros(middle, end) / repeats;
+			}
+			containerHeader header;
+			uint64_t index[NUM_ROUNDS + 1];
+			ProofParams params = { defaultBackends, 1, lengths[i], publicGates };
+			proofLayout(&params, es, NUM_ROUNDS, &header, index);
+			compactBytes[publicGates] = index[NUM_ROUNDS];
+			words[publicGates] = plans.first.words;
+		}
+		printf("	%2d bytes: %d / %d words, %zu / %zu bytes, prove %.0f / %.0f, verify %.0f / %.0f%s\n", lengths[i], words[0], words[1],
+				compactBytes[0], compactBytes[1], proveUs[0], proveUs[1], verifyUs[0], verifyUs[1], failures ? " (did not verify!)" : "");
+	}
+	free(as);
+	free(zs);
+	free(es);
+}
+
+//Time to prove and verify in memory and proof bytes for inputs of one to many blocks, on the
+//default number of threads
+void benchBlocks(void) {
+	int lengths[] = { 55, 119, 247, 1024, 4096 }, repeats = 3;
+	unsigned char* input = malloc(4096);
+	for (int i = 0; i < 4096; i++) {
+		input[i] = rand();
+	}
+	zkboo_ctx* ctx = zkboo_ctx_new(NULL, 0);
+	zkboo_buffer proof = { 0 };
+	printf("Inputs of several blocks (ms per %d-round proof, all threads)\n", NUM_ROUNDS);
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+		int failures = 0;
+		double proveMs = 0, verifyMs = 0;
+		for (int r = 0; r < repeats; r++) {
+			struct timespec begin, middle, end;
+			clock_gettime(CLOCK_MONOTONIC, &begin);
+			failures += zkboo_prove_sha256(ctx, input, lengths[i], NULL, &proof) != ZKBOO_OK;
+			clock_gettime(CLOCK_MONOTONIC, &middle);
+			failures += zkboo_verify_sha256(ctx, proof.data, proof.size, NULL) != ZKBOO_OK;
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			proveMs += benchMicros(begin, middle) / 1e3 / repeats;
+			verifyMs += benchMicros(middle, end) / 1e3 / repeats;
+		}
+		printf("	%4d bytes, %2d blocks: prove %.0f, verify %.0f, %zu bytes%s\n", lengths[i], inputBlocks(lengths[i]),
+				proveMs, verifyMs, proof.size, failures ? " (did not verify!)" : "");
+	}
+	zkboo_buffer_free(ctx, &proof);
+	zkboo_ctx_free(ctx);
+	free(input);
+}
+
+//Time to prove and verify in memory and proof bytes for messages whose last 32 bytes are
+//secret, with the bytes before them secret as well and as a public prefix, on the default
+//number of threads
+void benchPrefix(void) {
+	int lengths[] = { 64, 256, 1024, 4096 }, secretLen = 32, repeats = 3;
+	unsigned char* message = malloc(4096);
+	for (int i = 0; i < 4096; i++) {
+		message[i] = rand();
+	}
+	zkboo_ctx* ctx = zkboo_ctx_new(NULL, 0);
+	zkboo_buffer proof = { 0 };
+	printf("Public prefixes (ms per %d-round proof of a message ending in %d secret bytes, all threads, all secret / public prefix)\n", NUM_ROUNDS, secretLen);
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+		int failures = 0;
+		size_t bytes[2];
+		double proveMs[2] = { 0, 0 }, verifyMs[2] = { 0, 0 };
+		for (int prefixed = 0; prefixed < 2; prefixed++) {
+			zkboo_params params = { 0 };
+			int inputLen = lengths[i];
+			if (prefixed) {
+				params.prefix = message;
+				params.prefixLen = lengths[i] - secretLen;
+				inputLen = secretLen;
+			}
+			zkboo_ctx_set_prefix(ctx, params.prefix, params.prefixLen);
+			for (int r = 0; r < repeats; r++) {
+				struct timespec begin, middle, end;
+				clock_gettime(CLOCK_MONOTONIC, &begin);
+				failures += zkboo_prove_sha256(ctx, message + lengths[i] - inputLen, inputLen, &params, &proof) != ZKBOO_OK;
+				clock_gettime(CLOCK_MONOTONIC, &middle);
+				failures += zkboo_verify_sha256(ctx, proof.data, proof.size, NULL) != ZKBOO_OK;
+				clock_gettime(CLOCK_MONOTONIC, &end);
+				proveMs[prefixed] += benchMicros(begin, middle) / 1e3 / repeats;
+				verifyMs[prefixed] += benchMicros(middle, end) / 1e3 / repeats;
+			}
+			bytes[prefixed] = proof.size;
+		}
+		printf("	%4d bytes: prove %.1f / %.1f, verify %.1f / %.1f, %zu / %zu bytes%s\n", lengths[i], proveMs[0], proveMs[1],
+				verifyMs[0], verifyMs[1], bytes[0], bytes[1], failures ? " (did not verify!)" : "");
+	}
+	zkboo_buffer_free(ctx, &proof);
+	zkboo_ctx_free(ctx);
+	free(message);
+}
+
+//Proofs of hash chains of a 32 byte secret, one more block per application
+void benchChain(void) {
+	int chains[] = { 1, 2, 4, 16 }, inputLen = 32, repeats = 3;
+	unsigned char input[32];
+	for (int i = 0; i < inputLen; i++) {
+		input[i] = rand();
+	}
+	zkboo_ctx* ctx = zkboo_ctx_new(NULL, 0);
+	zkboo_buffer proof = { 0 };
+	printf("Hash chains (ms per %d-round proof of SHA-256 applied n times to %d secret bytes, all threads)\n", NUM_ROUNDS, inputLen);
+	for (size_t i = 0; i < sizeof(chains) / sizeof(chains[0]); i++) {
+		zkboo_params params = { 0 };
+		params.chain = chains[i];
+		zkboo_ctx_set_chain(ctx, chains[i]);
+		int failures = 0;
+		double proveMs = 0, verifyMs = 0;
+		for (int r = 0; r < repeats; r++) {
+			struct timespec begin, middle, end;
+			zkboo_result result;
+			clock_gettime(CLOCK_MONOTONIC, &begin);
+			failures += zkboo_prove_sha256(ctx, input, inputLen, &params, &proof) != ZKBOO_OK;
+			clock_gettime(CLOCK_MONOTONIC, &middle);
+			failures += zkboo_verify_sha256(ctx, proof.data, proof.size, &result) != ZKBOO_OK || result.params.chain != chains[i];
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			proveMs += benchMicros(begin, middle) / 1e3 / repeats;
+			verifyMs += benchMicros(middle, end) / 1e3 / repeats;
+		}
+		printf("	n = %2d: prove %.1f, verify %.1f, %zu bytes%s\n", chains[i], proveMs, verifyMs, proof.size, failures ? " (did not verify!)" : "");
+	}
+	zkboo_buffer_free(ctx, &proof);
+	zkboo_ctx_free(ctx);
+}
+
+//HMAC-SHA256 against SHA-256 of the key followed by the message, about its inner hash. The HMAC
+//pads the key to a block of its own and adds the outer key block and final block.
+void benchHmac(void) {
+	int messageLens[] = { 32, 200, 1000 }, keyLen = 32, repeats = 3;
+	unsigned char key[32], message[1000];
+	for (int i = 0; i < keyLen; i++) {
+		key[i] = rand();
+	}
+	for (int i = 0; i < 1000; i++) {
+		message[i] = rand();
+	}
+	zkboo_ctx* ctx = zkboo_ctx_new(NULL, 0);
+	zkboo_buffer proof = { 0 };
+	printf("HMAC (ms per %d-round proof keyed by %d secret bytes, all threads)\n", NUM_ROUNDS, keyLen);
+	for (size_t i = 0; i < sizeof(messageLens) / sizeof(messageLens[0]); i++) {
+		for (int hmac = 0; hmac < 2; hmac++) {
+			unsigned char input[32 + 1000];
+			zkboo_params params = { 0 };
+			params.hmac = hmac;
+			zkboo_ctx_set_hmac(ctx, hmac);
+			if (hmac) {
+				params.prefix = message;
+				params.prefixLen = messageLens[i];
+				zkboo_ctx_set_prefix(ctx, message, messageLens[i]);
+			} else {
+				memcpy(input, key, keyLen);
+				memcpy(input + keyLen, message, messageLens[i]);
+				zkboo_ctx_set_prefix(ctx, NULL, 0);
+			}
+			int inputLen = hmac ? keyLen : keyLen + messageLens[i];
+			int failures = 0;
+			double proveMs = 0, verifyMs = 0;
+			for (int r = 0; r < repeats; r++) {
+				struct timespec begin, middle, end;
+				zkboo_result result;
+				clock_gettime(CLOCK_MONOTONIC, &begin);
+				failures += zkboo_prove_sha256(ctx, hmac ? key : input, inputLen, &params, &proof) != ZKBOO_OK;
+				clock_gettime(CLOCK_MONOTONIC, &middle);
+				failures += zkboo_verify_sha256(ctx, proof.data, proof.size, &result) != ZKBOO_OK || result.params.hmac != hmac;
+				clock_gettime(CLOCK_MONOTONIC, &end);
+				proveMs += benchMicros(begin, middle) / 1e3 / repeats;
+				verifyMs += benchMicros(middle, end) / 1e3 / repeats;
+			}
+			printf("	%4d byte message, %s: prove %.1f, verify %.1f, %zu bytes%s\n", messageLens[i], hmac ? "HMAC       " : "inner hash ",
+					proveMs, verifyMs, proof.size, failures ? " (did not verify!)" : "");
+		}
+	}
+	zkboo_buffer_free(ctx, &proof);
+	zkboo_ctx_free(ctx);
+}
+
+//Proofs whose header is changed after they were made to claim another statement: another
+//input length, gates on public values not computed in the clear, another hash chain length, an
+//HMAC instead of a hash. Each change gives another challenge digest, and no changed proof
+//verifies, on a context that expects the statement it claims.
+void benchStatement(void) {
+	const unsigned char input[] = "hello world", prefix[] = "public prefix";
+	int inputLen = sizeof(input) - 1, prefixLen = sizeof(prefix) - 1;
+	const char* names[4] = { "input length", "public gates", "chain length", "HMAC" };
+	printf("Proofs with a changed statement (challenge digest, verify status)\n");
+
+	ProofParams base = { defaultBackends, 0, inputLen, 1, prefix, prefixLen, 1, 0 };
+	ProofParams changed[4] = { base, base, base, base };
+	changed[0].inputLen++;
+	changed[1].publicGates = 0;
+	changed[2].rehashes++;
+	changed[3].hmac = 1;
+	a* as = malloc(sizeof(a) * NUM_ROUNDS);
+	uint32_t y[8];
+	for (size_t i = 0; i < sizeof(a) * NUM_ROUNDS; i++) ((unsigned char*)as)[i] = rand();
+	for (int i = 0; i < 8; i++) y[i] = rand();
+	unsigned char digest[SHA256_DIGEST_LENGTH], changedDigest[SHA256_DIGEST_LENGTH];
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, defaultBackends);
+	challengeDigest(&crypto, &base, y, as, NUM_ROUNDS, digest);
+
+	zkboo_ctx* ctx = zkboo_ctx_new(NULL, 0);
+	zkboo_buffer proof = { 0 };
+	zkboo_params params = { 0 };
+	params.prefix = prefix;
+	params.prefixLen = prefixLen;
+	params.chain = 2;
+	int failures = 0;
+	if (zkboo_prove_sha256(ctx, input, inputLen, &params, &proof) != ZKBOO_OK) {
+		printf("	Unable to prove\n");
+		proof.size = 0;
+	}
+	unsigned char* copy = malloc(proof.size);
+	for (int i = 0; i < 4 && proof.size > 0; i++) {
+		challengeDigest(&crypto, &changed[i], y, as, NUM_ROUNDS, changedDigest);
+		int same = memcmp(digest, changedDigest, SHA256_DIGEST_LENGTH) == 0;
+
+		memcpy(copy, proof.data, proof.size);
+		containerHeader* header = (containerHeader*)copy;
+		switch (i) {
+		case 0: header->inputLen++; break;
+		case 1: header->flags &= ~CONTAINER_PUBLIC_GATES; break;
+		case 2: header->rehashes++; break;
+		default: header->flags |= CONTAINER_HMAC; break;
+		}
+		zkboo_ctx_set_prefix(ctx, prefix, prefixLen);
+		zkboo_ctx_set_chain(ctx, header->rehashes + 1);
+		zkboo_ctx_set_hmac(ctx, (header->flags & CONTAINER_HMAC) != 0);
+		zkboo_result result;
+		zkboo_status status = zkboo_verify_sha256(ctx, copy, proof.size, &result);
+		failures += same || status == ZKBOO_OK;
+		printf("	%-13s %s, %s%s%s%s\n", names[i], same ? "unchanged!" : "changed", zkboo_status_string(status),
+				status == ZKBOO_NOT_VERIFIED ? " (" : "", status == ZKBOO_NOT_VERIFIED ? result.reason : "", status == ZKBOO_NOT_VERIFIED ? ")" : "");
+	}
+	if (failures != 0) {
+		printf("	%d changed proofs verified or kept their challenges!\n", failures);
+	}
+	cleanupCryptoCtx(&crypto);
+	free(copy);
+	free(as);
+	zkboo_buffer_free(ctx, &proof);
+	zkboo_ctx_free(ctx);
+}
+
+int main(void) {
+	setbuf(stdout, NULL);
+	srand(1);
+	init_EVP();
+	planMessage(32, 1, &benchPlans);
+
+	benchADD();
+	benchKernels();
+	benchTapes();
+	benchCommitHashes();
+	benchCommitHash();
+	benchVerify();
+	benchBackends();
+	benchCompact();
+	benchOutput();
+	benchRounds();
+	benchPublicGates();
+	benchBlocks();
+	benchPrefix();
+	benchChain();
+	benchHmac();
+	benchStatement();
+
+	cleanup_EVP();
+	return EXIT_SUCCESS;
+}
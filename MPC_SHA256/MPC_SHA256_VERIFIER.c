@@ -7,73 +7,198 @@
  ============================================================================
  */
 
-#include <stdbool.h>
+#include <fcntl.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-#include "shared.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "zkboo.h"
 
-int NUM_ROUNDS = 136;
-
-// void printbits(uint32_t n) {
-// 	if (n) {
-// 		printbits(n >> 1);
-// 		printf("%d", n & 1);
-// 	}
-// }
-
-
-
-int main(void) {
-	setbuf(stdout, NULL);
-	init_EVP();
-	openmp_thread_setup();
-
-	printf("Iterations of SHA: %d\n", NUM_ROUNDS);
-	
-	a as[NUM_ROUNDS];
-	z zs[NUM_ROUNDS];
-
-	//Read all as and zs from file
-	FILE *file;
-	char outputFile[NUM_BRANCHES * sizeof(int) + 8];
-	sprintf(outputFile, "out%i.bin", NUM_ROUNDS);
-	file = fopen(outputFile, "rb");
-	if (!file) {
-		printf("Unable to open file!");
-	}
-	fread(&as, sizeof(a), NUM_ROUNDS, file);
-	fread(&zs, sizeof(z), NUM_ROUNDS, file);
-	fclose(file);
-
-	uint32_t y[8]; //contains hash
-
-	reconstruct( //xoring yps will get result = y = hash
-		as[0].yp[0],
-		as[0].yp[1],
-		as[0].yp[2],
-		y);
+//Reads up to maxBytes + 1 bytes of the file at path into a new buffer, so that a file that is
+//too long can be told. NULL if it cannot be read.
+unsigned char* readPrefix(const char* path, size_t maxBytes, size_t* len) {
+	FILE* file = fopen(path, "rb");
+	unsigned char* data = file ? malloc(maxBytes + 1) : NULL;
+	if (data) {
+		*len = fread(data, 1, maxBytes + 1, file);
+	}
+	if (file) {
+		fclose(file);
+	}
+	return data;
+}
 
+//Prints the outcome of verifying a proof that needs minRounds rounds and returns main's exit status
+int report(zkboo_status status, const zkboo_result* result, int minRounds) {
+	if (status == ZKBOO_WRONG_ROUNDS) {
+		printf("The proof has %d rounds, expected %d to %d\n", result->rounds, minRounds, ZKBOO_MAX_ROUNDS);
+		return EXIT_FAILURE;
+	}
+	if (status == ZKBOO_OTHER_CIRCUIT) {
+		printf("SHA-1 proof, verify it with MPC_SHA1_VERIFIER\n");
+		return EXIT_FAILURE;
+	}
+	if (status == ZKBOO_BAD_PROOF) {
+		printf("Unrecognised proof file\n");
+		return EXIT_FAILURE;
+	}
+	if (status != ZKBOO_OK && status != ZKBOO_NOT_VERIFIED) {
+		printf("Unable to verify: %s\n", zkboo_status_string(status));
+		return EXIT_FAILURE;
+	}
+	printf("Iterations of SHA: %d (%.1f bits)\n", result->rounds, zkboo_soundness_bits(result->rounds));
+	if (result->params.prg != ZKBOO_PRG_AES_CTR || result->params.hash != ZKBOO_HASH_SHA256) {
+		printf("Tape PRG: %s, hash: %s\n", zkboo_prg_name(result->params.prg), zkboo_hash_name(result->params.hash));
+	}
+	if (result->params.hmac) {
+		printf("HMAC message length: %zu\n", result->params.prefixLen);
+	} else if (result->params.prefixLen > 0) {
+		printf("Public prefix length: %zu\n", result->params.prefixLen);
+	}
+	if (result->params.chain > 1) {
+		printf("Hash chain length: %d\n", result->params.chain);
+	}
 	printf("Proof for hash: ");
-	for(int i=0;i<8;i++) {
-		printf("%02x", y[i]);
+	for(int i=0;i<result->hashWords;i++) {
+		printf("%02x", result->hash[i]);
 	}
 	printf("\n");
+	if (status == ZKBOO_OK) {
+		printf("Verified\n");
+	} else if (result->params.compact || result->failedRound < 0) {
+		printf("Not Verified: %s\n", result->reason);
+	} else {
+		printf("Not Verified %d: %s\n", result->failedRound, result->reason);
+	}
+	return status == ZKBOO_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
-	int es[NUM_ROUNDS];
-	calculateEs(y, as, NUM_ROUNDS, es); //calculate Es for all rounds
+//Verifies the proof in the file at path in place through mmap, a SHA-1 proof included.
+//Rounds are only paged in as they are verified.
+int verifyMapped(zkboo_ctx* ctx, const char* path, int minRounds) {
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		printf("Unable to open file!\n");
+		return EXIT_FAILURE;
+	}
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		printf("Unable to open file!\n");
+		return EXIT_FAILURE;
+	}
+	madvise(data, st.st_size, MADV_WILLNEED);
 
+	zkboo_result result;
+	zkboo_status status = zkboo_verify_sha256(ctx, data, st.st_size, &result);
+	if (status == ZKBOO_OTHER_CIRCUIT && result.circuit == ZKBOO_SHA1) {
+		printf("SHA-1 proof\n");
+		status = zkboo_verify_sha1(ctx, data, st.st_size, &result);
+	}
+	munmap(data, st.st_size);
+	return report(status, &result, minRounds);
+}
 
-//	#pragma omp parallel for
-	for(int round = 0; round<NUM_ROUNDS; round++) { //verify each round
-		int verifyResult = verifyRound(as[round], es[round], zs[round]); //call verify for each round
-		if (verifyResult != 0) {
-			printf("Not Verified %d\n", round);
+int main(int argc, char* argv[]) {
+	setbuf(stdout, NULL);
+	int streaming = 0; //-s: verify while reading instead of mapping the file
+	int minRounds = ZKBOO_DEFAULT_ROUNDS; //-r and -b
+	const char* path = NULL;
+	const char* prefixFile = NULL; //-P or -M
+	int hmac = 0; //-M
+	int chain = 1; //-n
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-s") == 0) {
+			streaming = 1;
+		} else if ((strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "-M") == 0) && i + 1 < argc) {
+			hmac = strcmp(argv[i], "-M") == 0;
+			prefixFile = argv[++i];
+		} else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			chain = atoi(argv[++i]);
+			minRounds = chain >= 1 && chain <= ZKBOO_MAX_CHAIN ? minRounds : -1;
+		} else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			minRounds = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			minRounds = zkboo_rounds_for_soundness(atoi(argv[++i]));
+		} else if (!path) {
+			path = argv[i];
+		} else {
+			minRounds = -1;
+		}
+		if (minRounds < 1 || minRounds > ZKBOO_MAX_ROUNDS) {
+			printf("Usage: %s [-s] [-r rounds | -b bits] [-P prefix file | -M message file] [-n count] [proof file, - for stdin]\n", argv[0]);
+			printf("  -s  verify rounds as they are read instead of mapping the whole file\n");
+			printf("  -P  the public prefix the proof must be for, made with MPC_SHA256 -P\n");
+			printf("  -M  the HMAC message the proof must be for, made with MPC_SHA256 -M\n");
+			printf("  -n  the hash chain length the proof must be for, made with MPC_SHA256 -n, 1 by default\n");
+			printf("  -r  the fewest rounds to accept, %d by default\n", ZKBOO_DEFAULT_ROUNDS);
+			printf("  -b  accept no more than a 2^-bits chance that a false proof verifies\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	char outputFile[3 * sizeof(int) + 8];
+	sprintf(outputFile, "out%i.bin", minRounds);
+	if (!path) {
+		path = outputFile;
+	}
+	//verify all rounds in parallel, OMP_NUM_THREADS picks the thread count
+	zkboo_ctx* ctx = zkboo_ctx_new(NULL, 0);
+	if (!ctx) {
+		printf("Out of memory\n");
+		return EXIT_FAILURE;
+	}
+	zkboo_ctx_set_min_rounds(ctx, minRounds);
+	zkboo_ctx_set_chain(ctx, chain);
+	zkboo_ctx_set_hmac(ctx, hmac);
+	if (prefixFile) {
+		size_t prefixLen = 0;
+		unsigned char* prefix = readPrefix(prefixFile, ZKBOO_MAX_PREFIX, &prefixLen);
+		zkboo_status status = prefix ? zkboo_ctx_set_prefix(ctx, prefix, prefixLen) : ZKBOO_IO_ERROR;
+		free(prefix);
+		if (status != ZKBOO_OK) {
+			printf("Unable to use prefix file %s: %s\n", prefixFile, zkboo_status_string(status));
+			zkboo_ctx_free(ctx);
+			return EXIT_FAILURE;
+		}
+	}
+	//Pipes and stdin cannot be mapped, they are always streamed
+	struct stat st;
+	int fromStdin = strcmp(path, "-") == 0;
+	int exists = !fromStdin && stat(path, &st) == 0;
+	int regular = exists && S_ISREG(st.st_mode);
+	if (fromStdin || (exists && !regular)) {
+		streaming = 1;
+	}
+	int ret;
+	if (streaming) {
+		FILE* file = fromStdin ? stdin : fopen(path, "rb");
+		if (!file) {
+			printf("Unable to open file!\n");
+			zkboo_ctx_free(ctx);
+			return EXIT_FAILURE;
+		}
+		zkboo_result result;
+		zkboo_status status = zkboo_verify_sha256_stream(ctx, file, &result);
+		if (!fromStdin) {
+			fclose(file);
+		}
+		//SHA-1 proofs cannot be streamed, but a file can still be mapped
+		if (status == ZKBOO_OTHER_CIRCUIT && result.circuit == ZKBOO_SHA1 && regular) {
+			ret = verifyMapped(ctx, path, minRounds);
+		} else {
+			ret = report(status, &result, minRounds);
 		}
+	} else {
+		ret = verifyMapped(ctx, path, minRounds);
 	}
-	openmp_thread_cleanup();
-	cleanup_EVP();
-	return EXIT_SUCCESS;
+	zkboo_ctx_free(ctx);
+	return ret;
 }
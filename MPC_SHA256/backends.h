@@ -0,0 +1,74 @@
+ /*
+ ============================================================================
+ Name        : backends.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : Tape PRG and commitment hash choices a proof can be made with
+ ============================================================================
+ */
+
+/*
+ * Included by shared.h before CryptoCtx. A proof is made with one tape PRG
+ * and one hash, the hash being used for the branch commitments and for
+ * the Fiat-Shamir challenges. The pair is recorded in the header of the
+ * proof file (container.h), so the verifier uses the same one.
+ *
+ * The PRGs are implemented in tapes.h and the hashes in shared.h, all
+ * dispatching on the Backends of the thread's CryptoCtx.
+ */
+
+#ifndef BACKENDS_H_
+#define BACKENDS_H_
+
+typedef enum {
+	PRG_AES_CTR, //AES-128-CTR under the branch key, the original tapes
+	PRG_FIXED_AES, //AES-128 under a public key in Matyas-Meyer-Oseas mode over key ^ counter
+	PRG_CHACHA20, //ChaCha20 under the branch key padded to 256 bits
+	PRG_SHAKE128, //SHAKE128 of the branch key and the index of each 256 byte segment
+	NUM_PRGS
+} PrgId;
+
+typedef enum {
+	HASH_SHA256,
+	HASH_SHA3_256,
+	HASH_TREE, //BLAKE3-style tree: BLAKE2s-256 of 1 KB chunks, then of their chaining values
+	NUM_HASHES
+} HashId;
+
+typedef struct {
+	PrgId prg;
+	HashId hash;
+} Backends;
+
+static const Backends defaultBackends = { PRG_AES_CTR, HASH_SHA256 };
+
+static const char* const prgNames[NUM_PRGS] = { "aes-ctr", "fixed-aes", "chacha20", "shake128" };
+static const char* const hashNames[NUM_HASHES] = { "sha256", "sha3-256", "tree" };
+
+//Index of name in names, or -1
+int backendByName(const char* const names[], int count, const char* name) {
+	for (int i = 0; i < count; i++) {
+		if (strcmp(names[i], name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int isDefaultBackends(Backends backends) {
+	return backends.prg == defaultBackends.prg && backends.hash == defaultBackends.hash;
+}
+
+//What a proof is made with, all recorded in its file
+typedef struct {
+	Backends backends;
+	int compact; //ZKB++ openings, see zkbpp.h
+	int inputLen; //bytes of the hashed input, recorded for compact proofs and with publicGates
+	int publicGates; //gates on public values are computed in the clear, see planBlockGates
+	const unsigned char* prefix; //public bytes hashed ahead of the input, stored in the proof
+	int prefixLen;
+	int rehashes; //times the digest is hashed again, see planChain
+	int hmac; //HMAC-SHA256 keyed by the input of the message in prefix, see planHmac
+} ProofParams;
+
+#endif /* BACKENDS_H_ */
@@ -1,6 +1,8 @@
 #!/bin/bash
 rm MPC_SHA256
 rm MPC_SHA256_VERIFIER
-gcc -Wall -g MPC_SHA256.c -fopenmp -lcrypto -o MPC_SHA256
-gcc -Wall -g MPC_SHA256_VERIFIER.c -fopenmp -lcrypto -o MPC_SHA256_VERIFIER
-
+rm MPC_SHA256_BENCH
+bash ../libzkboo/build.sh || exit 1
+gcc -Wall -g -O2 MPC_SHA256.c -I../libzkboo ../libzkboo/libzkboo.a -fopenmp -lcrypto -o MPC_SHA256
+gcc -Wall -g -O2 MPC_SHA256_VERIFIER.c -I../libzkboo ../libzkboo/libzkboo.a -fopenmp -lcrypto -o MPC_SHA256_VERIFIER
+gcc -Wall -g -O2 MPC_SHA256_BENCH.c ../libzkboo/zkboo.c -I../libzkboo -fopenmp -lcrypto -o MPC_SHA256_BENCH
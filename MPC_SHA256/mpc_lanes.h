@@ -0,0 +1,200 @@
+ /*
+ ============================================================================
+ Name        : mpc_lanes.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : Round-parallel MPC SHA256, one proof round per vector lane
+ ============================================================================
+ */
+
+/*
+ * This file is included once per vector width by prover.h with
+ * LANES (rounds per vector) and LANE_TARGET (gcc target string) defined.
+ * Every round runs the exact same gates of sha256Circuit, and the same gates
+ * are local in all of them as they share one gate plan, so lane l of every
+ * value below belongs to round first+l and the views written are
+ * bit-identical to the ones compressBlock() produces for that round.
+ */
+
+#if !defined(LANES) || !defined(LANE_TARGET)
+#error "mpc_lanes.h needs LANES and LANE_TARGET"
+#endif
+
+#define LANE_CAT_(name, n) name##_x##n
+#define LANE_CAT(name, n) LANE_CAT_(name, n)
+#define LANE_FN(name) LANE_CAT(name, LANES)
+#define LANE_T LANE_FN(lanes)
+#define LANE_INLINE static inline __attribute__ ((always_inline, target(LANE_TARGET)))
+
+typedef uint32_t LANE_T __attribute__ ((vector_size (LANES * 4)));
+
+typedef struct {
+	Tape (*tapes)[NUM_BRANCHES]; //tapes[lane][branch], read in lockstep
+	View (*views)[NUM_BRANCHES]; //views[lane][branch]
+	int randCount;
+	int countY;
+} LANE_FN(laneState);
+
+LANE_INLINE void LANE_FN(getRandomLanes)(LANE_FN(laneState)* s, LANE_T r[NUM_BRANCHES]) {
+	//All LANES * NUM_BRANCHES tapes run out together and are refilled in one interleaved batch
+	if (tapeMissing(&s->tapes[0][0], s->randCount)) {
+		tapeFill(LANES * NUM_BRANCHES, &s->tapes[0][0], s->randCount);
+	}
+	for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+		for (int lane = 0; lane < LANES; lane++) {
+			r[branch][lane] = tapeGet32(&s->tapes[lane][branch], s->randCount);
+		}
+	}
+	s->randCount += 4;
+}
+
+LANE_INLINE void LANE_FN(storeViewLanes)(LANE_FN(laneState)* s, LANE_T v[NUM_BRANCHES]) {
+	for (int lane = 0; lane < LANES; lane++) {
+		s->views[lane][0].y[s->countY] = v[0][lane];
+		s->views[lane][1].y[s->countY] = v[1][lane];
+		s->views[lane][2].y[s->countY] = v[2][lane];
+	}
+	s->countY++;
+}
+
+LANE_INLINE void LANE_FN(mpc_AND)(const LANE_T x[NUM_BRANCHES], const LANE_T y[NUM_BRANCHES], LANE_T z[NUM_BRANCHES], LANE_FN(laneState)* s) {
+	LANE_T r[NUM_BRANCHES];
+	LANE_FN(getRandomLanes)(s, r);
+
+	z[0] = (x[0] & y[1]) ^ (x[1] & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
+	z[1] = (x[1] & y[2]) ^ (x[2] & y[1]) ^ (x[1] & y[1]) ^ r[1] ^ r[2];
+	z[2] = (x[2] & y[0]) ^ (x[0] & y[2]) ^ (x[2] & y[2]) ^ r[2] ^ r[0];
+	LANE_FN(storeViewLanes)(s, z);
+}
+
+//Same carry recurrence as mpc_ADD_carries, with a round in every lane: bit i of t is the new
+//carry bit i+1, and bits above i+1 of c are still zero when it is set.
+LANE_INLINE void LANE_FN(mpc_ADD)(const LANE_T x[NUM_BRANCHES], const LANE_T y[NUM_BRANCHES], LANE_T z[NUM_BRANCHES], LANE_FN(laneState)* s) {
+	LANE_T r[NUM_BRANCHES];
+	LANE_FN(getRandomLanes)(s, r);
+
+	LANE_T c[NUM_BRANCHES] = { 0 };
+	LANE_T a[NUM_BRANCHES], b[NUM_BRANCHES], t[NUM_BRANCHES];
+	for (int i = 0; i < 31; i++) {
+		a[0] = x[0] ^ c[0];
+		a[1] = x[1] ^ c[1];
+		a[2] = x[2] ^ c[2];
+
+		b[0] = y[0] ^ c[0];
+		b[1] = y[1] ^ c[1];
+		b[2] = y[2] ^ c[2];
+
+		t[0] = (a[0] & b[1]) ^ (a[1] & b[0]) ^ (a[0] & b[0]) ^ c[0] ^ r[0] ^ r[1];
+		t[1] = (a[1] & b[2]) ^ (a[2] & b[1]) ^ (a[1] & b[1]) ^ c[1] ^ r[1] ^ r[2];
+		t[2] = (a[2] & b[0]) ^ (a[0] & b[2]) ^ (a[2] & b[2]) ^ c[2] ^ r[2] ^ r[0];
+
+		c[0] |= (t[0] << 1) & (2u << i);
+		c[1] |= (t[1] << 1) & (2u << i);
+		c[2] |= (t[2] << 1) & (2u << i);
+	}
+
+	z[0] = x[0] ^ y[0] ^ c[0];
+	z[1] = x[1] ^ y[1] ^ c[1];
+	z[2] = x[2] ^ y[2] ^ c[2];
+	LANE_FN(storeViewLanes)(s, c);
+}
+
+//Runs compressBlock() for the LANES rounds starting at tapes/views: circuitProve with a round
+//in every lane
+static void __attribute__ ((target(LANE_TARGET))) LANE_FN(compressLanes)(Tape tapes[][NUM_BRANCHES], View views[][NUM_BRANCHES], const gatePlan* plan) {
+	LANE_FN(laneState) s = { tapes, views, 0, 0 };
+	const circuit* c = sha256Circuit();
+
+	LANE_T regs[c->registers][NUM_BRANCHES];
+	for (int lane = 0; lane < LANES; lane++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			const unsigned char* chunk = views[lane][branch].x;
+			for (int j = 0; j < 16; j++) {
+				regs[j][branch][lane] = (chunk[j * 4] << 24) | (chunk[j * 4 + 1] << 16) | (chunk[j * 4 + 2] << 8) | chunk[j * 4 + 3];
+			}
+			for (int i = 0; i < 8; i++) {
+				regs[SHA256_STATE_REGISTER + i][branch][lane] = plan->chained ? views[lane][branch].y[NUM_GATES + i] : plan->iv[i];
+			}
+		}
+	}
+
+	int gate = 0;
+	for (int i = 0; i < c->gates; i++) {
+		const circuitGate* g = &c->gate[i];
+		LANE_T* x = regs[g->x];
+		LANE_T* y = regs[g->y];
+		LANE_T* w = regs[g->w];
+		LANE_T t[NUM_BRANCHES], u[NUM_BRANCHES];
+		switch ((circuitOp)g->op) {
+		case CIRCUIT_XOR:
+			for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+				t[branch] = x[branch] ^ y[branch];
+			}
+			break;
+		case CIRCUIT_NOT:
+			for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+				t[branch] = ~x[branch];
+			}
+			break;
+		case CIRCUIT_ROTR:
+			for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+				t[branch] = (x[branch] >> g->bits) | (x[branch] << ((32 - g->bits) & 31));
+			}
+			break;
+		case CIRCUIT_SHR:
+			for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+				t[branch] = x[branch] >> g->bits;
+			}
+			break;
+		default:
+			if (g->op == CIRCUIT_ADDK) {
+				u[0] = (LANE_T) { 0 } + g->k;
+				u[1] = u[0];
+				u[2] = u[0];
+				y = u;
+			}
+			if (plan->local[gate++]) {
+				for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+					switch ((circuitOp)g->op) {
+					case CIRCUIT_AND: t[branch] = x[branch] & y[branch]; break;
+					case CIRCUIT_MAJ: t[branch] = (x[branch] & (y[branch] ^ w[branch])) ^ (y[branch] & w[branch]); break;
+					default: t[branch] = x[branch] + y[branch]; break;
+					}
+				}
+			} else if (g->op == CIRCUIT_AND) {
+				LANE_FN(mpc_AND)(x, y, t, &s);
+			} else if (g->op == CIRCUIT_MAJ) { //(x ^ y) & (x ^ w) ^ x
+				LANE_T t0[NUM_BRANCHES], t1[NUM_BRANCHES];
+				for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+					t0[branch] = x[branch] ^ y[branch];
+					t1[branch] = x[branch] ^ w[branch];
+				}
+				LANE_FN(mpc_AND)(t0, t1, t, &s);
+				for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+					t[branch] ^= x[branch];
+				}
+			} else {
+				LANE_FN(mpc_ADD)(x, y, t, &s);
+			}
+			break;
+		}
+		memcpy(regs[g->z], t, sizeof(t));
+	}
+
+	//Last 8 y are the output shares, exactly as compressBlock() stores them after zeroing the unused words
+	for (int lane = 0; lane < LANES; lane++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			memset(&views[lane][branch].y[s.countY], 0, sizeof(uint32_t) * (NUM_GATES - s.countY));
+		}
+	}
+	s.countY = NUM_GATES;
+	for (int i = 0; i < 8; i++) {
+		LANE_FN(storeViewLanes)(&s, regs[c->output[i]]);
+	}
+}
+
+#undef LANE_INLINE
+#undef LANE_T
+#undef LANE_FN
+#undef LANE_CAT
+#undef LANE_CAT_
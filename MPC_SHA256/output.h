@@ -0,0 +1,218 @@
+ /*
+ ============================================================================
+ Name        : output.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : Scatter-gather output of proofs straight from the prover's buffers
+ ============================================================================
+ */
+
+/*
+ * Included by prover.h. A proofWriter collects pointers to the parts of
+ * a proof where they already are (keys, views, rs, commitments) and writes
+ * them with writev, so that openings are never assembled into z or zCompact
+ * structs first. Everything added must stay in place until the next
+ * writerFlush, which happens by itself once OUTPUT_IOVECS parts are queued.
+ * Parts that directly follow the previous one in memory, such as the keys
+ * of branches e and e+1, are merged into one iovec.
+ *
+ * A writer without a file descriptor copies the parts into a buffer
+ * instead, which its reserve callback hands out once writerBegin says how
+ * large the proof is.
+ *
+ * Proofs of several blocks have every round's views written block by
+ * block, so their openings are written out of order by writerWriteAt, at
+ * their offset in the proof, which needs a file that can seek.
+ */
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <errno.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define OUTPUT_IOVECS 1024 //IOV_MAX on Linux
+
+typedef struct {
+	int fd; //-1 to write into a buffer
+	off_t base; //file offset the proof starts at, -1 if fd cannot seek
+	struct iovec iov[OUTPUT_IOVECS];
+	int count;
+	int failed;
+	unsigned char* (*reserve)(void* opaque, size_t bytes); //gives the buffer, NULL when out of memory
+	void* opaque;
+	unsigned char* buffer;
+	size_t offset;
+	size_t capacity;
+} proofWriter;
+
+void writerInit(proofWriter* writer, int fd) {
+	writer->fd = fd;
+	writer->base = fd >= 0 ? lseek(fd, 0, SEEK_CUR) : 0;
+	writer->count = 0;
+	writer->failed = 0;
+	writer->reserve = NULL;
+	writer->opaque = NULL;
+	writer->buffer = NULL;
+	writer->offset = 0;
+	writer->capacity = 0;
+}
+
+void writerInitBuffer(proofWriter* writer, unsigned char* (*reserve)(void* opaque, size_t bytes), void* opaque) {
+	writerInit(writer, -1);
+	writer->reserve = reserve;
+	writer->opaque = opaque;
+}
+
+//Says the whole proof is bytes long, before anything is added. Returns 0 on success.
+int writerBegin(proofWriter* writer, size_t bytes) {
+	if (writer->fd < 0 && !writer->failed) {
+		writer->buffer = writer->reserve(writer->opaque, bytes);
+		writer->capacity = writer->buffer ? bytes : 0;
+		writer->failed = writer->buffer == NULL;
+	}
+	return writer->failed;
+}
+
+//Writes everything queued, going on after partial writes. Returns 0 on success.
+int writerFlush(proofWriter* writer) {
+	struct iovec* iov = writer->iov;
+	int count = writer->count;
+	writer->count = 0;
+	if (writer->fd < 0) {
+		for (int i = 0; i < count && !writer->failed; i++) {
+			if (iov[i].iov_len > writer->capacity - writer->offset) {
+				writer->failed = 1;
+				break;
+			}
+			memcpy(writer->buffer + writer->offset, iov[i].iov_base, iov[i].iov_len);
+			writer->offset += iov[i].iov_len;
+		}
+		return writer->failed;
+	}
+	while (count > 0 && !writer->failed) {
+		ssize_t written = writev(writer->fd, iov, count);
+		if (written < 0) {
+			if (errno != EINTR) {
+				writer->failed = 1;
+			}
+			continue;
+		}
+		while (count > 0 && (size_t)written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0) {
+			iov->iov_base = (char*)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+	return writer->failed;
+}
+
+void writerAdd(proofWriter* writer, const void* data, size_t bytes) {
+	if (bytes == 0) {
+		return;
+	}
+	if (writer->count > 0) {
+		struct iovec* last = &writer->iov[writer->count - 1];
+		if ((const char*)last->iov_base + last->iov_len == (const char*)data) {
+			last->iov_len += bytes;
+			return;
+		}
+	}
+	if (writer->count == OUTPUT_IOVECS) {
+		writerFlush(writer);
+	}
+	writer->iov[writer->count].iov_base = (void*)data;
+	writer->iov[writer->count].iov_len = bytes;
+	writer->count++;
+}
+
+//Writes the count parts of iov at offset bytes into the proof, bypassing the queue. Positions
+//already written must not be queued again. Threads may write disjoint parts at the same time;
+//a failure is returned rather than recorded. Returns 0 on success.
+int writerWriteAt(const proofWriter* writer, uint64_t offset, const struct iovec* iov, int count) {
+	if (writer->fd < 0) {
+		for (int i = 0; i < count; i++) {
+			if (offset > writer->capacity || iov[i].iov_len > writer->capacity - offset) {
+				return 1;
+			}
+			memcpy(writer->buffer + offset, iov[i].iov_base, iov[i].iov_len);
+			offset += iov[i].iov_len;
+		}
+		return 0;
+	}
+	if (writer->base < 0) {
+		return 1;
+	}
+	struct iovec copy[OUTPUT_IOVECS];
+	struct iovec* left = copy;
+	memcpy(copy, iov, sizeof(struct iovec) * count);
+	while (count > 0) {
+		ssize_t written = pwritev(writer->fd, left, count, writer->base + offset);
+		if (written < 0) {
+			if (errno != EINTR) {
+				return 1;
+			}
+			continue;
+		}
+		offset += written;
+		while (count > 0 && (size_t)written >= left->iov_len) {
+			written -= left->iov_len;
+			left++;
+			count--;
+		}
+		if (count > 0) {
+			left->iov_base = (char*)left->iov_base + written;
+			left->iov_len -= written;
+		}
+	}
+	return 0;
+}
+
+//Moves on to offset bytes into the proof, past parts written by writerWriteAt, flushing first.
+//Returns 0 on success.
+int writerSkipTo(proofWriter* writer, uint64_t offset) {
+	if (writerFlush(writer) != 0) {
+		return 1;
+	}
+	if (writer->fd < 0) {
+		writer->offset = offset;
+	} else if (writer->base < 0 || lseek(writer->fd, writer->base + offset, SEEK_SET) < 0) {
+		writer->failed = 1;
+	}
+	return writer->failed;
+}
+
+//Zero bytes up to the next multiple of CONTAINER_ALIGN after bytes
+void writerPad(proofWriter* writer, size_t bytes) {
+	static const unsigned char zeros[CONTAINER_ALIGN] = { 0 };
+	writerAdd(writer, zeros, containerAlign(bytes) - bytes);
+}
+
+//The opening getProveOfTwoBranchesByE would give, in place
+void writerAddOpening(proofWriter* writer, int e, unsigned char keys[NUM_BRANCHES][16], unsigned char rs[NUM_BRANCHES][4], const View views[NUM_BRANCHES]) {
+	writerAdd(writer, keys[e], 16);
+	writerAdd(writer, keys[(e + 1) % NUM_BRANCHES], 16);
+	writerAdd(writer, &views[e], sizeof(View));
+	writerAdd(writer, &views[(e + 1) % NUM_BRANCHES], sizeof(View));
+	writerAdd(writer, rs[e], 4);
+	writerAdd(writer, rs[(e + 1) % NUM_BRANCHES], 4);
+}
+
+//The opening writeCompactOpening writes for getCompactProof, in place and padded
+void writerAddCompactOpening(proofWriter* writer, int e, const gatePlan* plan, unsigned char keys[NUM_BRANCHES][16], const View views[NUM_BRANCHES], const a* a) {
+	writerAdd(writer, keys[e], 16);
+	writerAdd(writer, keys[(e + 1) % NUM_BRANCHES], 16);
+	writerAdd(writer, a->h[(e + 2) % NUM_BRANCHES], 32);
+	writerAdd(writer, views[(e + 1) % NUM_BRANCHES].y, sizeof(uint32_t) * plan->words);
+	if (e != 0) {
+		writerAdd(writer, views[2].x + plan->secretFrom, plan->inputLen);
+	}
+	writerPad(writer, compactOpeningBytes(e, plan));
+}
+
+#endif /* OUTPUT_H_ */
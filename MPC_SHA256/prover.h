@@ -0,0 +1,504 @@
+ /*
+ ============================================================================
+ Name        : prover.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : MPC SHA256 prover
+ ============================================================================
+ */
+
+/*
+ * The prover side of the circuit: compressBlock, which runs sha256Circuit
+ * as the three parties, the commitments of batches of rounds and the two
+ * ways of writing out a proof, keeping every view (proveInMemory) or
+ * recomputing the opened ones (proveLowMemory). Inputs of several blocks and hash chains always
+ * take the second way, block by block (proveBlocks). zkboo_sha256.c draws
+ * the randomness and calls them, MPC_SHA256_BENCH.c times them one by one.
+ */
+
+#ifndef PROVER_H_
+#define PROVER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shared.h"
+#include "output.h"
+#include "omp.h"
+
+//Runs the compression of one block over the padded input shares in views[].x, from plan->iv or,
+//when plan->chained, from the output words the views hold of the block before. Leaves the
+//block's own output words, the shares of the next chaining value, in their place.
+void compressBlock(Tape tapes[NUM_BRANCHES], View views[NUM_BRANCHES], const gatePlan* plan) {
+	const circuit* c = sha256Circuit();
+	parties regs[CIRCUIT_MAX_REGISTERS];
+	for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+		const unsigned char* chunk = views[branch].x;
+		for (int j = 0; j < 16; j++) {
+			regs[j][branch] = (chunk[j * 4] << 24) | (chunk[j * 4 + 1] << 16) | (chunk[j * 4 + 2] << 8) | chunk[j * 4 + 3];
+		}
+		for (int i = 0; i < 8; i++) {
+			regs[SHA256_STATE_REGISTER + i][branch] = plan->chained ? views[branch].y[NUM_GATES + i] : plan->iv[i];
+		}
+	}
+
+	int countY = 0;
+	uint32_t* y[NUM_BRANCHES] = { views[0].y, views[1].y, views[2].y };
+	sha256ProveKernel(plan->local, regs, tapes, y, &countY);
+	//countY is now plan->words, the words up to NUM_GATES are left zero
+	for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+		memset(&views[branch].y[countY], 0, sizeof(uint32_t) * (NUM_GATES - countY));
+		for (int i = 0; i < 8; i++) {
+			views[branch].y[NUM_GATES + i] = regs[c->output[i]][branch];
+		}
+	}
+}
+
+//Runs an input of a single block, whose shares are shares
+a commit(int inputLen,unsigned char shares[NUM_BRANCHES][inputLen], Tape tapes[NUM_BRANCHES], View views[NUM_BRANCHES], const gatePlan* plan) {
+	for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+		paddedBlock(shares[branch], plan, 0, views[branch].x); //copy input (share) into x
+	}
+	compressBlock(tapes, views, plan);
+
+	a a;
+	memcpy(a.yp[0], &views[0].y[ySize - 8], 32);
+	memcpy(a.yp[1], &views[1].y[ySize - 8], 32);
+	memcpy(a.yp[2], &views[2].y[ySize - 8], 32);
+	return a;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LANES 8
+#define LANE_TARGET "avx2"
+#include "mpc_lanes.h"
+#undef LANE_TARGET
+#undef LANES
+
+#define LANES 16
+#define LANE_TARGET "avx512f"
+#include "mpc_lanes.h"
+#undef LANE_TARGET
+#undef LANES
+#endif
+
+//How many rounds commitRounds() should run side by side when remaining rounds are left:
+//16 with AVX-512, 8 with AVX2, otherwise 1. The first call detects the CPU, so make it
+//before starting any threads.
+#define MAX_COMMIT_BATCH 16
+int commitBatchSize(int remaining) {
+	static int lanes = 0;
+	if (lanes == 0) {
+		lanes = 1;
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_cpu_init();
+		lanes = __builtin_cpu_supports("avx512f") ? 16 : __builtin_cpu_supports("avx2") ? 8 : 1;
+#endif
+		debug_print("Committing %d rounds at a time.\n", lanes);
+	}
+	if (lanes >= 16 && remaining >= 16) {
+		return 16;
+	}
+	if (lanes >= 8 && remaining >= 8) {
+		return 8;
+	}
+	return 1;
+}
+
+//Runs compressBlock() for count rounds, count being a commitBatchSize() result, side by side
+//where the CPU can. Lane kernels and compressBlock() produce identical views.
+void compressRounds(int count, Tape tapes[][NUM_BRANCHES], View views[][NUM_BRANCHES], const gatePlan* plan) {
+#if defined(__x86_64__) || defined(__i386__)
+	if (count == 16) {
+		compressLanes_x16(tapes, views, plan);
+		return;
+	}
+	if (count == 8) {
+		compressLanes_x8(tapes, views, plan);
+		return;
+	}
+#endif
+	for (int i = 0; i < count; i++) {
+		compressBlock(tapes[i], views[i], plan);
+	}
+}
+
+//Commits count rounds, count being a commitBatchSize() result, with the gate schedule plan for
+//inputLen. All arrays start at the batch's first round. Lane kernels and commit() produce
+//identical views. The tapes live only for the batch.
+void commitRounds(int count, int inputLen, unsigned char shares[][NUM_BRANCHES][inputLen], unsigned char keys[][NUM_BRANCHES][16], View views[][NUM_BRANCHES], a* as, const gatePlan* plan, CryptoCtx* crypto) {
+	Tape tapes[count][NUM_BRANCHES];
+	for (int i = 0; i < count; i++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			tapeInit(&tapes[i][branch], crypto, keys[i][branch]);
+			paddedBlock(shares[i][branch], plan, 0, views[i][branch].x);
+		}
+	}
+	compressRounds(count, tapes, views, plan);
+	for (int i = 0; i < count; i++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			memcpy(as[i].yp[branch], &views[i][branch].y[ySize - 8], 32);
+		}
+	}
+}
+
+//commitRounds() followed by the branch hashes of the batch, taken while its views are still
+//in cache instead of in a later pass over every round, up to 16 views side by side.
+//Fills in both yp and h of as.
+void commitAndHashRounds(int count, int inputLen, unsigned char shares[][NUM_BRANCHES][inputLen], unsigned char keys[][NUM_BRANCHES][16], unsigned char rs[][NUM_BRANCHES][4], View views[][NUM_BRANCHES], a* as, const gatePlan* plan, CryptoCtx* crypto) {
+	const unsigned char* hashKeys[MAX_COMMIT_BATCH * NUM_BRANCHES];
+	const unsigned char* hashRs[MAX_COMMIT_BATCH * NUM_BRANCHES];
+	const View* hashViews[MAX_COMMIT_BATCH * NUM_BRANCHES];
+	unsigned char* hashes[MAX_COMMIT_BATCH * NUM_BRANCHES];
+
+	commitRounds(count, inputLen, shares, keys, views, as, plan, crypto);
+	for (int i = 0; i < count; i++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			hashKeys[i * NUM_BRANCHES + branch] = keys[i][branch];
+			hashRs[i * NUM_BRANCHES + branch] = rs[i][branch];
+			hashViews[i * NUM_BRANCHES + branch] = &views[i][branch];
+			hashes[i * NUM_BRANCHES + branch] = as[i].h[branch];
+		}
+	}
+	commitHashes(crypto, count * NUM_BRANCHES, hashKeys, hashViews, hashRs, hashes); //calulate hash of whole branch including views
+}
+
+z getProveOfTwoBranchesByE(int e, unsigned char keys[NUM_BRANCHES][16], unsigned char rs[NUM_BRANCHES][4], View views[NUM_BRANCHES]) {
+	z z;
+	memcpy(z.ke0, keys[(e + 0) % NUM_BRANCHES], 16);
+	memcpy(z.ke1, keys[(e + 1) % NUM_BRANCHES], 16);
+	z.ve0 = views[(e + 0) % NUM_BRANCHES];
+	z.ve1 = views[(e + 1) % NUM_BRANCHES];
+	memcpy(z.re0, rs[(e + 0) % NUM_BRANCHES], 4);
+	memcpy(z.re1, rs[(e + 1) % NUM_BRANCHES], 4);
+	return z;
+}
+
+
+
+//Splits rounds into the batches commitRounds() takes, returning how many there are. batchStart
+//and batchSize need room for rounds entries.
+int planBatches(int rounds, int batchStart[], int batchSize[]) {
+	int numBatches = 0;
+	for(int round = 0; round < rounds; round += batchSize[numBatches++]) {
+		batchStart[numBatches] = round;
+		batchSize[numBatches] = commitBatchSize(rounds - round);
+	}
+	return numBatches;
+}
+
+//Adds the header, round index and public section of a proof to writer, once its challenges
+//are known, and sizes the output for it
+void writerAddHead(proofWriter* writer, const ProofParams* params, const int* es, int rounds, const a* as,
+		const uint32_t finalHash[8], const unsigned char digest[SHA256_DIGEST_LENGTH], containerHeader* header, uint64_t index[]) {
+	proofLayout(params, es, rounds, header, index);
+	writerBegin(writer, index[rounds]);
+	writerAdd(writer, header, sizeof(*header));
+	writerAdd(writer, index, sizeof(uint64_t) * (rounds + 1));
+	if(params->compact) {
+		writerAdd(writer, finalHash, sizeof(uint32_t) * 8);
+		writerAdd(writer, digest, SHA256_DIGEST_LENGTH);
+	} else {
+		writerAdd(writer, as, sizeof(a) * rounds); //yp and hashes of all branches for each round
+	}
+	writerAdd(writer, params->prefix, params->prefixLen);
+	writerPad(writer, header->publicBytes);
+}
+
+//Proves with the views of every round kept in views until the challenges are known, then
+//writes the proof straight from them. Every round only reads its own keys, rs and shares, so
+//the proof is byte-identical for any number of threads. index has room for rounds + 1 entries.
+//Returns 0, or 1 if an OpenSSL call failed, in which case nothing is written.
+int proveInMemory(const ProofParams* params, int inputLen, unsigned char shares[][NUM_BRANCHES][inputLen], unsigned char keys[][NUM_BRANCHES][16], unsigned char rs[][NUM_BRANCHES][4],
+		View views[][NUM_BRANCHES], a* as, int* es, uint64_t index[], int rounds, int threads, const int batchStart[], const int batchSize[], int numBatches, proofWriter* writer) {
+	messagePlan plans;
+	planProof(params, &plans);
+	const gatePlan* plan = &plans.first;
+	int failed = 0;
+
+	//Each thread owns its OpenSSL contexts
+	#pragma omp parallel num_threads(threads)
+	{
+		CryptoCtx crypto;
+		initCryptoCtx(&crypto, params->backends);
+
+		//Running MPC-SHA2
+		//calculate COMMITMENTS (views) for each round and branch and hash them batch by batch.
+		//The randomness is generated via AES with the random keys as the circuit consumes it.
+		#pragma omp for schedule(dynamic)
+		for(int batch=0; batch < numBatches; batch++) {
+			int first = batchStart[batch];
+			commitAndHashRounds(batchSize[batch], inputLen, &shares[first], &keys[first], &rs[first], &views[first], &as[first], plan, &crypto);
+		}
+
+		cryptoFailed(&crypto, &failed);
+		cleanupCryptoCtx(&crypto);
+	}
+
+	//Generating E
+	uint32_t finalHash[8];
+	for (int j = 0; j < 8; j++) { //yes this is how the final hash is calculated
+		finalHash[j] = as[0].yp[0][j] ^ as[0].yp[1][j] ^ as[0].yp[2][j];
+	}
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, params->backends);
+	challengeDigest(&crypto, params, finalHash, as, rounds, digest);
+	esFromDigest(&crypto, digest, rounds, es); //Es are picked by bit positions of final hash and contains of as (e is id of a branch to be picked)
+	cleanupCryptoCtx(&crypto);
+	if (failed || crypto.failed) {
+		return 1;
+	}
+
+	containerHeader header;
+	writerAddHead(writer, params, es, rounds, as, finalHash, digest, &header, index);
+	//Get prove (Zs chosen by Es), the opened keys, views and rs of every round
+	for(int round = 0; round < rounds; round++) {
+		if(params->compact) {
+			writerAddCompactOpening(writer, es[round], plan, keys[round], views[round], &as[round]);
+		} else {
+			writerAddOpening(writer, es[round], keys[round], rs[round], views[round]);
+		}
+	}
+	writerFlush(writer);
+	return 0;
+}
+
+//Low-memory proving: views only exist for the batches being committed. Once the challenges
+//are known each round is run again to recover its two opened views. The opened parties'
+//AND/ADD gates read the third party's wires, so it is the whole three-party round that is
+//recomputed. Every batch's openings are written straight from its views as soon as it and the
+//batches before it are done, so memory grows with the thread count and not with rounds.
+//The proof is byte-identical to the one written by proveInMemory. views has room for
+//MAX_COMMIT_BATCH rounds of each of the threads, index for rounds + 1 entries. Returns 0, or 1
+//if an OpenSSL call failed, in which case what is written is not a proof.
+int proveLowMemory(const ProofParams* params, int inputLen, unsigned char shares[][NUM_BRANCHES][inputLen], unsigned char keys[][NUM_BRANCHES][16], unsigned char rs[][NUM_BRANCHES][4],
+		View views[][MAX_COMMIT_BATCH][NUM_BRANCHES], a* as, int* es, uint64_t index[], int rounds, int threads, const int batchStart[], const int batchSize[], int numBatches, proofWriter* writer) {
+	containerHeader header;
+	messagePlan plans;
+	planProof(params, &plans);
+	const gatePlan* plan = &plans.first;
+	int failed = 0;
+
+	#pragma omp parallel num_threads(threads)
+	{
+		CryptoCtx crypto;
+		initCryptoCtx(&crypto, params->backends);
+		View (*own)[NUM_BRANCHES] = views[omp_get_thread_num()];
+
+		#pragma omp for schedule(dynamic)
+		for(int batch=0; batch < numBatches; batch++) {
+			int first = batchStart[batch];
+			commitAndHashRounds(batchSize[batch], inputLen, &shares[first], &keys[first], &rs[first], own, &as[first], plan, &crypto);
+			cryptoFailed(&crypto, &failed);
+		}
+
+		#pragma omp single
+		{
+			uint32_t finalHash[8];
+			unsigned char digest[SHA256_DIGEST_LENGTH];
+			reconstruct(as[0].yp[0], as[0].yp[1], as[0].yp[2], finalHash);
+			challengeDigest(&crypto, params, finalHash, as, rounds, digest);
+			esFromDigest(&crypto, digest, rounds, es);
+			cryptoFailed(&crypto, &failed);
+			//Nothing is written of a proof whose commitments or challenges are not to be trusted
+			if (failed) {
+				writer->failed = 1;
+			}
+			writerAddHead(writer, params, es, rounds, as, finalHash, digest, &header, index);
+			writerFlush(writer);
+		}
+
+		#pragma omp for ordered schedule(dynamic)
+		for(int batch = 0; batch < numBatches; batch++) {
+			int first = batchStart[batch];
+			a recomputed[MAX_COMMIT_BATCH];
+			commitRounds(batchSize[batch], inputLen, &shares[first], &keys[first], own, recomputed, plan, &crypto);
+			#pragma omp ordered
+			{
+				if (crypto.failed) {
+					writer->failed = 1;
+				}
+				for(int i = 0; i < batchSize[batch]; i++) {
+					if(params->compact) {
+						writerAddCompactOpening(writer, es[first + i], plan, keys[first + i], own[i], &as[first + i]);
+					} else {
+						writerAddOpening(writer, es[first + i], keys[first + i], rs[first + i], own[i]);
+					}
+				}
+				writerFlush(writer);
+			}
+		}
+
+		cryptoFailed(&crypto, &failed);
+		cleanupCryptoCtx(&crypto);
+	}
+	return failed;
+}
+
+//Pads block block of the input shares of count rounds into their views, or for a rehash or the
+//outer hash of an HMAC the digest shares kept in digests, and moves their tapes to that block.
+//The output words the views hold of the block before are kept first if its plan asks for it.
+void startBlock(int count, int inputLen, unsigned char shares[][NUM_BRANCHES][inputLen], Tape tapes[][NUM_BRANCHES], View views[][NUM_BRANCHES], uint32_t digests[][NUM_BRANCHES][8], const messagePlan* plans, int block) {
+	const gatePlan* plan = blockPlan(plans, block);
+	int keep = block > 0 && blockPlan(plans, block - 1)->keeps;
+	for (int i = 0; i < count; i++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			if (keep) {
+				memcpy(digests[i][branch], &views[i][branch].y[NUM_GATES], 32);
+			}
+			if (plan->linked) {
+				digestBlock(digests[i][branch], plan, views[i][branch].x);
+			} else {
+				paddedBlock(shares[i][branch], plan, block, views[i][branch].x);
+			}
+			tapeSeekBlock(&tapes[i][branch], block);
+		}
+	}
+}
+
+//commitAndHashRounds() for an input of several blocks or a hash chain. The views of each block
+//replace those of the block before, whose output words they start from, and are hashed into the
+//commitments as they are done, so only one block's views are held however long the chain is.
+void commitAndHashBlocks(int count, int inputLen, unsigned char shares[][NUM_BRANCHES][inputLen], unsigned char keys[][NUM_BRANCHES][16], unsigned char rs[][NUM_BRANCHES][4], View views[][NUM_BRANCHES], a* as, const messagePlan* plans, CryptoCtx* crypto) {
+	Tape tapes[count][NUM_BRANCHES];
+	uint32_t digests[count][NUM_BRANCHES][8];
+	digestStream hashes[count][NUM_BRANCHES];
+	for (int i = 0; i < count; i++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			tapeInit(&tapes[i][branch], crypto, keys[i][branch]);
+			digestStreamNew(&hashes[i][branch], crypto, 16 + sizeof(View) * (uint64_t)plans->blocks + 4);
+			digestUpdate(&hashes[i][branch], keys[i][branch], 16);
+		}
+	}
+	for (int block = 0; block < plans->blocks; block++) {
+		startBlock(count, inputLen, shares, tapes, views, digests, plans, block);
+		compressRounds(count, tapes, views, blockPlan(plans, block));
+		for (int i = 0; i < count; i++) {
+			for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+				digestUpdate(&hashes[i][branch], &views[i][branch], sizeof(View));
+			}
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+			digestUpdate(&hashes[i][branch], rs[i][branch], 4);
+			digestEnd(&hashes[i][branch], as[i].h[branch]);
+			memcpy(as[i].yp[branch], &views[i][branch].y[ySize - 8], 32);
+		}
+	}
+}
+
+//Proves an input of several blocks the way proveLowMemory does, with the views of one block of
+//a batch at a time. The second pass writes every block's opened views as soon as they are
+//recomputed, straight to their place in the proof with writerWriteAt, so batches need not wait
+//for one another; a file descriptor that cannot seek fails the proof. Full openings only.
+//views and index are as for proveLowMemory, and so is what is returned.
+int proveBlocks(const ProofParams* params, int inputLen, unsigned char shares[][NUM_BRANCHES][inputLen], unsigned char keys[][NUM_BRANCHES][16], unsigned char rs[][NUM_BRANCHES][4],
+		View views[][MAX_COMMIT_BATCH][NUM_BRANCHES], a* as, int* es, uint64_t index[], int rounds, int threads, const int batchStart[], const int batchSize[], int numBatches, proofWriter* writer) {
+	if (writer->fd >= 0 && writer->base < 0) {
+		writer->failed = 1;
+		return 0;
+	}
+	containerHeader header;
+	messagePlan plans;
+	planProof(params, &plans);
+	int blocks = plans.blocks;
+	int failed = 0, cryptoFails = 0;
+
+	#pragma omp parallel num_threads(threads)
+	{
+		CryptoCtx crypto;
+		initCryptoCtx(&crypto, params->backends);
+		View (*own)[NUM_BRANCHES] = views[omp_get_thread_num()];
+
+		#pragma omp for schedule(dynamic)
+		for(int batch=0; batch < numBatches; batch++) {
+			int first = batchStart[batch];
+			commitAndHashBlocks(batchSize[batch], inputLen, &shares[first], &keys[first], &rs[first], own, &as[first], &plans, &crypto);
+			cryptoFailed(&crypto, &cryptoFails);
+		}
+
+		#pragma omp single
+		{
+			uint32_t finalHash[8];
+			unsigned char digest[SHA256_DIGEST_LENGTH];
+			reconstruct(as[0].yp[0], as[0].yp[1], as[0].yp[2], finalHash);
+			challengeDigest(&crypto, params, finalHash, as, rounds, digest);
+			esFromDigest(&crypto, digest, rounds, es);
+			cryptoFailed(&crypto, &cryptoFails);
+			if (cryptoFails) {
+				writer->failed = 1;
+			}
+			writerAddHead(writer, params, es, rounds, as, finalHash, digest, &header, index);
+			//The writer is not touched again until the threads are done, failed tells them to stop
+			if (writerFlush(writer) != 0) {
+				#pragma omp atomic write
+				failed = 1;
+			}
+		}
+
+		//Every round's opening is its keys, its opened views block by block and its rs
+		#pragma omp for schedule(dynamic)
+		for(int batch = 0; batch < numBatches; batch++) {
+			int first = batchStart[batch];
+			int count = batchSize[batch];
+			Tape tapes[MAX_COMMIT_BATCH][NUM_BRANCHES];
+			uint32_t digests[MAX_COMMIT_BATCH][NUM_BRANCHES][8];
+			for (int i = 0; i < count; i++) {
+				for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+					tapeInit(&tapes[i][branch], &crypto, keys[first + i][branch]);
+				}
+			}
+			for (int block = 0; block < blocks; block++) {
+				int stop;
+				#pragma omp atomic read
+				stop = failed;
+				if (stop) {
+					break;
+				}
+				startBlock(count, inputLen, &shares[first], tapes, own, digests, &plans, block);
+				compressRounds(count, tapes, own, blockPlan(&plans, block));
+				if (crypto.failed) {
+					#pragma omp atomic write
+					cryptoFails = 1;
+					break;
+				}
+				for (int i = 0; i < count; i++) {
+					int round = first + i;
+					int e = es[round];
+					struct iovec iov[6]; //both keys, both views and both rs when the block is the first and last
+					int parts = 0;
+					uint64_t offset = index[round] + 32 + sizeof(View) * TWO_BRANCHES * block;
+					if (block == 0) {
+						iov[parts++] = (struct iovec) { keys[round][e], 16 };
+						iov[parts++] = (struct iovec) { keys[round][(e + 1) % NUM_BRANCHES], 16 };
+						offset = index[round];
+					}
+					iov[parts++] = (struct iovec) { &own[i][e], sizeof(View) };
+					iov[parts++] = (struct iovec) { &own[i][(e + 1) % NUM_BRANCHES], sizeof(View) };
+					if (block == blocks - 1) {
+						iov[parts++] = (struct iovec) { rs[round][e], 4 };
+						iov[parts++] = (struct iovec) { rs[round][(e + 1) % NUM_BRANCHES], 4 };
+					}
+					if (writerWriteAt(writer, offset, iov, parts) != 0) {
+						#pragma omp atomic write
+						failed = 1;
+					}
+				}
+			}
+		}
+
+		cleanupCryptoCtx(&crypto);
+	}
+	if (failed || cryptoFails) {
+		writer->failed = 1;
+	} else {
+		writerSkipTo(writer, index[rounds]);
+	}
+	return cryptoFails;
+}
+
+#endif /* PROVER_H_ */
@@ -0,0 +1,127 @@
+ /*
+ ============================================================================
+ Name        : sha256_circuit.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : The SHA-256 compression function as a circuit
+ ============================================================================
+ */
+
+/*
+ * Kept apart from shared.h so that ../libzkboo/circuit_gen.c can build the
+ * circuit at build time and write out its straight-line kernels.
+ */
+
+#ifndef SHA256_CIRCUIT_H_
+#define SHA256_CIRCUIT_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libzkboo/circuit.h"
+
+static const uint32_t k[64] = { 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+		0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98,
+		0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+		0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6,
+		0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3,
+		0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138,
+		0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e,
+		0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+		0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+		0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+		0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814,
+		0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+
+//The AND, ADD, ADDK and MAJ gates of sha256Circuit: 3 ADDs per word of the message schedule,
+//9 gates per round and the 8 ADDs onto the chaining value. Checked when the circuit is built.
+#define SHA256_GATES (48 * 3 + 64 * 9 + 8)
+
+//The registers of sha256Circuit's inputs, the 16 message words and then the chaining value
+#define SHA256_STATE_REGISTER 16
+
+//The register to put a new value in once register r is dead: r itself unless it is an input,
+//which every block reloads
+static inline int sha256Reuse(circuit* c, int r) {
+	return r >= c->inputs ? r : circuitRegister(c);
+}
+
+//One SHA-256 compression as a circuit, the gates in the order the three parties have always run
+//them. The working variables move along by renaming registers, not by copying them.
+static void buildSha256Circuit(circuit* c) {
+	circuitBegin(c, SHA256_STATE_REGISTER + 8);
+	int t0 = circuitRegister(c), t1 = circuitRegister(c), s0 = circuitRegister(c), s1 = circuitRegister(c);
+	int ch = circuitRegister(c), temp1 = circuitRegister(c), temp2 = circuitRegister(c), maj = circuitRegister(c);
+
+	int w[64];
+	for (int j = 0; j < 16; j++) {
+		w[j] = j;
+	}
+	for (int j = 16; j < 64; j++) {
+		//s0 = RIGHTROTATE(w[j-15],7) ^ RIGHTROTATE(w[j-15],18) ^ (w[j-15] >> 3)
+		circuitRotr(c, t0, w[j-15], 7);
+		circuitRotr(c, t1, w[j-15], 18);
+		circuitXor(c, t0, t0, t1);
+		circuitShr(c, t1, w[j-15], 3);
+		circuitXor(c, s0, t0, t1);
+		//s1 = RIGHTROTATE(w[j-2],17) ^ RIGHTROTATE(w[j-2],19) ^ (w[j-2] >> 10)
+		circuitRotr(c, t0, w[j-2], 17);
+		circuitRotr(c, t1, w[j-2], 19);
+		circuitXor(c, t0, t0, t1);
+		circuitShr(c, t1, w[j-2], 10);
+		circuitXor(c, s1, t0, t1);
+		//w[j] = w[j-16] + s0 + w[j-7] + s1
+		w[j] = circuitRegister(c);
+		circuitAdd(c, t1, w[j-16], s0);
+		circuitAdd(c, t1, w[j-7], t1);
+		circuitAdd(c, w[j], t1, s1);
+	}
+
+	int v[8]; //a to h
+	for (int i = 0; i < 8; i++) {
+		v[i] = SHA256_STATE_REGISTER + i;
+	}
+	for (int i = 0; i < 64; i++) {
+		int a = v[0], b = v[1], cc = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+		//s1 = RIGHTROTATE(e,6) ^ RIGHTROTATE(e,11) ^ RIGHTROTATE(e,25)
+		circuitRotr(c, t0, e, 6);
+		circuitRotr(c, t1, e, 11);
+		circuitXor(c, t0, t0, t1);
+		circuitRotr(c, t1, e, 25);
+		circuitXor(c, s1, t0, t1);
+		//temp1 = h + s1 + CH(e,f,g) + k[i] + w[i]
+		circuitAdd(c, t0, h, s1);
+		circuitCh(c, t1, e, f, g, ch);
+		circuitAdd(c, t1, t0, t1);
+		circuitAddK(c, t1, t1, k[i]);
+		circuitAdd(c, temp1, t1, w[i]);
+		//temp2 = RIGHTROTATE(a,2) ^ RIGHTROTATE(a,13) ^ RIGHTROTATE(a,22) + MAJ(a,b,c)
+		circuitRotr(c, t0, a, 2);
+		circuitRotr(c, t1, a, 13);
+		circuitXor(c, t0, t0, t1);
+		circuitRotr(c, t1, a, 22);
+		circuitXor(c, s0, t0, t1);
+		circuitMaj(c, maj, a, b, cc);
+		circuitAdd(c, temp2, s0, maj);
+		//h is dead once temp1 is known, and d once e is
+		int newE = sha256Reuse(c, h);
+		circuitAdd(c, newE, d, temp1);
+		int newA = sha256Reuse(c, d);
+		circuitAdd(c, newA, temp1, temp2);
+		int next[8] = { newA, a, b, cc, newE, e, f, g };
+		memcpy(v, next, sizeof(v));
+	}
+
+	for (int i = 0; i < 8; i++) {
+		circuitAdd(c, v[i], SHA256_STATE_REGISTER + i, v[i]);
+	}
+	circuitEnd(c, v, 8);
+	if (c->words != SHA256_GATES || c->registers > CIRCUIT_MAX_REGISTERS || c->gates > CIRCUIT_MAX_GATES) {
+		fprintf(stderr, "sha256Circuit has %d gates, SHA256_GATES is %d\n", c->words, SHA256_GATES);
+		abort();
+	}
+}
+
+#endif /* SHA256_CIRCUIT_H_ */
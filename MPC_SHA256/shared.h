@@ -19,28 +19,17 @@
 #endif
 #include <openssl/rand.h>
 #include "omp.h"
+#include "sha256_circuit.h"
 
-#define VERBOSE 1
+#define VERBOSE 0
 
 static const uint32_t hA[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
 		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
 
-static const uint32_t k[64] = { 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
-		0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98,
-		0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
-		0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6,
-		0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3,
-		0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138,
-		0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e,
-		0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-		0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
-		0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
-		0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814,
-		0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
-
-//736 because that is how many times AND or ADD is called and ys need to be saved
-#define ySize 736
+//The AND, ADD, ADDK and MAJ gates of sha256Circuit, see sha256_circuit.h
+#define NUM_GATES SHA256_GATES
+//A y word per gate, then the 8 output words
+#define ySize (NUM_GATES + 8)
 
 #define DEBUG 0
 #define debug_print(fmt, ...) \
@@ -50,7 +39,7 @@ static const uint32_t k[64] = { 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
 
 typedef struct { // step in computation - internal state of each step
 	unsigned char x[64]; //input share
-	uint32_t y[ySize]; //736 32bit values
+	uint32_t y[ySize]; //a 32 bit value per gate and output word
 } View;
 
 typedef struct { //commitment
@@ -67,53 +56,480 @@ typedef struct {
 	unsigned char re1[4]; //random used for branch 1
 } z; //proof = openings
 
+//A full opening of an input of blocks blocks holds the two opened views of every block in turn
+//between the keys and the rs, so that the opening of a single block is a z. Longer ones are
+//read through the z they start with.
+static inline size_t fullOpeningBytes(int blocks) {
+	return sizeof(z) + (size_t)(blocks - 1) * TWO_BRANCHES * sizeof(View);
+}
+
+//The view of branch e + branch in block block of opening z
+static inline const View* openedView(const z* z, int block, int branch) {
+	return (const View*)((const unsigned char*)&z->ve0 + sizeof(View) * (TWO_BRANCHES * block + branch));
+}
+
+//The commitment randomness of branch e + branch in opening z of blocks blocks
+static inline const unsigned char* openedR(const z* z, int blocks, int branch) {
+	return (const unsigned char*)openedView(z, blocks, 0) + 4 * branch;
+}
+
+//Opening i of full openings of blocks blocks that are back to back from zs
+static inline const z* fullOpening(const z* zs, int blocks, int i) {
+	return (const z*)((const unsigned char*)zs + fullOpeningBytes(blocks) * i);
+}
+
 #define RIGHTROTATE(x,n) (((x) >> (n)) | ((x) << (32-(n))))
 #define GETBIT(x, bit) (((x) >> (bit)) & 0x01)
 #define SETBIT(x, bit, b)   x= (b)&1 ? (x)|(1 << (bit)) : (x)&(~(1 << (bit)))
 
+//Bytes of input that fit in one padded block along with the 0x80 and the 64 bit length
+#define BLOCK_INPUT_BYTES 55
+//The longest input proven. Longer inputs than BLOCK_INPUT_BYTES take a compression per
+//padded block, each with its own views, chained through their output words.
+#define MAX_INPUT_BYTES 65536
+//The longest public prefix, which is hashed in the clear and stored in the proof
+#define MAX_PREFIX_BYTES (1 << 20)
+//The most times the digest is hashed again in a hash chain, SHA-256 being applied up to
+//MAX_REHASHES + 1 times. Every rehash is one more block.
+#define MAX_REHASHES 65535
+
+//The blocks an input of inputLen bytes pads to
+static inline int inputBlocks(int inputLen) {
+	return (inputLen + 8) / 64 + 1;
+}
 
-void handleErrors(void)
-{
-	ERR_print_errors_fp(stderr);
-	abort();
+//The blocks the circuit runs for an input of inputLen bytes after a public prefix of prefixLen:
+//the prefix's whole blocks are hashed in the clear, the rest of it goes ahead of the input
+static inline int messageBlocks(int prefixLen, int inputLen) {
+	return inputBlocks(prefixLen % 64 + inputLen);
+}
+
+//One SHA-256 compression of block into state, in the clear
+void sha256Compress(uint32_t state[8], const unsigned char block[64]) {
+	uint32_t w[64];
+	for (int j = 0; j < 16; j++) {
+		w[j] = (block[j * 4] << 24) | (block[j * 4 + 1] << 16) | (block[j * 4 + 2] << 8) | block[j * 4 + 3];
+	}
+	for (int j = 16; j < 64; j++) {
+		uint32_t s0 = RIGHTROTATE(w[j-15], 7) ^ RIGHTROTATE(w[j-15], 18) ^ (w[j-15] >> 3);
+		uint32_t s1 = RIGHTROTATE(w[j-2], 17) ^ RIGHTROTATE(w[j-2], 19) ^ (w[j-2] >> 10);
+		w[j] = w[j-16] + s0 + w[j-7] + s1;
+	}
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+	for (int i = 0; i < 64; i++) {
+		uint32_t s1 = RIGHTROTATE(e, 6) ^ RIGHTROTATE(e, 11) ^ RIGHTROTATE(e, 25);
+		uint32_t ch = (e & f) ^ ((~e) & g);
+		uint32_t temp1 = h + s1 + ch + k[i] + w[i];
+		uint32_t s0 = RIGHTROTATE(a, 2) ^ RIGHTROTATE(a, 13) ^ RIGHTROTATE(a, 22);
+		uint32_t maj = (a & (b ^ c)) ^ (b & c);
+		uint32_t temp2 = s0 + maj;
+		h = g;
+		g = f;
+		f = e;
+		e = d + temp1;
+		d = c;
+		c = b;
+		b = a;
+		a = temp1 + temp2;
+	}
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+//The circuit of one compression, built on first use by whichever thread gets there first
+static const circuit* sha256Circuit(void) {
+	static circuit c;
+	static int built = 0;
+	int done;
+#pragma omp atomic read seq_cst
+	done = built;
+	if (!done) {
+#pragma omp critical(sha256Circuit)
+		{
+			if (!built) {
+				buildSha256Circuit(&c);
+#pragma omp atomic write seq_cst
+				built = 1;
+			}
+		}
+	}
+	return &c;
+}
+
+//The message the circuit hashes: the end of a public prefix that is not a whole block, tail,
+//then the secret input, from the midstate iv the prefix's whole blocks hash to
+typedef struct {
+	int prefixLen;
+	int inputLen;
+	int tailLen;
+	unsigned char tail[64];
+	uint32_t iv[8];
+} messageLayout;
+
+void layoutMessage(const unsigned char* prefix, int prefixLen, int inputLen, messageLayout* layout) {
+	int hashed = prefixLen / 64 * 64;
+	layout->prefixLen = prefixLen;
+	layout->inputLen = inputLen;
+	layout->tailLen = prefixLen - hashed;
+	memcpy(layout->iv, hA, sizeof(hA));
+	for (int i = 0; i < hashed; i += 64) {
+		sha256Compress(layout->iv, prefix + i);
+	}
+	if (layout->tailLen > 0) {
+		memcpy(layout->tail, prefix + hashed, layout->tailLen);
+	}
+}
+
+//Which gates of one compression every party can compute on its own shares, with no randomness
+//and no y word. Only the message words holding input bytes are secret: the end of a public
+//prefix, the padding, the length, the initial state and the constants are public, and so is
+//everything computed from them alone. The chaining value a later block starts from is secret.
+//A public value is shared as the value itself in every party, so an ADD of two public values is
+//a plain add, and the AND in CH or MAJ is linear once one of its operands is public. What is
+//public only depends on the prefix and the input length, so prover and verifier work out the
+//same schedule.
+typedef struct {
+	int inputLen; //bytes of secret input in the whole message
+	int words; //y words of the gates that are not local, at the start of every view's y
+	int inputStart; //where input byte 0 is, counting from the first block's first byte
+	int secretFrom; //bytes secretFrom to secretTo - 1 of the block are input bytes, the others public
+	int secretTo;
+	int checkPublic; //whether the verifier holds the views to the public bytes
+	int chained; //the block starts from the output words of the block before, else from iv
+	int linked; //the block hashes a digest: its input bytes are the output words last kept
+	int keeps; //the block's output words are kept for a later linked block
+	int repeats; //HMAC: the block's input bytes are block 0's again, under another pad
+	unsigned char padded[64]; //the public bytes of the block, XORed into its input bytes
+	const unsigned char* message; //NULL, or a public message the block is 64 bytes of, see publicBytes
+	int messageBlock; //the block message starts at
+	uint32_t iv[8]; //the state the first block starts from, hA or a public prefix's midstate
+	unsigned char local[NUM_GATES]; //1 for every gate, in circuit order, computed locally
+} gatePlan;
+
+//The public bytes of block block, whose schedule is plan
+static inline const unsigned char* publicBytes(const gatePlan* plan, int block) {
+	return plan->message ? plan->message + 64 * (block - plan->messageBlock) : plan->padded;
+}
+
+//Block block of the padded message, whose schedule is plan, with the input bytes of share, an
+//input share. Every party pads its share alike and holds the public bytes as they are, so the
+//padded shares still add up to the padded message.
+void paddedBlock(const unsigned char* share, const gatePlan* plan, int block, unsigned char x[64]) {
+	memcpy(x, publicBytes(plan, block), 64);
+	for (int j = plan->secretFrom; j < plan->secretTo; j++) {
+		x[j] ^= share[block * 64 + j - plan->inputStart];
+	}
+}
+
+//The block of a rehash, whose schedule is plan, from a party's share digest of the output words
+//of the block before. Each party writes its own words out big-endian, which makes them its
+//shares of the digest's bytes, and nothing is revealed or computed in between.
+void digestBlock(const uint32_t digest[8], const gatePlan* plan, unsigned char x[64]) {
+	memcpy(x, plan->padded, 64);
+	for (int i = 0; i < 8; i++) {
+		x[i * 4] = digest[i] >> 24;
+		x[i * 4 + 1] = digest[i] >> 16;
+		x[i * 4 + 2] = digest[i] >> 8;
+		x[i * 4 + 3] = digest[i];
+	}
+}
+
+//Works out which gates of plan's block are local from its input bytes and whether it is
+//chained. Without publicGates every gate runs as a three-party gate, as in proofs from before
+//public values were tracked.
+void planBlockWords(gatePlan* plan, int publicGates) {
+	if (!publicGates) {
+		plan->words = NUM_GATES;
+		return;
+	}
+	unsigned char publicIn[SHA256_STATE_REGISTER + 8];
+	for (int j = 0; j < 16; j++) {
+		publicIn[j] = 4 * j + 4 <= plan->secretFrom || 4 * j >= plan->secretTo;
+	}
+	for (int i = 0; i < 8; i++) {
+		publicIn[SHA256_STATE_REGISTER + i] = !plan->chained; //the state starts out secret
+	}
+	plan->words = circuitLocalGates(sha256Circuit(), publicIn, plan->local);
+}
+
+//The gate schedule of sha256Circuit for block block of the message laid out by layout
+void planBlockGates(const messageLayout* layout, int block, int publicGates, gatePlan* plan) {
+	memset(plan, 0, sizeof(*plan));
+	plan->inputLen = layout->inputLen;
+	plan->inputStart = layout->tailLen;
+	memcpy(plan->iv, layout->iv, sizeof(plan->iv));
+	int start = block * 64;
+	int end = layout->tailLen + layout->inputLen; //the 0x80 after the message
+	for (int j = 0; j < 64; j++) {
+		int at = start + j;
+		plan->padded[j] = at < layout->tailLen ? layout->tail[at] : at == end ? 0x80 : 0;
+	}
+	if (block == inputBlocks(end) - 1) {
+		uint64_t bits = ((uint64_t)layout->prefixLen + layout->inputLen) * 8;
+		for (int i = 0; i < 8; i++) {
+			plan->padded[56 + i] = bits >> (56 - 8 * i);
+		}
+	}
+	plan->secretFrom = layout->tailLen - start < 0 ? 0 : layout->tailLen - start > 64 ? 64 : layout->tailLen - start;
+	plan->secretTo = end - start < plan->secretFrom ? plan->secretFrom : end - start > 64 ? 64 : end - start;
+	plan->checkPublic = publicGates || layout->prefixLen > 0;
+	plan->chained = block > 0;
+	planBlockWords(plan, publicGates);
 }
 
+//The schedule of a block whose input bytes are a digest kept from an earlier block, hashed
+//after hashed bytes of the same message, so chained to the block before unless hashed is 0.
+//Its padding is checked with or without publicGates.
+void planDigestBlock(int hashed, int publicGates, gatePlan* plan) {
+	memset(plan, 0, sizeof(*plan));
+	plan->inputLen = 32;
+	memcpy(plan->iv, hA, sizeof(plan->iv));
+	plan->padded[32] = 0x80;
+	uint64_t bits = ((uint64_t)hashed + 32) * 8;
+	for (int i = 0; i < 8; i++) {
+		plan->padded[56 + i] = bits >> (56 - 8 * i);
+	}
+	plan->secretTo = 32;
+	plan->checkPublic = 1;
+	plan->chained = hashed > 0;
+	plan->linked = 1;
+	planBlockWords(plan, publicGates);
+}
 
-EVP_CIPHER_CTX* setupAES(unsigned char key[16]) {
-	EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-	EVP_CIPHER_CTX_init(ctx);
+//The gate schedules of every block of a message. Only the first block starts from a public
+//state and can hold the end of a public prefix, and only the last two can hold padding, so the
+//blocks in between share one schedule. A hash chain hashes the message's digest again after
+//its last block, a block per rehash, which all share the link schedule. An HMAC is laid out
+//the same way, see planHmac.
+typedef struct {
+	int blocks; //hashBlocks and a block per rehash, or HMAC's two outer blocks
+	int hashBlocks; //blocks of the message, or of HMAC's inner hash
+	int hmac;
+	gatePlan first; //block 0
+	gatePlan middle; //blocks 1 to hashBlocks - 3
+	gatePlan last[2]; //blocks hashBlocks - 2 and hashBlocks - 1, when they are not block 0
+	gatePlan outer; //HMAC: block hashBlocks, the key block of the outer hash
+	gatePlan link; //blocks after hashBlocks and, without HMAC, hashBlocks
+} messagePlan;
+
+//The schedule of the block of the message's last bytes, the one that keeps its digest
+static inline gatePlan* lastBlockPlan(messagePlan* plans) {
+	return plans->hashBlocks == 1 ? &plans->first : &plans->last[1];
+}
 
-	/* A 128 bit IV */
-	unsigned char *iv = (unsigned char *)"01234567890123456";
+//The gate schedules of inputLen bytes of input hashed after the prefixLen bytes of prefix,
+//which may be NULL when prefixLen is 0
+void planPrefixedMessage(const unsigned char* prefix, int prefixLen, int inputLen, int publicGates, messagePlan* plans) {
+	messageLayout layout;
+	layoutMessage(prefix, prefixLen, inputLen, &layout);
+	plans->blocks = messageBlocks(prefixLen, inputLen);
+	plans->hashBlocks = plans->blocks;
+	plans->hmac = 0;
+	planBlockGates(&layout, 0, publicGates, &plans->first);
+	if (plans->blocks > 3) {
+		planBlockGates(&layout, 1, publicGates, &plans->middle);
+	}
+	for (int i = 0; i < 2; i++) {
+		int block = plans->blocks - 2 + i;
+		if (block > 0) {
+			planBlockGates(&layout, block, publicGates, &plans->last[i]);
+		}
+	}
+}
+
+void planMessage(int inputLen, int publicGates, messagePlan* plans) {
+	planPrefixedMessage(NULL, 0, inputLen, publicGates, plans);
+}
+
+//Makes the message of plans a hash chain that hashes its digest rehashes more times. A rehash
+//is the single block hash of a 32 byte input, the digest of the block before, from hA. Its
+//input bytes are shared as that block's output words, so the verifier checks them against
+//those.
+void planChain(int rehashes, int publicGates, messagePlan* plans) {
+	plans->blocks = plans->hashBlocks + rehashes;
+	if (rehashes > 0) {
+		lastBlockPlan(plans)->keeps = 1;
+		planDigestBlock(0, publicGates, &plans->link);
+		plans->link.keeps = 1;
+	}
+}
+
+//The blocks of an HMAC of a messageLen byte message
+static inline int hmacBlocks(int messageLen) {
+	return 1 + inputBlocks(messageLen) + 2;
+}
+
+//The schedule of an HMAC key block at block block, keyLen bytes of key XORed with pad and
+//padded with it. Both key blocks start from hA, their key bytes being the only secret ones.
+static void planKeyBlock(int keyLen, unsigned char pad, int block, int publicGates, gatePlan* plan) {
+	memset(plan, 0, sizeof(*plan));
+	plan->inputLen = keyLen;
+	plan->inputStart = block * 64;
+	memcpy(plan->iv, hA, sizeof(plan->iv));
+	memset(plan->padded, pad, 64);
+	plan->secretTo = keyLen;
+	plan->checkPublic = 1;
+	plan->repeats = block > 0;
+	planBlockWords(plan, publicGates);
+}
+
+//The schedule of block block of an HMAC's inner hash after its key block, holding public
+//message bytes and padding only. Its message words are public, so with publicGates the message
+//schedule is computed in the clear and only the rounds on the secret state are gates.
+static void planInnerBlock(const unsigned char* message, int messageLen, int block, int publicGates, gatePlan* plan) {
+	memset(plan, 0, sizeof(*plan));
+	memcpy(plan->iv, hA, sizeof(plan->iv));
+	int start = (block - 1) * 64;
+	for (int j = 0; j < 64; j++) {
+		int at = start + j;
+		plan->padded[j] = at < messageLen ? message[at] : at == messageLen ? 0x80 : 0;
+	}
+	if (block == inputBlocks(messageLen)) {
+		uint64_t bits = (64 + (uint64_t)messageLen) * 8;
+		for (int i = 0; i < 8; i++) {
+			plan->padded[56 + i] = bits >> (56 - 8 * i);
+		}
+	}
+	plan->checkPublic = 1;
+	plan->chained = 1;
+	planBlockWords(plan, publicGates);
+}
+
+//The gate schedules of HMAC-SHA256 under a secret key of keyLen bytes, at most 64, of the
+//public message: the inner hash, H((key ^ ipad) || message), then the outer one,
+//H((key ^ opad) || inner digest), all in one circuit. Block 0 holds the key's shares XORed
+//with ipad, the outer key block the same shares XORed with opad, which the verifier checks
+//against block 0. The inner hash's digest is kept from its last block for the outer one's
+//last, so it is never revealed. The message blocks in between are public: their message
+//schedule needs no gates, and the blocks before the last two share one schedule that reads
+//their bytes from message.
+void planHmac(const unsigned char* message, int messageLen, int keyLen, int publicGates, messagePlan* plans) {
+	plans->blocks = hmacBlocks(messageLen);
+	plans->hashBlocks = plans->blocks - 2;
+	plans->hmac = 1;
+	planKeyBlock(keyLen, 0x36, 0, publicGates, &plans->first);
+	if (plans->hashBlocks > 3) {
+		planInnerBlock(message, messageLen, 1, publicGates, &plans->middle);
+		plans->middle.message = message;
+		plans->middle.messageBlock = 1;
+	}
+	for (int i = 0; i < 2; i++) {
+		int block = plans->hashBlocks - 2 + i;
+		if (block > 0) {
+			planInnerBlock(message, messageLen, block, publicGates, &plans->last[i]);
+		}
+	}
+	plans->last[1].keeps = 1;
+	planKeyBlock(keyLen, 0x5c, plans->hashBlocks, publicGates, &plans->outer);
+	planDigestBlock(64, publicGates, &plans->link);
+}
 
-	if(1 != EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), NULL, key, iv)){
-		handleErrors();
+static inline const gatePlan* blockPlan(const messagePlan* plans, int block) {
+	if (block >= plans->hashBlocks) {
+		return block == plans->hashBlocks && plans->hmac ? &plans->outer : &plans->link;
 	}
-	return ctx;
+	if (block == 0) {
+		return &plans->first;
+	}
+	return block >= plans->hashBlocks - 2 ? &plans->last[block - (plans->hashBlocks - 2)] : &plans->middle;
 }
 
-void getAllRandomness(unsigned char key[16], unsigned char randomness[2912]) {
-	//Generate randomness: We use 728*32 bit of randomness per key.
-	//Since AES block size is 128 bit, we need to run 728*32/128 = 182 iterations
 
-	EVP_CIPHER_CTX* ctx;
-	ctx = setupAES(key);
-	unsigned char *plaintext = (unsigned char *)"0000000000000000";
-	int len;
-	for(int j=0;j<182;j++) {
-		if(1 != EVP_EncryptUpdate(ctx, &randomness[j*16], &len, plaintext, strlen ((char *)plaintext)))
-			handleErrors();
+#include "backends.h"
+
+//OpenSSL state owned by a single thread. The prover and verifier give every thread its own,
+//so cipher and digest contexts are never shared and need no locking.
+//The algorithms are those of the proof's Backends.
+typedef struct {
+	Backends backends;
+	EVP_CIPHER_CTX* cipher;
+	EVP_MD_CTX* md;
+	EVP_MD_CTX* treeRoot; //HASH_TREE hashes the chunk digests here while md hashes the chunks
+	EVP_CIPHER* prgCipher; //NULL for PRG_SHAKE128
+	EVP_MD* prgMd; //only for PRG_SHAKE128
+	EVP_MD* hashMd;
+	int failed; //an OpenSSL call failed, so tapes and digests since are zero: see cryptoFailed
+} CryptoCtx;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+//Fetch once so re-keying and hashing don't go through the global algorithm store each time
+#define FETCH_CIPHER(name, legacy) EVP_CIPHER_fetch(NULL, name, NULL)
+#define FETCH_MD(name, legacy) EVP_MD_fetch(NULL, name, NULL)
+#else
+#define FETCH_CIPHER(name, legacy) ((EVP_CIPHER*)legacy())
+#define FETCH_MD(name, legacy) ((EVP_MD*)legacy())
+#endif
+
+void cleanupCryptoCtx(CryptoCtx* crypto) {
+	EVP_CIPHER_CTX_free(crypto->cipher);
+	EVP_MD_CTX_free(crypto->md);
+	EVP_MD_CTX_free(crypto->treeRoot);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	EVP_CIPHER_free(crypto->prgCipher);
+	EVP_MD_free(crypto->prgMd);
+	EVP_MD_free(crypto->hashMd);
+#endif
+	crypto->cipher = NULL;
+	crypto->md = NULL;
+	crypto->treeRoot = NULL;
+	crypto->prgCipher = NULL;
+	crypto->prgMd = NULL;
+	crypto->hashMd = NULL;
+}
 
+//Sets up crypto, which is the caller's, for backends. Returns 0 on success. On failure crypto
+//is left failed, with nothing to free, but can still be used and cleaned up like any other.
+int initCryptoCtx(CryptoCtx* crypto, Backends backends) {
+	crypto->backends = backends;
+	crypto->cipher = EVP_CIPHER_CTX_new();
+	crypto->md = EVP_MD_CTX_new();
+	crypto->treeRoot = EVP_MD_CTX_new();
+	crypto->prgCipher = NULL;
+	crypto->prgMd = NULL;
+	crypto->hashMd = NULL;
+	crypto->failed = 0;
+	switch (backends.prg) {
+	case PRG_AES_CTR: crypto->prgCipher = FETCH_CIPHER("AES-128-CTR", EVP_aes_128_ctr); break;
+	case PRG_FIXED_AES: crypto->prgCipher = FETCH_CIPHER("AES-128-ECB", EVP_aes_128_ecb); break;
+	case PRG_CHACHA20: crypto->prgCipher = FETCH_CIPHER("ChaCha20", EVP_chacha20); break;
+	default: crypto->prgMd = FETCH_MD("SHAKE128", EVP_shake128); break;
+	}
+	switch (backends.hash) {
+	case HASH_SHA256: crypto->hashMd = FETCH_MD("SHA256", EVP_sha256); break;
+	case HASH_SHA3_256: crypto->hashMd = FETCH_MD("SHA3-256", EVP_sha3_256); break;
+	default: crypto->hashMd = FETCH_MD("BLAKE2S-256", EVP_blake2s256); break;
 	}
-	EVP_CIPHER_CTX_cleanup(ctx);
+	if (crypto->cipher == NULL || crypto->md == NULL || crypto->treeRoot == NULL || crypto->hashMd == NULL
+			|| (crypto->prgCipher == NULL && crypto->prgMd == NULL)) {
+		cleanupCryptoCtx(crypto);
+		crypto->failed = 1;
+	}
+	return crypto->failed;
 }
 
-uint32_t getRandom32(unsigned char randomness[2912], int randCount) {
-	uint32_t ret;
-	memcpy(&ret, &randomness[randCount], 4);
-	return ret;
+//Records in *failed, which the threads share, whether crypto has failed. Called by every thread
+//before the results of its crypto are used, so that none is taken for a proof's own.
+static inline void cryptoFailed(const CryptoCtx* crypto, int* failed) {
+	if (crypto->failed) {
+		#pragma omp atomic write
+		*failed = 1;
+	}
 }
 
+#include "tapes.h"
+
+#define CIRCUIT_TAPE Tape
+#define CIRCUIT_RAND(n, tapes, randCount, r) tapesGet32((n), (tapes), (randCount), (r))
+#include "../libzkboo/circuit_mpc.h"
+#include "sha256_kernels.h"
+
 
 void init_EVP() {
 	ERR_load_crypto_strings();
@@ -128,32 +544,198 @@ void cleanup_EVP() {
 	ERR_free_strings();
 }
 
-void calculateHashForBranch(unsigned char k[16], View v, unsigned char r[4], unsigned char * hash) { //calculates sha256 from whole k,v and r
-	SHA256_CTX ctx;
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, k, 16);
-	SHA256_Update(&ctx, &v, sizeof(v));
-	SHA256_Update(&ctx, r, 4);
-	SHA256_Final(hash, &ctx); //write result to hash variable
+//HASH_TREE chunk size. Chunks are hashed independently, so long inputs can hash them in parallel.
+#define TREE_CHUNK 1024
+
+//A digest under the backend hash taken a piece at a time, for data that is not all in memory
+//at once. HASH_TREE hashes the length first, so the total has to be known from the start.
+typedef struct {
+	CryptoCtx* crypto;
+	EVP_MD_CTX* md; //the data, or for HASH_TREE the chunk being hashed
+	EVP_MD_CTX* root; //HASH_TREE: the chunk digests
+	int owned; //md and root were allocated by digestStreamNew
+	uint64_t chunk; //HASH_TREE: the next chunk's number
+	size_t chunkFill; //HASH_TREE: bytes of the current chunk
+	int ok;
+} digestStream;
+
+//Starts a digest of total bytes in md and, for HASH_TREE, root, which are the caller's
+void digestBegin(digestStream* d, CryptoCtx* crypto, EVP_MD_CTX* md, EVP_MD_CTX* root, uint64_t total) {
+	d->crypto = crypto;
+	d->md = md;
+	d->root = root;
+	d->owned = 0;
+	d->chunk = 0;
+	d->chunkFill = TREE_CHUNK;
+	if (crypto->failed) {
+		d->ok = 0;
+		return;
+	}
+	if (crypto->backends.hash != HASH_TREE) {
+		d->ok = EVP_DigestInit_ex(md, crypto->hashMd, NULL);
+		return;
+	}
+	//Chunk i is hashed as 0x00 || i || chunk and the root as 0x01 || length || chunk digests,
+	//i and the length being little-endian 64-bit
+	unsigned char prefix[9] = { 1 };
+	for (int b = 0; b < 8; b++) {
+		prefix[1 + b] = total >> (8 * b);
+	}
+	d->ok = EVP_DigestInit_ex(root, crypto->hashMd, NULL) & EVP_DigestUpdate(root, prefix, 9);
+}
+
+//digestBegin with contexts of the stream's own, freed by digestEnd
+void digestStreamNew(digestStream* d, CryptoCtx* crypto, uint64_t total) {
+	EVP_MD_CTX* md = EVP_MD_CTX_new();
+	EVP_MD_CTX* root = crypto->backends.hash == HASH_TREE ? EVP_MD_CTX_new() : NULL;
+	if (md == NULL || (crypto->backends.hash == HASH_TREE && root == NULL)) {
+		crypto->failed = 1;
+	}
+	digestBegin(d, crypto, md, root, total);
+	d->owned = 1;
+}
+
+void digestUpdate(digestStream* d, const void* data, size_t len) {
+	if (!d->ok) {
+		return;
+	}
+	if (d->crypto->backends.hash != HASH_TREE) {
+		d->ok &= EVP_DigestUpdate(d->md, data, len);
+		return;
+	}
+	const unsigned char* p = data;
+	while (len > 0) {
+		if (d->chunkFill == TREE_CHUNK) {
+			unsigned char prefix[9] = { 0 };
+			for (int b = 0; b < 8; b++) {
+				prefix[1 + b] = d->chunk >> (8 * b);
+			}
+			d->ok &= EVP_DigestInit_ex(d->md, d->crypto->hashMd, NULL) & EVP_DigestUpdate(d->md, prefix, 9);
+			d->chunkFill = 0;
+		}
+		size_t take = len < TREE_CHUNK - d->chunkFill ? len : TREE_CHUNK - d->chunkFill;
+		d->ok &= EVP_DigestUpdate(d->md, p, take);
+		p += take;
+		len -= take;
+		d->chunkFill += take;
+		if (d->chunkFill == TREE_CHUNK) {
+			unsigned char cv[32];
+			d->ok &= EVP_DigestFinal_ex(d->md, cv, NULL) & EVP_DigestUpdate(d->root, cv, 32);
+			d->chunk++;
+		}
+	}
+}
+
+//The digest, or zero with the crypto failed if any OpenSSL call on the way did
+void digestEnd(digestStream* d, unsigned char hash[32]) {
+	if (d->ok && d->crypto->backends.hash != HASH_TREE) {
+		d->ok &= EVP_DigestFinal_ex(d->md, hash, NULL);
+	} else if (d->ok) {
+		if (d->chunkFill != TREE_CHUNK) { //the last, partial chunk
+			unsigned char cv[32];
+			d->ok &= EVP_DigestFinal_ex(d->md, cv, NULL) & EVP_DigestUpdate(d->root, cv, 32);
+		}
+		d->ok &= EVP_DigestFinal_ex(d->root, hash, NULL);
+	}
+	if (d->owned) {
+		EVP_MD_CTX_free(d->md);
+		EVP_MD_CTX_free(d->root);
+	}
+	if (1 != d->ok) {
+		d->crypto->failed = 1;
+		memset(hash, 0, 32);
+	}
+}
+
+//Digest of data[0] || ... || data[count-1] under the backend hash. Every backend digest is 32 bytes.
+void backendDigest(CryptoCtx* crypto, int count, const void* const data[], const size_t lens[], unsigned char hash[32]) {
+	uint64_t total = 0;
+	for (int i = 0; i < count; i++) {
+		total += lens[i];
+	}
+	digestStream d;
+	digestBegin(&d, crypto, crypto->md, crypto->treeRoot, total);
+	for (int i = 0; i < count; i++) {
+		digestUpdate(&d, data[i], lens[i]);
+	}
+	digestEnd(&d, hash);
+}
+
+void calculateHashForBranch(CryptoCtx* crypto, const unsigned char k[16], const View* v, const unsigned char r[4], unsigned char * hash) { //calculates the hash of whole k,v and r
+	const void* data[3] = { k, v, r };
+	const size_t lens[3] = { 16, sizeof(*v), 4 };
+	backendDigest(crypto, 3, data, lens, hash);
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA_LANES 8
+#define SHA_TARGET "avx2"
+#include "../libzkboo/sha256_lanes.h"
+#undef SHA_TARGET
+#undef SHA_LANES
+
+#define SHA_LANES 16
+#define SHA_TARGET "avx512f"
+#include "../libzkboo/sha256_lanes.h"
+#undef SHA_TARGET
+#undef SHA_LANES
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+//SHA-NI, read from CPUID directly as not every gcc's __builtin_cpu_supports knows "sha"
+int cpuHasSHA(void) {
+	unsigned int eax, ebx, ecx, edx;
+	return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA);
+}
+#endif
+
+//Largest multi-buffer width commitHashes() uses for a batch of remaining commitments, 1 meaning
+//one at a time through EVP. OpenSSL hashes a single view with SHA-NI faster than 8 AVX2 lanes
+//do, but 16 AVX-512 lanes beat it, so 8 lanes are only used without SHA-NI. 4 SSE2 lanes lose
+//to OpenSSL's scalar code even without SHA-NI, so that is what runs on CPUs without AVX2.
+int commitHashLanes(int remaining) {
+#if defined(__x86_64__) || defined(__i386__)
+	if (remaining >= 16 && __builtin_cpu_supports("avx512f")) {
+		return 16;
+	}
+	if (remaining >= 8 && !cpuHasSHA() && __builtin_cpu_supports("avx2")) {
+		return 8;
+	}
+#endif
+	return 1;
+}
+
+//calculateHashForBranch for count commitments, hashing up to 16 SHA-256 ones side by side
+void commitHashes(CryptoCtx* crypto, int count, const unsigned char* keys[], const View* views[], const unsigned char* rs[], unsigned char* hashes[]) {
+	for (int i = 0; i < count; ) {
+		int lanes = crypto->backends.hash == HASH_SHA256 ? commitHashLanes(count - i) : 1;
+		switch (lanes) {
+#if defined(__x86_64__) || defined(__i386__)
+		case 16: commitHashLanes_x16(&keys[i], &views[i], &rs[i], &hashes[i]); break;
+		case 8: commitHashLanes_x8(&keys[i], &views[i], &rs[i], &hashes[i]); break;
+#endif
+		default: calculateHashForBranch(crypto, keys[i], views[i], rs[i], hashes[i]); break;
+		}
+		i += lanes;
+	}
 }
 
 
-void calculateEs(uint32_t y[8], a* as, int rounds, int* es) { //calculates in deterministic way Es for each round based on hash of (y and As)
+//The challenge of every round from the challenge digest
+void esFromDigest(CryptoCtx* crypto, const unsigned char digest[SHA256_DIGEST_LENGTH], int rounds, int* es) {
 	unsigned char hash[SHA256_DIGEST_LENGTH];
-	SHA256_CTX ctx;
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, y, 32);
-	SHA256_Update(&ctx, as, sizeof(a)*rounds);
-	SHA256_Final(hash, &ctx);
+	const void* data[1] = { hash };
+	size_t lens[1] = { sizeof(hash) };
+	memcpy(hash, digest, sizeof(hash));
 
 	//Pick bits from hash
 	int round = 0;
 	int bitPosition = 0;
 	while(round < rounds) {
 		if(bitPosition >= SHA256_DIGEST_LENGTH * 8) { //Generate new hash as we have run out of bits in the previous hash
-			SHA256_Init(&ctx);
-			SHA256_Update(&ctx, hash, sizeof(hash));
-			SHA256_Final(hash, &ctx);
+			backendDigest(crypto, 1, data, lens, hash);
 			bitPosition = 0;
 		}
 
@@ -175,27 +757,16 @@ void calculateEs(uint32_t y[8], a* as, int rounds, int* es) { //calculates in de
 			bitPosition += 2;
 		}
 	}
-
 }
 
 
 
-void reconstruct(uint32_t* y0, uint32_t* y1, uint32_t* y2, uint32_t* result) {
+void reconstruct(const uint32_t* y0, const uint32_t* y1, const uint32_t* y2, uint32_t* result) {
 	for (int i = 0; i < 8; i++) {
 		result[i] = y0[i] ^ y1[i] ^ y2[i];
 	}
 }
 
-void mpc_XOR2(uint32_t x[TWO_BRANCHES], uint32_t y[TWO_BRANCHES], uint32_t z[TWO_BRANCHES]) {
-	z[0] = x[0] ^ y[0];
-	z[1] = x[1] ^ y[1];
-}
-
-void mpc_NEGATE2(uint32_t x[TWO_BRANCHES], uint32_t z[TWO_BRANCHES]) {
-	z[0] = ~x[0];
-	z[1] = ~x[1];
-}
-
 omp_lock_t *locks;
 
 void openmp_locking_callback(int mode, int type, char *file, int line)
@@ -213,8 +784,11 @@ unsigned long openmp_thread_id(void)
   return (unsigned long)omp_get_thread_num();
 }
 
+//OpenSSL 1.1+ is thread-safe on its own and ignores these callbacks, so with per-thread
+//CryptoCtx there is no global lock left. Older versions still need them.
 void openmp_thread_setup(void)
 {
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
   int i;
   locks = OPENSSL_malloc(CRYPTO_num_locks() * sizeof(omp_lock_t));
   for (i=0; i<CRYPTO_num_locks(); i++)
@@ -223,10 +797,12 @@ void openmp_thread_setup(void)
   }
   CRYPTO_set_id_callback((unsigned long (*)())openmp_thread_id);
   CRYPTO_set_locking_callback((void (*)())openmp_locking_callback);
+#endif
 }
 
 void openmp_thread_cleanup(void)
 {
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
   int i;
   CRYPTO_set_id_callback(NULL);
   CRYPTO_set_locking_callback(NULL);
@@ -234,374 +810,628 @@ void openmp_thread_cleanup(void)
     omp_destroy_lock(&locks[i]);
   }
   OPENSSL_free(locks);
+#endif
 }
 
 
-int mpc_AND_verify(uint32_t x[TWO_BRANCHES], uint32_t y[TWO_BRANCHES], uint32_t z[TWO_BRANCHES], View ve, View ve1, unsigned char randomness[TWO_BRANCHES][2912], int* randCount, int* countY) {
-	uint32_t r[TWO_BRANCHES] = {
-		 getRandom32(randomness[0], *randCount),
-		 getRandom32(randomness[1], *randCount)
-	};
-	*randCount += 4;
-
-	uint32_t t = 0;
-
-	t = (x[0] & y[1]) ^ (x[1] & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
-	if(ve.y[*countY] != t) {
-		return 1;
+typedef enum {
+	VERIFY_OK = 0,
+	VERIFY_BAD_COMMITMENT, //an opened branch does not hash to its commitment
+	VERIFY_BAD_OUTPUT, //an opened branch's output share differs from yp
+	VERIFY_BAD_GATE, //a y word of the views is inconsistent with the circuit
+	VERIFY_BAD_CHALLENGE, //the commitments rebuilt from a compact proof do not hash to its challenge digest
+	VERIFY_BAD_FILE, //a streamed proof ends early, has trailing bytes or an index that does not fit it
+	VERIFY_CRYPTO_ERROR, //an OpenSSL call failed, so the proof could not be checked
+	VERIFY_NO_MEMORY //the working memory of the check could not be allocated
+} verifyReason;
+
+const char* verifyReasonString(verifyReason reason) {
+	switch (reason) {
+	case VERIFY_OK: return "verified";
+	case VERIFY_BAD_COMMITMENT: return "commitment mismatch";
+	case VERIFY_BAD_OUTPUT: return "output share mismatch";
+	case VERIFY_BAD_GATE: return "inconsistent gate";
+	case VERIFY_BAD_CHALLENGE: return "challenge mismatch";
+	case VERIFY_BAD_FILE: return "malformed proof file";
+	case VERIFY_CRYPTO_ERROR: return "OpenSSL error";
+	case VERIFY_NO_MEMORY: return "out of memory";
 	}
-	z[0] = t;
-	z[1] = ve1.y[*countY];
-
-	(*countY)++;
-	debug_print("countY increased by mpc_AND_verify to %d.\n",(*countY));
-	return 0;
+	return "unknown";
 }
 
-
-int mpc_ADD_verify(uint32_t x[TWO_BRANCHES], uint32_t y[TWO_BRANCHES], uint32_t z[TWO_BRANCHES], View ve, View ve1, unsigned char randomness[TWO_BRANCHES][2912], int* randCount, int* countY) {
-	uint32_t r[TWO_BRANCHES] = {
-		 getRandom32(randomness[0], *randCount),
-		 getRandom32(randomness[1], *randCount)
-	};
-	*randCount += 4;
-
-	uint8_t a[TWO_BRANCHES];
-	uint8_t b[TWO_BRANCHES];
-	uint8_t t;
-
-	for(int i=0;i<31;i++)
-	{
-		a[0]=GETBIT(x[0] ^  ve.y[*countY], i);
-		a[1]=GETBIT(x[1] ^ ve1.y[*countY], i);
-
-		b[0]=GETBIT(y[0] ^  ve.y[*countY], i);
-		b[1]=GETBIT(y[1] ^ ve1.y[*countY], i);
-
-		t = (a[0]&b[1]) ^ (a[1]&b[0]) ^ GETBIT(r[1],i);
-		if(GETBIT(ve.y[*countY],i+1) != (t ^ (a[0]&b[0]) ^ GETBIT(ve.y[*countY],i) ^ GETBIT(r[0],i))) {
-			return 1;
-		}
+//The two opened branches as the gate checks see them. For a ZKB++ proof, which does not carry
+//branch 0's y words, fill aliases ve0's y and the gates compute the words into it instead of
+//checking them. fill is NULL otherwise. plan is the schedule of block block.
+typedef struct {
+	const View* ve0;
+	const View* ve1;
+	uint32_t* fill;
+	const gatePlan* plan;
+	int block;
+} openedViews;
+
+//1. First check if hashes of branches are ok. hashes are the recomputed commitments of the two
+//opened branches, H(z.ke0, z.ve0, z.re0) and H(z.ke1, z.ve1, z.re1).
+verifyReason verifyCommitments(const a* a, int e, unsigned char hashes[TWO_BRANCHES][SHA256_DIGEST_LENGTH]) {
+	if (memcmp(a->h[(e + 0) % NUM_BRANCHES], hashes[0], 32) != 0) {
+#if VERBOSE
+		printf("Failing at %d", __LINE__);
+#endif
+		return VERIFY_BAD_COMMITMENT;
 	}
-
-	z[0]=x[0]^y[0] ^  ve.y[*countY];
-	z[1]=x[1]^y[1] ^ ve1.y[*countY];
-	(*countY)++;
-	debug_print("countY increased by mpc_ADD_verify to %d.\n",(*countY));
-	return 0;
-}
-
-void mpc_RIGHTROTATE2(uint32_t x[TWO_BRANCHES], int bits, uint32_t z[TWO_BRANCHES]) {
-	z[0] = RIGHTROTATE(x[0], bits);
-	z[1] = RIGHTROTATE(x[1], bits);
-}
-
-void mpc_RIGHTSHIFT2(uint32_t x[TWO_BRANCHES], int bits, uint32_t z[TWO_BRANCHES]) {
-	z[0] = x[0] >> bits;
-	z[1] = x[1] >> bits;
+	if (memcmp(a->h[(e + 1) % NUM_BRANCHES], hashes[1], 32) != 0) {
+#if VERBOSE
+		printf("Failing at %d", __LINE__);
+#endif
+		return VERIFY_BAD_COMMITMENT;
+	}
+	return VERIFY_OK;
 }
 
-int mpc_MAJ_verify(uint32_t a[TWO_BRANCHES], uint32_t b[TWO_BRANCHES], uint32_t c[TWO_BRANCHES], uint32_t z[NUM_BRANCHES], View ve, View ve1, unsigned char randomness[TWO_BRANCHES][2912], int* randCount, int* countY) {
-	uint32_t t0[NUM_BRANCHES];
-	uint32_t t1[NUM_BRANCHES];
+//Runs one SHA-256 compression on the two opened branches from their shares state of the
+//chaining value, or from the plan's iv when it is not chained, with tapes at the block's start,
+//checking (or with views->fill, computing) branch 0's y word of every gate that is not local in
+//views->plan. state receives each branch's share of the compression's output.
+verifyReason evalOpenedBlock(openedViews* views, Tape tapes[TWO_BRANCHES], uint32_t state[TWO_BRANCHES][8]) {
+	const circuit* c = sha256Circuit();
+	branches regs[CIRCUIT_MAX_REGISTERS];
+	const unsigned char* x0 = views->ve0->x;
+	const unsigned char* x1 = views->ve1->x;
+	for (int j = 0; j < 16; j++) {
+		regs[j][0] = (x0[j * 4] << 24) | (x0[j * 4 + 1] << 16) | (x0[j * 4 + 2] << 8) | x0[j * 4 + 3];
+		regs[j][1] = (x1[j * 4] << 24) | (x1[j * 4 + 1] << 16) | (x1[j * 4 + 2] << 8) | x1[j * 4 + 3];
+	}
+	//The gates take the words without input bytes to be public, so both views must hold the
+	//prefix, message, padding and length of the plan's message around the input bytes
+	const gatePlan* plan = views->plan;
+	const unsigned char* public = publicBytes(plan, views->block);
+	for (int j = 0; j < 64 && plan->checkPublic; j++) {
+		if ((j < plan->secretFrom || j >= plan->secretTo) && (x0[j] != public[j] || x1[j] != public[j])) {
+#if VERBOSE
+			printf("Failing at %d", __LINE__);
+#endif
+			return VERIFY_BAD_GATE;
+		}
+	}
+	for (int i = 0; i < 8; i++) {
+		regs[SHA256_STATE_REGISTER + i][0] = plan->chained ? state[0][i] : plan->iv[i];
+		regs[SHA256_STATE_REGISTER + i][1] = plan->chained ? state[1][i] : plan->iv[i];
+	}
 
-	mpc_XOR2(a, b, t0);
-	mpc_XOR2(a, c, t1);
-	if(mpc_AND_verify(t0, t1, z, ve, ve1, randomness, randCount, countY) == 1) {
-		return 1;
+	int countY = 0;
+	int failing = sha256VerifyKernel(plan->local, regs, tapes, views->ve0->y, views->ve1->y, views->fill, &countY);
+	if (failing >= 0) {
+#if VERBOSE
+		printf("Failing at %d, gate %d", __LINE__, failing);
+#endif
+		return VERIFY_BAD_GATE;
 	}
-	mpc_XOR2(z, a, z);
-	return 0;
+	for (int i = 0; i < 8; i++) {
+		state[0][i] = regs[c->output[i]][0];
+		state[1][i] = regs[c->output[i]][1];
+	}
+	return VERIFY_OK;
 }
 
-int mpc_CH_verify(uint32_t e[TWO_BRANCHES], uint32_t f[TWO_BRANCHES], uint32_t g[TWO_BRANCHES], uint32_t z[TWO_BRANCHES], View ve, View ve1, unsigned char randomness[TWO_BRANCHES][2912], int* randCount, int* countY) {
-	uint32_t t0[NUM_BRANCHES];
-	mpc_XOR2(f,g,t0);
-	if(mpc_AND_verify(e, t0, t0, ve, ve1, randomness, randCount, countY) == 1) {
-		return 1;
+//evalOpenedBlock for the first block, from the plan's public initial state and tapes from
+//keys ke0 and ke1. outputs receives each branch's share of the block's output.
+verifyReason evalOpenedBranches(openedViews* views, const unsigned char ke0[16], const unsigned char ke1[16], CryptoCtx* crypto, uint32_t outputs[TWO_BRANCHES][8]) {
+	//Generate deterministicaly randomness for both branches based on the supplied keys,
+	//a chunk at a time as the gates below consume it
+	Tape tapes[TWO_BRANCHES];
+	tapeInit(&tapes[0], crypto, ke0);
+	tapeInit(&tapes[1], crypto, ke1);
+	for (int i = 0; i < 8; i++) {
+		outputs[0][i] = views->plan->iv[i];
+		outputs[1][i] = views->plan->iv[i];
 	}
-	mpc_XOR2(t0,g,z);
-	return 0;
+	return evalOpenedBlock(views, tapes, outputs);
 }
 
+//The checks of verifyRound after the commitments, for rounds whose commitments were checked in a batch
+verifyReason verifyRoundViews(const a* a, int e, const z* z, const gatePlan* plan, CryptoCtx* crypto) {
 
-int verifyRound(a a, int e, z z) {
-
-	//1. First check if hashes of branches are ok.
-	unsigned char* hash = malloc(SHA256_DIGEST_LENGTH);
-	calculateHashForBranch(z.ke0, z.ve0, z.re0, hash); //calculate hash from z.ke0, z.ve0 a z.re0
-
-	if (memcmp(a.h[(e + 0) % NUM_BRANCHES], hash, 32) != 0) {
+	//2. Check if last step in view is equal to yp for both branches
+	if (memcmp(a->yp[(e + 0) % NUM_BRANCHES], &z->ve0.y[ySize - 8], 32) != 0) { //a.yp[e] must contain same thing as z.ve.y[ySize - 8]
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
-		return 1;
+		return VERIFY_BAD_OUTPUT;
 	}
-	calculateHashForBranch(z.ke1, z.ve1, z.re1, hash); //calculate hash from z.ke1, z.ve1 a z.re1
-	if (memcmp(a.h[(e + 1) % NUM_BRANCHES], hash, 32) != 0) { 
+
+	if (memcmp(a->yp[(e + 1) % NUM_BRANCHES], &z->ve1.y[ySize - 8], 32) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
-		return 1;
+		return VERIFY_BAD_OUTPUT;
 	}
-	free(hash);
 
-	//2. Check if last step in view is equal to yp for both branches
-	uint32_t* result = malloc(32);
-	memcpy(result, &(z.ve0).y[ySize - 8], 32);
-	if (memcmp(a.yp[(e + 0) % NUM_BRANCHES], result, 32) != 0) { //a.yp[e] must contain same thing as z.ve.y[ySize - 8]
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	//3. Run the circuit on both branches, checking every gate
+	openedViews views = { &z->ve0, &z->ve1, NULL, plan, 0 };
+	uint32_t outputs[TWO_BRANCHES][8];
+	verifyReason reason = evalOpenedBranches(&views, z->ke0, z->ke1, crypto, outputs);
+	if (reason != VERIFY_OK) {
+		return reason;
 	}
 
-	memcpy(result, &z.ve1.y[ySize - 8], 32);
-	if (memcmp(a.yp[(e + 1) % NUM_BRANCHES], result, 32) != 0) {
+	//4. The output shares the views claim must be those the circuit computes
+	if (memcmp(outputs[0], &z->ve0.y[ySize - 8], 32) != 0 || memcmp(outputs[1], &z->ve1.y[ySize - 8], 32) != 0) {
 #if VERBOSE
 		printf("Failing at %d", __LINE__);
 #endif
-		return 1;
+		return VERIFY_BAD_OUTPUT;
 	}
+	return VERIFY_OK;
+}
 
-	free(result);
-
-	//3. Generate deterministicaly randomness for both branches based on the supplied AES keys
-	unsigned char randomness[TWO_BRANCHES][2912];
-	getAllRandomness(z.ke0, randomness[0]);
-	getAllRandomness(z.ke1, randomness[1]);
-
-	int* randCount = calloc(1, sizeof(int));
-	int* countY    = calloc(1, sizeof(int));
-
+verifyReason verifyRound(const a* a, int e, const z* z, const gatePlan* plan, CryptoCtx* crypto) {
+	unsigned char hashes[TWO_BRANCHES][SHA256_DIGEST_LENGTH];
+	calculateHashForBranch(crypto, z->ke0, &z->ve0, z->re0, hashes[0]); //calculate hash from z.ke0, z.ve0 a z.re0
+	calculateHashForBranch(crypto, z->ke1, &z->ve1, z->re1, hashes[1]); //calculate hash from z.ke1, z.ve1 a z.re1
+	verifyReason reason = verifyCommitments(a, e, hashes);
+	if (reason != VERIFY_OK) {
+		return reason;
+	}
+	return verifyRoundViews(a, e, z, plan, crypto);
+}
 
-	//4. calculate initial state for SHA256 based on shares.
-	uint32_t w[64][TWO_BRANCHES];
-	for (int j = 0; j < 16; j++) {
-		w[j][0] = (z.ve0.x[j * 4] << 24) | (z.ve0.x[j * 4 + 1] << 16) | (z.ve0.x[j * 4 + 2] << 8) | z.ve0.x[j * 4 + 3];
-		w[j][1] = (z.ve1.x[j * 4] << 24) | (z.ve1.x[j * 4 + 1] << 16) | (z.ve1.x[j * 4 + 2] << 8) | z.ve1.x[j * 4 + 3];
+//The checks of one round of an input of several blocks, made block by block as its views come
+//in: every block's gates, and that its output words, which the next block starts from, are
+//those the gates compute. The commitments are hashed along the way and checked at the end,
+//along with the last block's output words against the round's yp.
+typedef struct {
+	const a* a;
+	int e;
+	const messagePlan* plans;
+	int block; //the next block
+	Tape tapes[TWO_BRANCHES];
+	uint32_t state[TWO_BRANCHES][8]; //the opened branches' shares of the chaining value
+	uint32_t digest[TWO_BRANCHES][8]; //their shares of the digest last kept, see gatePlan.keeps
+	unsigned char key[TWO_BRANCHES][64]; //their input shares in block 0, see gatePlan.repeats
+	digestStream hashes[TWO_BRANCHES];
+	verifyReason reason;
+} roundCheck;
+
+void roundCheckBegin(roundCheck* check, CryptoCtx* crypto, const a* a, int e, const unsigned char ke0[16], const unsigned char ke1[16], const messagePlan* plans) {
+	const unsigned char* keys[TWO_BRANCHES] = { ke0, ke1 };
+	check->a = a;
+	check->e = e;
+	check->plans = plans;
+	check->block = 0;
+	check->reason = VERIFY_OK;
+	for (int branch = 0; branch < TWO_BRANCHES; branch++) {
+		tapeInit(&check->tapes[branch], crypto, keys[branch]);
+		memcpy(check->state[branch], plans->first.iv, sizeof(plans->first.iv));
+		digestStreamNew(&check->hashes[branch], crypto, 16 + sizeof(View) * (uint64_t)plans->blocks + 4);
+		digestUpdate(&check->hashes[branch], keys[branch], 16);
 	}
+}
 
-	uint32_t s0[TWO_BRANCHES], s1[TWO_BRANCHES];
-	uint32_t t0[TWO_BRANCHES], t1[TWO_BRANCHES];
-	for (int j = 16; j < 64; j++) {
-		//s0[i] = RIGHTROTATE(w[i][j-15],7) ^ RIGHTROTATE(w[i][j-15],18) ^ (w[i][j-15] >> 3);
-		mpc_RIGHTROTATE2(w[j-15],  7, t0);
-		mpc_RIGHTROTATE2(w[j-15], 18, t1);
-		mpc_XOR2(t0, t1, t0);
-		mpc_RIGHTSHIFT2(w[j-15], 3, t1);
-		mpc_XOR2(t0, t1, s0);
-
-		//s1[i] = RIGHTROTATE(w[i][j-2],17) ^ RIGHTROTATE(w[i][j-2],19) ^ (w[i][j-2] >> 10);
-		mpc_RIGHTROTATE2(w[j-2], 17, t0);
-		mpc_RIGHTROTATE2(w[j-2], 19, t1);
-		mpc_XOR2(t0, t1, t0);
-		mpc_RIGHTSHIFT2(w[j-2],10, t1);
-		mpc_XOR2(t0, t1, s1);
-
-		//w[i][j] = w[i][j-16]+s0[i]+w[i][j-7]+s1[i];
-
-		if(mpc_ADD_verify(w[j-16], s0, t1, z.ve0, z.ve1, randomness, randCount, countY) == 1) {
+//Checks the next block, whose opened views are ve0 and ve1. Once a block fails the rest are skipped.
+verifyReason roundCheckBlock(roundCheck* check, const View* ve0, const View* ve1) {
+	if (check->reason != VERIFY_OK) {
+		return check->reason;
+	}
+	digestUpdate(&check->hashes[0], ve0, sizeof(View));
+	digestUpdate(&check->hashes[1], ve1, sizeof(View));
+	tapeSeekBlock(&check->tapes[0], check->block);
+	tapeSeekBlock(&check->tapes[1], check->block);
+	const gatePlan* plan = blockPlan(check->plans, check->block);
+	const View* opened[TWO_BRANCHES] = { ve0, ve1 };
+	for (int branch = 0; branch < TWO_BRANCHES; branch++) {
+		const unsigned char* x = opened[branch]->x;
+		//Input bytes that are not the input's own have to be the shares they stand for: a digest
+		//must be the one kept, written out as digestBlock does, and repeated input bytes block 0's
+		unsigned char expected[64];
+		if (plan->linked) {
+			digestBlock(check->digest[branch], plan, expected);
+			if (memcmp(x, expected, 32) != 0) {
 #if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, j);
+				printf("Failing at %d", __LINE__);
 #endif
-			return 1;
+				check->reason = VERIFY_BAD_GATE;
+			}
 		}
-
-
-		if(mpc_ADD_verify(w[j-7], t1, t1, z.ve0, z.ve1, randomness, randCount, countY) == 1) {
+		for (int j = plan->secretFrom; j < plan->secretTo; j++) {
+			if (check->block == 0) {
+				check->key[branch][j] = x[j] ^ plan->padded[j];
+			} else if (plan->repeats && (x[j] ^ plan->padded[j]) != check->key[branch][j]) {
 #if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, j);
+				printf("Failing at %d", __LINE__);
 #endif
-			return 1;
+				check->reason = VERIFY_BAD_GATE;
+				break;
+			}
 		}
-		if(mpc_ADD_verify(t1, s1, w[j], z.ve0, z.ve1, randomness, randCount, countY) == 1) {
+	}
+	if (check->reason == VERIFY_OK) {
+		openedViews views = { ve0, ve1, NULL, plan, check->block };
+		check->reason = evalOpenedBlock(&views, check->tapes, check->state);
+	}
+	if (check->reason == VERIFY_OK && (memcmp(check->state[0], &ve0->y[ySize - 8], 32) != 0 || memcmp(check->state[1], &ve1->y[ySize - 8], 32) != 0)) {
 #if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, j);
+		printf("Failing at %d", __LINE__);
 #endif
-			return 1;
-		}
+		check->reason = VERIFY_BAD_OUTPUT;
 	}
+	if (plan->keeps) {
+		memcpy(check->digest, check->state, sizeof(check->digest));
+	}
+	check->block++;
+	return check->reason;
+}
 
-	uint32_t va[TWO_BRANCHES] = { hA[0],hA[0] };
-	uint32_t vb[TWO_BRANCHES] = { hA[1],hA[1] };
-	uint32_t vc[TWO_BRANCHES] = { hA[2],hA[2] };
-	uint32_t vd[TWO_BRANCHES] = { hA[3],hA[3] };
-	uint32_t ve[TWO_BRANCHES] = { hA[4],hA[4] };
-	uint32_t vf[TWO_BRANCHES] = { hA[5],hA[5] };
-	uint32_t vg[TWO_BRANCHES] = { hA[6],hA[6] };
-	uint32_t vh[TWO_BRANCHES] = { hA[7],hA[7] };
-	uint32_t temp1[NUM_BRANCHES], temp2[NUM_BRANCHES], maj[NUM_BRANCHES];
-	for (int i = 0; i < 64; i++) {
-		//s1 = RIGHTROTATE(e,6) ^ RIGHTROTATE(e,11) ^ RIGHTROTATE(e,25);
-		mpc_RIGHTROTATE2(ve, 6, t0);
-		mpc_RIGHTROTATE2(ve, 11, t1);
-		mpc_XOR2(t0, t1, t0);
-		mpc_RIGHTROTATE2(ve, 25, t1);
-		mpc_XOR2(t0, t1, s1);
-
+//Ends the round with the opened branches' rs, freeing the hashes whatever the outcome
+verifyReason roundCheckEnd(roundCheck* check, const unsigned char re0[4], const unsigned char re1[4]) {
+	unsigned char hashes[TWO_BRANCHES][SHA256_DIGEST_LENGTH];
+	digestUpdate(&check->hashes[0], re0, 4);
+	digestUpdate(&check->hashes[1], re1, 4);
+	digestEnd(&check->hashes[0], hashes[0]);
+	digestEnd(&check->hashes[1], hashes[1]);
+	if (check->reason != VERIFY_OK) {
+		return check->reason;
+	}
+	verifyReason reason = verifyCommitments(check->a, check->e, hashes);
+	if (reason != VERIFY_OK) {
+		return reason;
+	}
+	if (memcmp(check->a->yp[check->e], check->state[0], 32) != 0 || memcmp(check->a->yp[(check->e + 1) % NUM_BRANCHES], check->state[1], 32) != 0) {
+#if VERBOSE
+		printf("Failing at %d", __LINE__);
+#endif
+		return VERIFY_BAD_OUTPUT;
+	}
+	return VERIFY_OK;
+}
 
+//verifyRound for an opening z of several blocks
+verifyReason verifyRoundBlocks(const a* a, int e, const z* z, const messagePlan* plans, CryptoCtx* crypto) {
+	roundCheck check;
+	roundCheckBegin(&check, crypto, a, e, z->ke0, z->ke1, plans);
+	for (int block = 0; block < plans->blocks; block++) {
+		if (roundCheckBlock(&check, openedView(z, block, 0), openedView(z, block, 1)) != VERIFY_OK) {
+			break;
+		}
+	}
+	return roundCheckEnd(&check, openedR(z, plans->blocks, 0), openedR(z, plans->blocks, 1));
+}
 
+typedef struct {
+	int round; //first round that did not verify, -1 if all did
+	verifyReason reason;
+} verifyResult;
+
+//The result of a check that an OpenSSL call failed in, whatever the rounds it checked said
+static inline verifyResult cryptoFailure(void) {
+	verifyResult result = { 0, VERIFY_CRYPTO_ERROR };
+	return result;
+}
 
-		//ch = (e & f) ^ ((~e) & g);
-		//temp1 = h + s1 + CH(e,f,g) + k[i]+w[i];
+//Rounds verifyProof takes at a time, hashing their opened views together
+#define VERIFY_BATCH 8
+
+//Verifies rounds first to first + count - 1 of a proof with gate schedules plans, whose openings
+//are back to back from batch. Rounds after *firstFail are skipped. A failing round lower than *firstFail
+//is stored there and in *result, so that callers sharing them end up with the lowest one.
+void verifyBatch(CryptoCtx* crypto, const a* as, const int* es, const z* batch, const messagePlan* plans, int first, int count, int* firstFail, verifyResult* result) {
+	int stop;
+	#pragma omp atomic read
+	stop = *firstFail;
+	if (first > stop) {
+		return;
+	}
 
-		//t0 = h + s1
+	//Openings of a single block have their commitments hashed side by side first
+	int blocks = plans->blocks;
+	unsigned char hashes[VERIFY_BATCH][TWO_BRANCHES][SHA256_DIGEST_LENGTH];
+	const unsigned char* hashKeys[VERIFY_BATCH * TWO_BRANCHES];
+	const unsigned char* hashRs[VERIFY_BATCH * TWO_BRANCHES];
+	const View* hashViews[VERIFY_BATCH * TWO_BRANCHES];
+	unsigned char* hashOut[VERIFY_BATCH * TWO_BRANCHES];
+	for (int i = 0; i < count && blocks == 1; i++) {
+		const z* z = &batch[i];
+		hashKeys[2 * i] = z->ke0;
+		hashViews[2 * i] = &z->ve0;
+		hashRs[2 * i] = z->re0;
+		hashOut[2 * i] = hashes[i][0];
+		hashKeys[2 * i + 1] = z->ke1;
+		hashViews[2 * i + 1] = &z->ve1;
+		hashRs[2 * i + 1] = z->re1;
+		hashOut[2 * i + 1] = hashes[i][1];
+	}
+	if (blocks == 1) {
+		commitHashes(crypto, count * TWO_BRANCHES, hashKeys, hashViews, hashRs, hashOut);
+	}
 
-		if(mpc_ADD_verify(vh, s1, t0, z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
+	for (int round = first; round < first + count; round++) {
+		#pragma omp atomic read
+		stop = *firstFail;
+		if (round > stop) {
+			break;
 		}
+		verifyReason reason;
+		if (blocks > 1) {
+			reason = verifyRoundBlocks(&as[round], es[round], fullOpening(batch, blocks, round - first), plans, crypto);
+		} else {
+			reason = verifyCommitments(&as[round], es[round], hashes[round - first]);
+			if (reason == VERIFY_OK) {
+				reason = verifyRoundViews(&as[round], es[round], &batch[round - first], &plans->first, crypto);
+			}
+		}
+		if (reason != VERIFY_OK) {
+			#pragma omp critical(verifyProofFirstFail)
+			{
+				if (round < *firstFail) {
+					#pragma omp atomic write
+					*firstFail = round;
+					result->round = round;
+					result->reason = reason;
+				}
+			}
+			break;
+		}
+	}
+}
 
+//Verifies all rounds on up to threads threads (0 means the OpenMP default). Rounds after the
+//first failing one found so far are skipped, but every earlier round is still checked, so the
+//result is the lowest failing round and its reason for any thread count and schedule.
+verifyResult verifyProof(Backends backends, const a* as, const int* es, const z* zs, const messagePlan* plans, int rounds, int threads) {
+	verifyResult result = { -1, VERIFY_OK };
+	int firstFail = rounds;
+	if (threads <= 0) {
+		threads = omp_get_max_threads();
+	}
 
-
-		if(mpc_CH_verify(ve, vf, vg, t1, z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
+	int failed = 0;
+	#pragma omp parallel num_threads(threads)
+	{
+		CryptoCtx crypto;
+		initCryptoCtx(&crypto, backends);
+		#pragma omp for schedule(dynamic)
+		for (int first = 0; first < rounds; first += VERIFY_BATCH) {
+			int count = rounds - first < VERIFY_BATCH ? rounds - first : VERIFY_BATCH;
+			verifyBatch(&crypto, as, es, fullOpening(zs, plans->blocks, first), plans, first, count, &firstFail, &result);
 		}
+		cryptoFailed(&crypto, &failed);
+		cleanupCryptoCtx(&crypto);
+	}
+	return failed ? cryptoFailure() : result;
+}
 
-		//t1 = t0 + t1 (h+s1+ch)
-		if(mpc_ADD_verify(t0, t1, t1, z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
+#include "../libzkboo/container.h"
 
-		t0[0] = k[i];
-		t0[1] = k[i];
-		if(mpc_ADD_verify(t1, t0, t1, z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
+_Static_assert(sizeof(a) % CONTAINER_ALIGN == 0 && sizeof(z) % CONTAINER_ALIGN == 0,
+		"full proofs are written and read in place as bare a and z arrays");
 
+//The gate schedules of a proof made with params
+void planProof(const ProofParams* params, messagePlan* plans) {
+	if (params->hmac) {
+		planHmac(params->prefix, params->prefixLen, params->inputLen, params->publicGates, plans);
+		return;
+	}
+	planPrefixedMessage(params->prefix, params->prefixLen, params->inputLen, params->publicGates, plans);
+	planChain(params->rehashes, params->publicGates, plans);
+}
 
+//The blocks planProof gives params, without planning them
+static inline int proofBlocks(const ProofParams* params) {
+	return params->hmac ? hmacBlocks(params->prefixLen) : messageBlocks(params->prefixLen, params->inputLen) + params->rehashes;
+}
 
-		if(mpc_ADD_verify(t1, w[i], temp1, z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
+//The inputLen the header of a proof made with params records: the input's length where the
+//proof depends on it, else 0
+static inline uint32_t recordedInputLen(const ProofParams* params) {
+	return params->compact || params->publicGates || params->prefixLen > 0 || proofBlocks(params) > 1 ? params->inputLen : 0;
+}
 
-		//s0 = RIGHTROTATE(a,2) ^ RIGHTROTATE(a,13) ^ RIGHTROTATE(a,22);
-		mpc_RIGHTROTATE2(va, 2, t0);
-		mpc_RIGHTROTATE2(va, 13, t1);
-		mpc_XOR2(t0, t1, t0);
-		mpc_RIGHTROTATE2(va, 22, t1);
-		mpc_XOR2(t0, t1, s0);
+//The header flags of a proof made with params
+static inline uint8_t proofFlags(const ProofParams* params) {
+	return (params->compact ? CONTAINER_COMPACT : 0) | (params->publicGates ? CONTAINER_PUBLIC_GATES : 0) | (params->hmac ? CONTAINER_HMAC : 0);
+}
 
-		//maj = (a & (b ^ c)) ^ (b & c);
-		//(a & b) ^ (a & c) ^ (b & c)
+//What a proof of rounds rounds made with params proves, as its header records it: the circuit,
+//PRG, hash and flags bytes, then rounds, inputLen, prefixLen and rehashes as little-endian
+//32-bit words
+#define STATEMENT_BYTES 20
+void proofStatement(const ProofParams* params, int rounds, unsigned char statement[STATEMENT_BYTES]) {
+	uint32_t words[4] = { rounds, recordedInputLen(params), params->prefixLen, params->rehashes };
+	statement[0] = CIRCUIT_SHA256;
+	statement[1] = params->backends.prg;
+	statement[2] = params->backends.hash;
+	statement[3] = proofFlags(params);
+	for (int i = 0; i < 16; i++) {
+		statement[4 + i] = words[i / 4] >> (8 * (i % 4));
+	}
+}
 
-		if(mpc_MAJ_verify(va, vb, vc, maj, z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
+//The Fiat-Shamir hash of y, all commitments, the statement of a proof made with params and the
+//public prefix hashed ahead of the input, if any, that the challenges are drawn from. Binding
+//the statement keeps a prover from picking the gates computed in the clear, the chain length or
+//HMAC after seeing the challenges. params NULL is a proof in the original headerless format,
+//whose challenges come from y and the commitments alone.
+void challengeDigest(CryptoCtx* crypto, const ProofParams* params, const uint32_t y[8], const a* as, int rounds, unsigned char digest[SHA256_DIGEST_LENGTH]) {
+	unsigned char statement[STATEMENT_BYTES];
+	const void* data[4] = { y, as, statement, NULL };
+	size_t lens[4] = { 32, sizeof(a) * rounds, sizeof(statement), 0 };
+	if (!params) {
+		backendDigest(crypto, 2, data, lens, digest);
+		return;
+	}
+	proofStatement(params, rounds, statement);
+	data[3] = params->prefix;
+	lens[3] = params->prefixLen;
+	backendDigest(crypto, params->prefixLen > 0 ? 4 : 3, data, lens, digest);
+}
 
-		//temp2 = s0+maj;
-		if(mpc_ADD_verify(s0, maj, temp2, z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
+//Calculates in a deterministic way the e of each round, from challengeDigest
+void calculateEs(CryptoCtx* crypto, const ProofParams* params, const uint32_t y[8], const a* as, int rounds, int* es) {
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	challengeDigest(crypto, params, y, as, rounds, digest);
+	esFromDigest(crypto, digest, rounds, es);
+}
 
-		memcpy(vh, vg, sizeof(uint32_t) * TWO_BRANCHES);
-		memcpy(vg, vf, sizeof(uint32_t) * TWO_BRANCHES);
-		memcpy(vf, ve, sizeof(uint32_t) * TWO_BRANCHES);
-		//e = d+temp1;
-		if(mpc_ADD_verify(vd, temp1, ve, z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
+#include "zkbpp.h"
 
-		memcpy(vd, vc, sizeof(uint32_t) * TWO_BRANCHES);
-		memcpy(vc, vb, sizeof(uint32_t) * TWO_BRANCHES);
-		memcpy(vb, va, sizeof(uint32_t) * TWO_BRANCHES);
-		//a = temp1+temp2;
+//Bytes of the public section before the prefix: the commitments of full openings, or the hash
+//and challenge digest of compact ones
+static inline uint64_t publicBaseBytes(int compact, int rounds) {
+	return compact ? sizeof(uint32_t) * 8 + SHA256_DIGEST_LENGTH : sizeof(a) * (uint64_t)rounds;
+}
 
-		if(mpc_ADD_verify(temp1, temp2, va, z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d, iteration %d", __LINE__, i);
-#endif
-			return 1;
-		}
+//The container header and round index (rounds + 1 entries) of a proof made with params whose
+//challenges are es
+void proofLayout(const ProofParams* params, const int* es, int rounds, containerHeader* header, uint64_t index[]) {
+	memset(header, 0, sizeof(*header));
+	header->circuit = CIRCUIT_SHA256;
+	header->prg = params->backends.prg;
+	header->hash = params->backends.hash;
+	header->flags = proofFlags(params);
+	header->rounds = rounds;
+	header->viewWords = ySize;
+	header->outputWords = 8;
+	header->inputLen = recordedInputLen(params);
+	messagePlan plans;
+	planProof(params, &plans);
+	header->prefixLen = params->prefixLen;
+	header->rehashes = params->rehashes;
+	header->publicBytes = publicBaseBytes(params->compact, rounds) + params->prefixLen;
+	size_t openingBytes[rounds];
+	for (int round = 0; round < rounds; round++) {
+		openingBytes[round] = params->compact ? compactOpeningBytes(es[round], &plans.first) : fullOpeningBytes(plans.blocks);
 	}
+	containerLayout(header, openingBytes, index);
+}
 
-	uint32_t hHa[8][NUM_BRANCHES] = {
-		 { hA[0],hA[0],hA[0] },
-		 { hA[1],hA[1],hA[1] },
-		 { hA[2],hA[2],hA[2] },
-		 { hA[3],hA[3],hA[3] },
-		 { hA[4],hA[4],hA[4] },
-		 { hA[5],hA[5],hA[5] },
-		 { hA[6],hA[6],hA[6] },
-		 { hA[7],hA[7],hA[7] }
-	};
-	if(mpc_ADD_verify(hHa[0], va, hHa[0], z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+//Writes the container header and round index of a proof. The public section is next, then
+//the openings, each followed by containerPad.
+void writeProofHead(FILE* file, const ProofParams* params, const int* es, int rounds) {
+	containerHeader header;
+	uint64_t index[rounds + 1];
+	proofLayout(params, es, rounds, &header, index);
+	writeContainerHead(file, &header, index);
+}
+
+typedef enum {
+	PROOF_OK = 0,
+	PROOF_UNRECOGNISED,
+	PROOF_OTHER_CIRCUIT, //a proof for another hash function, see mappedProof.circuit
+	PROOF_WRONG_ROUNDS,
+	PROOF_NO_MEMORY //a streamed proof's memory could not be allocated
+} proofStatus;
+
+//A proof file read in place: the pointers, params.prefix included, are into its mapping
+typedef struct {
+	CircuitId circuit;
+	ProofParams params;
+	int rounds;
+	const containerHeader* header; //NULL for a file in the original headerless format
+	const a* as; //full openings
+	const z* zs; //full openings, back to back, each fullOpeningBytes(plan.blocks) long
+	const uint32_t* y; //compact openings
+	const unsigned char* digest; //compact openings
+	messagePlan plan;
+} mappedProof;
+
+//Checks the fields of a container header that are particular to SHA-256 proofs of minRounds
+//rounds or more and fills in the circuit, rounds and params of proof from it. The gate plan
+//needs the prefix, which follows in the public section, see planProof.
+proofStatus proofHeaderStatus(const containerHeader* header, int minRounds, mappedProof* proof) {
+	proof->header = header;
+	proof->circuit = header->circuit;
+	proof->rounds = header->rounds > CONTAINER_MAX_ROUNDS ? CONTAINER_MAX_ROUNDS + 1 : (int)header->rounds;
+	int rounds = proof->rounds;
+	if (header->circuit != CIRCUIT_SHA256) {
+		return PROOF_OTHER_CIRCUIT;
 	}
-	if(mpc_ADD_verify(hHa[1], vb, hHa[1], z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	if (rounds < minRounds || rounds > CONTAINER_MAX_ROUNDS) {
+		return PROOF_WRONG_ROUNDS;
 	}
-	if(mpc_ADD_verify(hHa[2], vc, hHa[2], z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	if (header->viewWords != ySize || header->outputWords != 8 || header->prg >= NUM_PRGS || header->hash >= NUM_HASHES
+			|| (header->flags & ~(CONTAINER_COMPACT | CONTAINER_PUBLIC_GATES | CONTAINER_HMAC)) != 0 || header->inputLen > MAX_INPUT_BYTES
+			|| header->prefixLen > MAX_PREFIX_BYTES || header->rehashes > MAX_REHASHES
+			|| ((header->flags & CONTAINER_COMPACT) && (header->prefixLen % 64 + header->inputLen > BLOCK_INPUT_BYTES || header->rehashes > 0))
+			|| ((header->flags & CONTAINER_HMAC) && (header->flags & CONTAINER_COMPACT || header->rehashes > 0 || header->inputLen > 64))) {
+		return PROOF_UNRECOGNISED;
 	}
-	if(mpc_ADD_verify(hHa[3], vd, hHa[3], z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	proof->params.backends.prg = header->prg;
+	proof->params.backends.hash = header->hash;
+	proof->params.compact = (header->flags & CONTAINER_COMPACT) != 0;
+	proof->params.publicGates = (header->flags & CONTAINER_PUBLIC_GATES) != 0;
+	proof->params.hmac = (header->flags & CONTAINER_HMAC) != 0;
+	proof->params.inputLen = header->inputLen;
+	proof->params.prefixLen = header->prefixLen;
+	proof->params.rehashes = header->rehashes;
+	if (header->publicBytes != publicBaseBytes(proof->params.compact, rounds) + header->prefixLen
+			|| header->inputLen != recordedInputLen(&proof->params)) {
+		return PROOF_UNRECOGNISED;
 	}
-	if(mpc_ADD_verify(hHa[4], ve, hHa[4], z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	return PROOF_OK;
+}
+
+//Whether the round index of a proof with full openings of blocks blocks gives every round
+//fullOpeningBytes(blocks) bytes
+int fullOpeningsIndexed(const uint64_t index[], int rounds, int blocks) {
+	for (int round = 0; round < rounds; round++) {
+		if (index[round + 1] - index[round] != fullOpeningBytes(blocks)) {
+			return 0;
+		}
 	}
-	if(mpc_ADD_verify(hHa[5], vf, hHa[5], z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	return 1;
+}
+
+//Makes sense of a mapped proof file of minRounds rounds or more, either a container or the
+//original bare a and z arrays. The sizes of compact openings depend on the challenges,
+//compactOpening checks them.
+proofStatus openProof(const proofMap* map, int minRounds, mappedProof* proof) {
+	memset(proof, 0, sizeof(*proof));
+	proof->circuit = CIRCUIT_SHA256;
+	proof->params.backends = defaultBackends;
+	proof->rounds = CONTAINER_LEGACY_ROUNDS;
+	planMessage(0, 0, &proof->plan);
+	if (map->size == (sizeof(a) + sizeof(z)) * CONTAINER_LEGACY_ROUNDS && !isContainer(map)) {
+		proof->as = (const a*)map->data;
+		proof->zs = (const z*)(map->data + sizeof(a) * CONTAINER_LEGACY_ROUNDS);
+		return CONTAINER_LEGACY_ROUNDS >= minRounds ? PROOF_OK : PROOF_WRONG_ROUNDS;
 	}
-	if(mpc_ADD_verify(hHa[6], vg, hHa[6], z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+
+	const containerHeader* header = containerCheck(map);
+	if (!header) {
+		return PROOF_UNRECOGNISED;
 	}
-	if(mpc_ADD_verify(hHa[7], vh, hHa[7], z.ve0, z.ve1, randomness, randCount, countY) == 1) {
-#if VERBOSE
-		printf("Failing at %d", __LINE__);
-#endif
-		return 1;
+	proofStatus status = proofHeaderStatus(header, minRounds, proof);
+	if (status != PROOF_OK) {
+		return status;
 	}
+	int rounds = proof->rounds;
+	const unsigned char* publicEnd = (const unsigned char*)containerPublic(map, header) + header->publicBytes;
+	if (!containerZeros(publicEnd, containerIndex(map, header)[0] - header->publicOffset - header->publicBytes)) {
+		return PROOF_UNRECOGNISED;
+	}
+	proof->params.prefix = (const unsigned char*)containerPublic(map, header) + publicBaseBytes(proof->params.compact, rounds);
+	planProof(&proof->params, &proof->plan);
+	if (proof->params.compact) {
+		proof->y = containerPublic(map, header);
+		proof->digest = (const unsigned char*)(proof->y + 8);
+		return PROOF_OK;
+	}
+	if (!fullOpeningsIndexed(containerIndex(map, header), rounds, proof->plan.blocks)) {
+		return PROOF_UNRECOGNISED;
+	}
+	proof->as = containerPublic(map, header);
+	size_t bytes;
+	proof->zs = containerOpening(map, header, 0, &bytes);
+	return PROOF_OK;
+}
 
-	free(randCount);
-	free(countY);
-	return 0;
+//The compact opening of round, whose challenge is e, in place, or NULL if its size or padding
+//is wrong
+const zCompact* compactOpening(const proofMap* map, const mappedProof* proof, int round, int e) {
+	size_t bytes, used = compactOpeningBytes(e, &proof->plan.first);
+	const zCompact* zc = containerOpening(map, proof->header, round, &bytes);
+	return bytes == containerAlign(used) && containerZeros((const unsigned char*)zc + used, bytes - used) ? zc : NULL;
 }
 
+#include "stream.h"
 
 #endif /* SHARED_H_ */
@@ -0,0 +1,375 @@
+ /*
+ ============================================================================
+ Name        : stream.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : Verifies a SHA-256 proof while it is being read
+ ============================================================================
+ */
+
+/*
+ * Included at the end of shared.h. The proof is read front to back from any
+ * FILE, pipes and stdin included, and never held as a whole. openProofStream
+ * reads the header, the round index and the public section, which give the
+ * hash and the challenges. verifyProofStream then reads the openings
+ * VERIFY_BATCH rounds at a time into a ring of STREAM_SLOTS_PER_THREAD
+ * buffers per thread. Every batch is an OpenMP task that starts as soon as
+ * its bytes are in, while the batches after it are still being read; a
+ * buffer is only read into again once the batch it held is verified.
+ * Memory is the public section plus the ring, whatever the proof's size.
+ *
+ * Full openings of an input of several blocks are checked one round after
+ * another instead, block by block as each block's views are read, with
+ * roundCheck. Only one block's views are held, but rounds are not verified
+ * in parallel.
+ */
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include <stddef.h>
+
+#define STREAM_SLOTS_PER_THREAD 2
+
+//Where a stream's memory comes from, like zkboo_allocator. opaque is passed back.
+typedef struct {
+	void* (*alloc)(void* opaque, size_t bytes);
+	void (*free)(void* opaque, void* ptr);
+	void* opaque;
+} streamAllocator;
+
+_Static_assert(offsetof(zCompact, x2) == 16 + 16 + 32 + sizeof(uint32_t) * (ySize - 8),
+		"compact openings are read straight into zCompact");
+
+typedef struct {
+	FILE* file;
+	uint64_t offset; //bytes read so far
+	mappedProof info; //circuit, rounds and params, with as, y and digest pointing to the fields below
+	containerHeader header;
+	uint64_t* index; //NULL for a proof in the original headerless format
+	a* as; //read for full openings, rebuilt for compact ones
+	uint32_t y[8];
+	unsigned char digest[SHA256_DIGEST_LENGTH]; //compact openings
+	unsigned char* prefix; //the public prefix, info.params.prefix
+	int* es;
+	int failed; //OpenSSL failed working out the challenges, so verifyProofStream can only fail
+	streamAllocator allocator;
+} proofStream;
+
+static void* streamMallocAlloc(void* opaque, size_t bytes) {
+	(void)opaque;
+	return malloc(bytes);
+}
+
+static void streamMallocFree(void* opaque, void* ptr) {
+	(void)opaque;
+	free(ptr);
+}
+
+static inline void* streamAlloc(proofStream* stream, size_t bytes) {
+	return stream->allocator.alloc(stream->allocator.opaque, bytes);
+}
+
+static inline void streamFree(proofStream* stream, void* ptr) {
+	if (ptr) {
+		stream->allocator.free(stream->allocator.opaque, ptr);
+	}
+}
+
+static int streamRead(proofStream* stream, void* buffer, size_t bytes) {
+	if (fread(buffer, 1, bytes, stream->file) != bytes) {
+		return 1;
+	}
+	stream->offset += bytes;
+	return 0;
+}
+
+//Reads up to offset over the container's zero padding, failing if any of it is not zero.
+//Streams only go forward.
+static int streamSkipTo(proofStream* stream, uint64_t offset) {
+	unsigned char skipped[256];
+	if (offset < stream->offset) {
+		return 1;
+	}
+	while (stream->offset < offset) {
+		size_t bytes = offset - stream->offset < sizeof(skipped) ? offset - stream->offset : sizeof(skipped);
+		if (streamRead(stream, skipped, bytes) != 0 || !containerZeros(skipped, bytes)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//Reads the header, round index and public section of a proof of minRounds rounds or more from
+//file, and works out its hash and challenges. The stream's memory comes from allocator, NULL
+//meaning malloc and free. closeProofStream frees the stream whatever this returns.
+proofStatus openProofStream(FILE* file, int minRounds, const streamAllocator* allocator, proofStream* stream) {
+	memset(stream, 0, sizeof(*stream));
+	stream->file = file;
+	stream->allocator.alloc = streamMallocAlloc;
+	stream->allocator.free = streamMallocFree;
+	if (allocator) {
+		stream->allocator = *allocator;
+	}
+	stream->info.circuit = CIRCUIT_SHA256;
+	stream->info.params.backends = defaultBackends;
+	stream->info.rounds = CONTAINER_LEGACY_ROUNDS;
+	planMessage(0, 0, &stream->info.plan);
+
+	unsigned char start[sizeof(containerHeader)];
+	if (streamRead(stream, start, sizeof(start)) != 0) {
+		return PROOF_UNRECOGNISED;
+	}
+	int rounds = CONTAINER_LEGACY_ROUNDS;
+	if (memcmp(start, containerMagic, 4) != 0) {
+		//The original format, the a array and then the z array
+		if (rounds < minRounds) {
+			return PROOF_WRONG_ROUNDS;
+		}
+		if (!(stream->as = streamAlloc(stream, sizeof(a) * rounds))) {
+			return PROOF_NO_MEMORY;
+		}
+		memcpy(stream->as, start, sizeof(start));
+		if (streamRead(stream, (unsigned char*)stream->as + sizeof(start), sizeof(a) * rounds - sizeof(start)) != 0) {
+			return PROOF_UNRECOGNISED;
+		}
+	} else {
+		memcpy(&stream->header, start, sizeof(start));
+		proofStatus status = proofHeaderStatus(&stream->header, minRounds, &stream->info);
+		if (status != PROOF_OK) {
+			return status;
+		}
+		rounds = stream->info.rounds;
+		stream->info.header = &stream->header;
+		stream->as = streamAlloc(stream, sizeof(a) * rounds);
+		stream->index = streamAlloc(stream, sizeof(uint64_t) * (rounds + 1));
+		//One byte more, so that an empty prefix does not ask for 0 bytes, which may give NULL
+		stream->prefix = streamAlloc(stream, stream->info.params.prefixLen + 1);
+		if (!stream->as || !stream->index || !stream->prefix) {
+			return PROOF_NO_MEMORY;
+		}
+		if (streamSkipTo(stream, stream->header.indexOffset) != 0
+				|| streamRead(stream, stream->index, sizeof(uint64_t) * (rounds + 1)) != 0
+				|| !containerLayoutValid(&stream->header, stream->index, stream->index[rounds])
+				|| streamSkipTo(stream, stream->header.publicOffset) != 0) {
+			return PROOF_UNRECOGNISED;
+		}
+		if (stream->info.params.compact) {
+			if (streamRead(stream, stream->y, sizeof(stream->y)) != 0 || streamRead(stream, stream->digest, SHA256_DIGEST_LENGTH) != 0) {
+				return PROOF_UNRECOGNISED;
+			}
+		} else if (streamRead(stream, stream->as, sizeof(a) * rounds) != 0) {
+			return PROOF_UNRECOGNISED;
+		}
+		if (streamRead(stream, stream->prefix, stream->info.params.prefixLen) != 0) {
+			return PROOF_UNRECOGNISED;
+		}
+		stream->info.params.prefix = stream->prefix;
+		planProof(&stream->info.params, &stream->info.plan);
+		if (!stream->info.params.compact && !fullOpeningsIndexed(stream->index, rounds, stream->info.plan.blocks)) {
+			return PROOF_UNRECOGNISED;
+		}
+	}
+
+	if (!(stream->es = streamAlloc(stream, sizeof(int) * rounds))) {
+		return PROOF_NO_MEMORY;
+	}
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, stream->info.params.backends);
+	if (stream->info.params.compact) {
+		esFromDigest(&crypto, stream->digest, rounds, stream->es);
+	} else {
+		reconstruct(stream->as[0].yp[0], stream->as[0].yp[1], stream->as[0].yp[2], stream->y);
+		calculateEs(&crypto, stream->info.header ? &stream->info.params : NULL, stream->y, stream->as, rounds, stream->es);
+	}
+	cleanupCryptoCtx(&crypto);
+	stream->failed = crypto.failed;
+	if (stream->info.params.compact) {
+		for (int round = 0; round < rounds; round++) {
+			if (stream->index[round + 1] - stream->index[round] != containerAlign(compactOpeningBytes(stream->es[round], &stream->info.plan.first))) {
+				return PROOF_UNRECOGNISED;
+			}
+		}
+	}
+	stream->info.as = stream->as;
+	stream->info.y = stream->y;
+	stream->info.digest = stream->digest;
+	return PROOF_OK;
+}
+
+//Reads the openings of rounds first to first + count - 1 into buffer, each openingBytes long.
+//Returns 0 on success.
+static int streamReadBatch(proofStream* stream, int first, int count, unsigned char* buffer, size_t openingBytes) {
+	for (int round = first; round < first + count; round++) {
+		size_t bytes = stream->info.params.compact ? compactOpeningBytes(stream->es[round], &stream->info.plan.first) : sizeof(z);
+		if ((stream->index && streamSkipTo(stream, stream->index[round]) != 0)
+				|| streamRead(stream, buffer + openingBytes * (round - first), bytes) != 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//Reads and verifies the full openings of an input of several blocks, round by round and every
+//round block by block. Stops at the first round that fails or cannot be read.
+static verifyResult verifyBlocksStream(proofStream* stream) {
+	const messagePlan* plans = &stream->info.plan;
+	verifyResult result = { -1, VERIFY_OK };
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, stream->info.params.backends);
+	unsigned char keys[TWO_BRANCHES][16];
+	View views[TWO_BRANCHES];
+	unsigned char rs[TWO_BRANCHES][4];
+	for (int round = 0; round < stream->info.rounds; round++) {
+		if ((stream->index && streamSkipTo(stream, stream->index[round]) != 0) || streamRead(stream, keys, sizeof(keys)) != 0) {
+			result.round = round;
+			result.reason = VERIFY_BAD_FILE;
+			break;
+		}
+		roundCheck check;
+		roundCheckBegin(&check, &crypto, &stream->as[round], stream->es[round], keys[0], keys[1], plans);
+		int unread = 0;
+		for (int block = 0; block < plans->blocks && !unread; block++) {
+			unread = streamRead(stream, views, sizeof(views)) != 0;
+			if (!unread) {
+				roundCheckBlock(&check, &views[0], &views[1]);
+			}
+		}
+		unread = unread || streamRead(stream, rs, sizeof(rs)) != 0;
+		verifyReason reason = roundCheckEnd(&check, rs[0], rs[1]);
+		if (unread || reason != VERIFY_OK) {
+			result.round = round;
+			result.reason = unread ? VERIFY_BAD_FILE : reason;
+			break;
+		}
+	}
+	cleanupCryptoCtx(&crypto);
+	return crypto.failed ? cryptoFailure() : result;
+}
+
+//Reads and verifies the openings of a stream from openProofStream on up to threads threads (0
+//means the OpenMP default). Full openings give the same result as verifyProof, compact ones
+//as verifyCompactProof. A stream that ends early or goes on after the last round fails with
+//VERIFY_BAD_FILE at the first round that could not be read, unless an earlier one failed. The
+//ring comes from the stream's allocator, and the result is VERIFY_NO_MEMORY if it cannot.
+verifyResult verifyProofStream(proofStream* stream, int threads) {
+	int rounds = stream->info.rounds;
+	int compact = stream->info.params.compact;
+	if (stream->failed) {
+		return cryptoFailure();
+	}
+	if (!compact && stream->info.plan.blocks > 1) {
+		verifyResult result = verifyBlocksStream(stream);
+		if (result.round < 0 && ((stream->index && streamSkipTo(stream, stream->index[rounds]) != 0) || fgetc(stream->file) != EOF)) {
+			result.round = rounds - 1;
+			result.reason = VERIFY_BAD_FILE;
+		}
+		return result;
+	}
+	if (threads <= 0) {
+		threads = omp_get_max_threads();
+	}
+	int slots = STREAM_SLOTS_PER_THREAD * threads;
+	size_t openingBytes = compact ? sizeof(zCompact) : sizeof(z);
+	unsigned char* buffers = streamAlloc(stream, openingBytes * VERIFY_BATCH * slots);
+	CryptoCtx* cryptos = streamAlloc(stream, sizeof(CryptoCtx) * threads);
+	View (*views)[VERIFY_BATCH][TWO_BRANCHES] = compact ? streamAlloc(stream, sizeof(*views) * threads) : NULL;
+	char* deps = streamAlloc(stream, slots + 1); //dependency tags, one per buffer and deps[slots] for reading
+	verifyResult result = { -1, VERIFY_OK };
+	if (!buffers || !cryptos || (compact && !views) || !deps) {
+		streamFree(stream, deps);
+		streamFree(stream, views);
+		streamFree(stream, cryptos);
+		streamFree(stream, buffers);
+		result.round = 0;
+		result.reason = VERIFY_NO_MEMORY;
+		return result;
+	}
+	int firstFail = rounds; //lowest round that did not verify
+	int unread = rounds; //first round that could not be read
+	int failed = 0;
+
+	#pragma omp parallel num_threads(threads)
+	{
+		initCryptoCtx(&cryptos[omp_get_thread_num()], stream->info.params.backends);
+		#pragma omp barrier
+		#pragma omp single
+		for (int first = 0; first < rounds; first += VERIFY_BATCH) {
+			int count = rounds - first < VERIFY_BATCH ? rounds - first : VERIFY_BATCH;
+			int slot = (first / VERIFY_BATCH) % slots;
+			unsigned char* buffer = buffers + openingBytes * VERIFY_BATCH * slot;
+
+			//Reads are chained through deps[slots] to keep the stream in order, and wait through
+			//deps[slot] for the batch verified from the same buffer before
+			#pragma omp task depend(inout: deps[slots]) depend(inout: deps[slot]) firstprivate(first, count, buffer)
+			{
+				int stop, skip;
+				#pragma omp atomic read
+				stop = firstFail;
+				#pragma omp atomic read
+				skip = unread;
+				if (first <= stop && skip == rounds && streamReadBatch(stream, first, count, buffer, openingBytes) != 0) {
+					#pragma omp atomic write
+					unread = first;
+				}
+			}
+			#pragma omp task depend(inout: deps[slot]) firstprivate(first, count, buffer)
+			{
+				int skip;
+				#pragma omp atomic read
+				skip = unread;
+				int thread = omp_get_thread_num();
+				if (skip >= first + count) {
+					if (compact) {
+						const zCompact* batch[VERIFY_BATCH];
+						for (int i = 0; i < count; i++) {
+							batch[i] = (const zCompact*)(buffer + openingBytes * i);
+						}
+						rebuildCompactBatch(&cryptos[thread], stream->y, stream->es, batch, first, count, &stream->info.plan.first, views[thread], stream->as);
+					} else {
+						verifyBatch(&cryptos[thread], stream->as, stream->es, (const z*)buffer, &stream->info.plan, first, count, &firstFail, &result);
+					}
+				}
+			}
+		}
+		cryptoFailed(&cryptos[omp_get_thread_num()], &failed);
+		cleanupCryptoCtx(&cryptos[omp_get_thread_num()]);
+	}
+	streamFree(stream, deps);
+	streamFree(stream, views);
+	streamFree(stream, cryptos);
+	streamFree(stream, buffers);
+
+	if (failed) {
+		return cryptoFailure();
+	}
+	if (result.round >= 0) {
+		return result;
+	}
+	//Nothing may follow the last opening but its padding
+	if (unread == rounds && ((stream->index && streamSkipTo(stream, stream->index[rounds]) != 0) || fgetc(stream->file) != EOF)) {
+		unread = rounds - 1;
+	}
+	if (unread < rounds) {
+		result.round = unread;
+		result.reason = VERIFY_BAD_FILE;
+		return result;
+	}
+	if (compact) {
+		result = checkCompactChallenge(&stream->info.params, stream->y, stream->digest, stream->as, rounds);
+	}
+	return result;
+}
+
+void closeProofStream(proofStream* stream) {
+	streamFree(stream, stream->index);
+	streamFree(stream, stream->as);
+	streamFree(stream, stream->es);
+	streamFree(stream, stream->prefix);
+	stream->index = NULL;
+	stream->as = NULL;
+	stream->es = NULL;
+	stream->prefix = NULL;
+}
+
+#endif /* STREAM_H_ */
@@ -0,0 +1,430 @@
+ /*
+ ============================================================================
+ Name        : tapes.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : Randomness tapes, AES-128-CTR expanded for several keys at once
+ ============================================================================
+ */
+
+/*
+ * Included by shared.h after CryptoCtx. With the default PRG a tape is
+ * AES-128-CTR under the branch key with the fixed IV below, encrypting
+ * ASCII '0' bytes. That is what the first provers produced through EVP,
+ * so proofs from either engine verify with the other.
+ *
+ * The circuit reads its tapes front to back, 4 bytes per AND/ADD, so a
+ * Tape only holds the TAPE_CHUNK bytes around the current randCount and
+ * produces the next chunk when randCount walks past it. Tapes that advance
+ * in lockstep (the branches of a round, the rounds of a lane batch) are
+ * refilled together by tapeFill, one interleaved batch per chunk. A block's
+ * tape takes six 512-byte chunks, which streams as fast as producing it
+ * whole; with 256-byte chunks the refills and the window checks made a
+ * streamed tape cost three to four times a whole one.
+ *
+ * An input of several blocks takes a tape per compression from the same
+ * key: block 0's is the tape above, every later one TAPE_BLOCKS further
+ * on in the keystream, after the SEED_EXTRA_BLOCKS of compact proofs.
+ *
+ * With AES-NI the keys of up to TAPE_KEYS tapes are encrypted interleaved,
+ * keeping TAPE_KEYS independent AESENC chains in flight instead of waiting
+ * on one. Without AES-NI the CryptoCtx's EVP cipher is used.
+ *
+ * The other PRGs of backends.h produce the tape of a key as follows, each
+ * able to start at any 16 byte block:
+ *  - PRG_FIXED_AES: block b is AES(F, X) ^ X with X = key ^ (IV + b) and
+ *    F the public fixedAesKey, so no per-key schedule is needed.
+ *  - PRG_CHACHA20: the ChaCha20 keystream under key || IV, nonce 0.
+ *  - PRG_SHAKE128: segment j of PRG_SEGMENT bytes is SHAKE128(key || j),
+ *    j a little-endian 32-bit integer.
+ */
+
+#ifndef TAPES_H_
+#define TAPES_H_
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TAPES_AESNI 1
+#else
+#define TAPES_AESNI 0
+#endif
+
+//32 bits of randomness per gate and key, in whole AES blocks: 728*32/128 = 182 of them
+#define TAPE_BYTES CIRCUIT_TAPE_BYTES(NUM_GATES)
+#define TAPE_BLOCKS (TAPE_BYTES / 16)
+//Keystream blocks after block 0's tape that compact proofs (zkbpp.h) derive shares and rs from
+#define SEED_EXTRA_BLOCKS 4
+//Tapes encrypted together with AES-NI
+#define TAPE_KEYS 8
+//Bytes of a tape kept at a time, a power of two and a multiple of 16. A Tape is held by value,
+//MAX_COMMIT_BATCH rounds of them on each prover thread's stack, so this stays well under TAPE_BYTES.
+#define TAPE_CHUNK 512
+
+typedef struct {
+	unsigned char buf[TAPE_CHUNK]; //tape bytes start to start+TAPE_CHUNK-1
+	int start;
+	int first; //keystream block the tape starts at, see tapeSeekBlock
+	unsigned char key[16];
+#if TAPES_AESNI
+	__m128i rk[11]; //expanded key, only set up for PRG_AES_CTR when the CPU has AES-NI
+#endif
+	CryptoCtx* crypto; //for the EVP fallback
+} Tape;
+
+//The historical IV was the first 16 bytes of "01234567890123456"
+static const unsigned char tapeIV[16] = { '0','1','2','3','4','5','6','7','8','9','0','1','2','3','4','5' };
+
+//PRG_FIXED_AES key, the first 128 fractional bits of pi
+static const unsigned char fixedAesKey[16] = { 0x24, 0x3f, 0x6a, 0x88, 0x85, 0xa3, 0x08, 0xd3,
+		0x13, 0x19, 0x8a, 0x2e, 0x03, 0x70, 0x73, 0x44 };
+#define PRG_SEGMENT 256
+
+//The big-endian 128-bit IV + block
+static inline void tapeCounterBytes(int block, unsigned char ctr[16]) {
+	int carry = block;
+	for (int i = 15; i >= 0; i--) {
+		carry += tapeIV[i];
+		ctr[i] = carry;
+		carry >>= 8;
+	}
+}
+
+//numBlocks blocks of key's tape starting at block firstBlock, through EVP and the crypto's PRG.
+//Zero once the crypto has failed.
+void evpKeystream(CryptoCtx* crypto, const unsigned char key[16], unsigned char* out, int firstBlock, int numBlocks) {
+	static const unsigned char plaintext[TAPE_BYTES] = { [0 ... TAPE_BYTES - 1] = '0' };
+	static const unsigned char zeros[TAPE_BYTES + 64] = { 0 };
+	unsigned char iv[16], key32[32];
+	int len, ok = 1;
+	if (crypto->failed) {
+		memset(out, 0, numBlocks * 16);
+		return;
+	}
+	switch (crypto->backends.prg) {
+	case PRG_AES_CTR:
+		tapeCounterBytes(firstBlock, iv);
+		ok = EVP_EncryptInit_ex(crypto->cipher, crypto->prgCipher, NULL, key, iv)
+				& EVP_EncryptUpdate(crypto->cipher, out, &len, plaintext, numBlocks * 16);
+		break;
+	case PRG_FIXED_AES: {
+		unsigned char x[TAPE_BYTES];
+		for (int b = 0; b < numBlocks; b++) {
+			tapeCounterBytes(firstBlock + b, &x[16 * b]);
+			for (int i = 0; i < 16; i++) {
+				x[16 * b + i] ^= key[i];
+			}
+		}
+		ok = EVP_EncryptInit_ex(crypto->cipher, crypto->prgCipher, NULL, fixedAesKey, NULL)
+				& EVP_CIPHER_CTX_set_padding(crypto->cipher, 0)
+				& EVP_EncryptUpdate(crypto->cipher, out, &len, x, numBlocks * 16);
+		for (int i = 0; i < numBlocks * 16; i++) {
+			out[i] ^= x[i];
+		}
+		break;
+	}
+	case PRG_CHACHA20: {
+		//OpenSSL's ChaCha20 IV is the little-endian 32-bit block counter followed by the nonce
+		unsigned char stream[TAPE_BYTES + 64];
+		int skip = (firstBlock % 4) * 16;
+		memcpy(key32, key, 16);
+		memcpy(key32 + 16, tapeIV, 16);
+		memset(iv, 0, 16);
+		for (int i = 0; i < 4; i++) {
+			iv[i] = (firstBlock / 4) >> (8 * i);
+		}
+		ok = EVP_EncryptInit_ex(crypto->cipher, crypto->prgCipher, NULL, key32, iv)
+				& EVP_EncryptUpdate(crypto->cipher, stream, &len, zeros, skip + numBlocks * 16);
+		memcpy(out, stream + skip, numBlocks * 16);
+		break;
+	}
+	default: {
+		int begin = firstBlock * 16, end = begin + numBlocks * 16;
+		for (int segment = begin / PRG_SEGMENT; segment * PRG_SEGMENT < end; segment++) {
+			unsigned char index[4] = { segment, segment >> 8, segment >> 16, segment >> 24 };
+			unsigned char bytes[PRG_SEGMENT];
+			ok &= EVP_DigestInit_ex(crypto->md, crypto->prgMd, NULL)
+					& EVP_DigestUpdate(crypto->md, key, 16)
+					& EVP_DigestUpdate(crypto->md, index, 4)
+					& EVP_DigestFinalXOF(crypto->md, bytes, PRG_SEGMENT);
+			int from = begin > segment * PRG_SEGMENT ? begin : segment * PRG_SEGMENT;
+			int to = end < (segment + 1) * PRG_SEGMENT ? end : (segment + 1) * PRG_SEGMENT;
+			memcpy(out + from - begin, bytes + from - segment * PRG_SEGMENT, to - from);
+		}
+		break;
+	}
+	}
+	if (1 != ok) {
+		crypto->failed = 1;
+		memset(out, 0, numBlocks * 16);
+	}
+}
+
+void getAllRandomnessEVP(CryptoCtx* crypto, const unsigned char key[16], unsigned char randomness[TAPE_BYTES]) {
+	evpKeystream(crypto, key, randomness, 0, TAPE_BLOCKS);
+}
+
+#if TAPES_AESNI
+#define TAPE_INLINE static inline __attribute__ ((always_inline, target("aes,sse2")))
+
+TAPE_INLINE __m128i aesniExpandStep(__m128i key, __m128i assist) {
+	assist = _mm_shuffle_epi32(assist, 0xff);
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	return _mm_xor_si128(key, assist);
+}
+
+//_mm_aeskeygenassist_si128 takes the round constant as an immediate, hence the unrolling
+TAPE_INLINE void aesniExpandKey(const unsigned char key[16], __m128i rk[11]) {
+	rk[0] = _mm_loadu_si128((const __m128i*)key);
+	rk[1] = aesniExpandStep(rk[0], _mm_aeskeygenassist_si128(rk[0], 0x01));
+	rk[2] = aesniExpandStep(rk[1], _mm_aeskeygenassist_si128(rk[1], 0x02));
+	rk[3] = aesniExpandStep(rk[2], _mm_aeskeygenassist_si128(rk[2], 0x04));
+	rk[4] = aesniExpandStep(rk[3], _mm_aeskeygenassist_si128(rk[3], 0x08));
+	rk[5] = aesniExpandStep(rk[4], _mm_aeskeygenassist_si128(rk[4], 0x10));
+	rk[6] = aesniExpandStep(rk[5], _mm_aeskeygenassist_si128(rk[5], 0x20));
+	rk[7] = aesniExpandStep(rk[6], _mm_aeskeygenassist_si128(rk[6], 0x40));
+	rk[8] = aesniExpandStep(rk[7], _mm_aeskeygenassist_si128(rk[7], 0x80));
+	rk[9] = aesniExpandStep(rk[8], _mm_aeskeygenassist_si128(rk[8], 0x1b));
+	rk[10] = aesniExpandStep(rk[9], _mm_aeskeygenassist_si128(rk[9], 0x36));
+}
+
+//Counter block number block: the IV read as a big-endian 128-bit integer, plus block
+TAPE_INLINE __m128i tapeCounter(uint64_t ivHigh, uint64_t ivLow, int block) {
+	uint64_t low = ivLow + block;
+	uint64_t high = ivHigh + (low < ivLow);
+	return _mm_set_epi64x(__builtin_bswap64(low), __builtin_bswap64(high));
+}
+
+//Encrypts perKey consecutive counter blocks starting at block for each of the n keys,
+//n * perKey independent AES chains in total, and stores them from out[i][offset]
+TAPE_INLINE void aesniTapeBlocks(const int n, const int perKey, const __m128i* rk[], unsigned char* out[], int offset, uint64_t ivHigh, uint64_t ivLow, int block) {
+	const __m128i plaintext = _mm_set1_epi8('0');
+	__m128i s[TAPE_KEYS]; //n * perKey <= TAPE_KEYS
+	#pragma GCC unroll 8
+	for (int b = 0; b < perKey; b++) {
+		__m128i ctr = tapeCounter(ivHigh, ivLow, block + b);
+		#pragma GCC unroll 8
+		for (int i = 0; i < n; i++) {
+			s[i * perKey + b] = _mm_xor_si128(ctr, rk[i][0]);
+		}
+	}
+	#pragma GCC unroll 9
+	for (int round = 1; round < 10; round++) {
+		#pragma GCC unroll 8
+		for (int i = 0; i < n; i++) {
+			#pragma GCC unroll 8
+			for (int b = 0; b < perKey; b++) {
+				s[i * perKey + b] = _mm_aesenc_si128(s[i * perKey + b], rk[i][round]);
+			}
+		}
+	}
+	#pragma GCC unroll 8
+	for (int i = 0; i < n; i++) {
+		#pragma GCC unroll 8
+		for (int b = 0; b < perKey; b++) {
+			__m128i result = _mm_xor_si128(_mm_aesenclast_si128(s[i * perKey + b], rk[i][10]), plaintext);
+			_mm_storeu_si128((__m128i*)&out[i][offset + b * 16], result);
+		}
+	}
+}
+
+//numBlocks blocks of the n tapes starting at block firstBlock, out[i] receiving those of rk[i].
+//n is a constant in every caller below, so the loops fully unroll and s stays in registers.
+//With fewer than TAPE_KEYS keys each key takes several blocks per step to keep the pipeline full.
+TAPE_INLINE void aesniKeystream(const int n, const __m128i* rk[], unsigned char* out[], int firstBlock, int numBlocks) {
+	const int perKey = TAPE_KEYS / n;
+	uint64_t ivHigh, ivLow;
+	memcpy(&ivHigh, &tapeIV[0], 8);
+	memcpy(&ivLow, &tapeIV[8], 8);
+	ivHigh = __builtin_bswap64(ivHigh);
+	ivLow = __builtin_bswap64(ivLow);
+
+	int block = 0;
+	for (; block + perKey <= numBlocks; block += perKey) {
+		aesniTapeBlocks(n, perKey, rk, out, block * 16, ivHigh, ivLow, firstBlock + block);
+	}
+	for (; block < numBlocks; block++) {
+		aesniTapeBlocks(n, 1, rk, out, block * 16, ivHigh, ivLow, firstBlock + block);
+	}
+}
+
+__attribute__ ((target("aes,sse2"))) void aesniKeystreamBatch(int n, const __m128i* rk[], unsigned char* out[], int firstBlock, int numBlocks) {
+	switch (n) {
+	case 1: aesniKeystream(1, rk, out, firstBlock, numBlocks); break;
+	case 2: aesniKeystream(2, rk, out, firstBlock, numBlocks); break;
+	case 3: aesniKeystream(3, rk, out, firstBlock, numBlocks); break;
+	case 4: aesniKeystream(4, rk, out, firstBlock, numBlocks); break;
+	case 5: aesniKeystream(5, rk, out, firstBlock, numBlocks); break;
+	case 6: aesniKeystream(6, rk, out, firstBlock, numBlocks); break;
+	case 7: aesniKeystream(7, rk, out, firstBlock, numBlocks); break;
+	default: aesniKeystream(TAPE_KEYS, rk, out, firstBlock, numBlocks); break;
+	}
+}
+
+//PRG_FIXED_AES blocks block to block+n-1 of the tape of seed, n independent chains under one key
+TAPE_INLINE void aesniFixedBlocks(const int n, const __m128i rk[11], __m128i seed, unsigned char* out, uint64_t ivHigh, uint64_t ivLow, int block) {
+	__m128i x[TAPE_KEYS], s[TAPE_KEYS];
+	#pragma GCC unroll 8
+	for (int b = 0; b < n; b++) {
+		x[b] = _mm_xor_si128(seed, tapeCounter(ivHigh, ivLow, block + b));
+		s[b] = _mm_xor_si128(x[b], rk[0]);
+	}
+	#pragma GCC unroll 9
+	for (int round = 1; round < 10; round++) {
+		#pragma GCC unroll 8
+		for (int b = 0; b < n; b++) {
+			s[b] = _mm_aesenc_si128(s[b], rk[round]);
+		}
+	}
+	#pragma GCC unroll 8
+	for (int b = 0; b < n; b++) {
+		_mm_storeu_si128((__m128i*)&out[b * 16], _mm_xor_si128(_mm_aesenclast_si128(s[b], rk[10]), x[b]));
+	}
+}
+
+//PRG_FIXED_AES for count tapes. The key schedule is shared, so a single tape already keeps
+//TAPE_KEYS blocks in flight.
+__attribute__ ((target("aes,sse2"))) void aesniFixedKeystream(int count, const unsigned char* keys[], unsigned char* out[], int firstBlock, int numBlocks) {
+	__m128i rk[11];
+	uint64_t ivHigh, ivLow;
+	aesniExpandKey(fixedAesKey, rk);
+	memcpy(&ivHigh, &tapeIV[0], 8);
+	memcpy(&ivLow, &tapeIV[8], 8);
+	ivHigh = __builtin_bswap64(ivHigh);
+	ivLow = __builtin_bswap64(ivLow);
+	for (int i = 0; i < count; i++) {
+		__m128i seed = _mm_loadu_si128((const __m128i*)keys[i]);
+		int block = 0;
+		for (; block + TAPE_KEYS <= numBlocks; block += TAPE_KEYS) {
+			aesniFixedBlocks(TAPE_KEYS, rk, seed, out[i] + block * 16, ivHigh, ivLow, firstBlock + block);
+		}
+		for (; block < numBlocks; block++) {
+			aesniFixedBlocks(1, rk, seed, out[i] + block * 16, ivHigh, ivLow, firstBlock + block);
+		}
+	}
+}
+
+__attribute__ ((target("aes,sse2"))) void aesniExpandKeys(int count, const unsigned char* keys[], __m128i rk[][11]) {
+	for (int i = 0; i < count; i++) {
+		aesniExpandKey(keys[i], rk[i]);
+	}
+}
+#endif
+
+//Blocks firstBlock to firstBlock+numBlocks-1 of the tape of keys[i] into out[i] for i < count
+void keystreamForKeys(CryptoCtx* crypto, int count, const unsigned char* keys[], unsigned char* out[], int firstBlock, int numBlocks) {
+#if TAPES_AESNI
+	if (crypto->backends.prg == PRG_FIXED_AES && __builtin_cpu_supports("aes")) {
+		aesniFixedKeystream(count, keys, out, firstBlock, numBlocks);
+		return;
+	}
+	if (crypto->backends.prg == PRG_AES_CTR && __builtin_cpu_supports("aes")) {
+		for (int first = 0; first < count; first += TAPE_KEYS) {
+			int n = count - first < TAPE_KEYS ? count - first : TAPE_KEYS;
+			__m128i rk[TAPE_KEYS][11];
+			const __m128i* rkPtrs[TAPE_KEYS];
+			aesniExpandKeys(n, &keys[first], rk);
+			for (int i = 0; i < n; i++) {
+				rkPtrs[i] = rk[i];
+			}
+			aesniKeystreamBatch(n, rkPtrs, &out[first], firstBlock, numBlocks);
+		}
+		return;
+	}
+#endif
+	for (int i = 0; i < count; i++) {
+		evpKeystream(crypto, keys[i], out[i], firstBlock, numBlocks);
+	}
+}
+
+//Fills tapes[i] with the whole TAPE_BYTES tape of keys[i] for i < count. The tapes are owned by the caller.
+void getRandomnessForKeys(CryptoCtx* crypto, int count, const unsigned char* keys[], unsigned char* tapes[]) {
+	keystreamForKeys(crypto, count, keys, tapes, 0, TAPE_BLOCKS);
+}
+
+//Sets up a tape for key. No keystream is produced until the first read.
+void tapeInit(Tape* tape, CryptoCtx* crypto, const unsigned char key[16]) {
+	memcpy(tape->key, key, 16);
+	tape->crypto = crypto;
+	tape->start = -TAPE_CHUNK;
+	tape->first = 0;
+#if TAPES_AESNI
+	if (crypto->backends.prg == PRG_AES_CTR && __builtin_cpu_supports("aes")) {
+		const unsigned char* keys[1] = { key };
+		aesniExpandKeys(1, keys, &tape->rk);
+	}
+#endif
+}
+
+//Moves a tape to the one of message block block, to be read from randCount 0 again
+void tapeSeekBlock(Tape* tape, int block) {
+	tape->first = block == 0 ? 0 : block * TAPE_BLOCKS + SEED_EXTRA_BLOCKS;
+	tape->start = -TAPE_CHUNK;
+}
+
+//Loads the chunk holding tape byte offset into each of the count tapes, which are all at the
+//same block
+void tapeFill(int count, Tape tapes[], int offset) {
+	int start = offset & ~(TAPE_CHUNK - 1);
+	int numBlocks = TAPE_BLOCKS - start / 16 < TAPE_CHUNK / 16 ? TAPE_BLOCKS - start / 16 : TAPE_CHUNK / 16;
+	int firstBlock = tapes[0].first + start / 16;
+	for (int i = 0; i < count; i++) {
+		tapes[i].start = start;
+	}
+#if TAPES_AESNI
+	PrgId prg = tapes[0].crypto->backends.prg;
+	if (prg == PRG_FIXED_AES && __builtin_cpu_supports("aes")) {
+		for (int i = 0; i < count; i++) {
+			const unsigned char* key = tapes[i].key;
+			unsigned char* out = tapes[i].buf;
+			aesniFixedKeystream(1, &key, &out, firstBlock, numBlocks);
+		}
+		return;
+	}
+	if (prg == PRG_AES_CTR && __builtin_cpu_supports("aes")) {
+		for (int first = 0; first < count; first += TAPE_KEYS) {
+			int n = count - first < TAPE_KEYS ? count - first : TAPE_KEYS;
+			const __m128i* rk[TAPE_KEYS];
+			unsigned char* out[TAPE_KEYS];
+			for (int i = 0; i < n; i++) {
+				rk[i] = tapes[first + i].rk;
+				out[i] = tapes[first + i].buf;
+			}
+			aesniKeystreamBatch(n, rk, out, firstBlock, numBlocks);
+		}
+		return;
+	}
+#endif
+	for (int i = 0; i < count; i++) {
+		evpKeystream(tapes[i].crypto, tapes[i].key, tapes[i].buf, firstBlock, numBlocks);
+	}
+}
+
+static inline int tapeMissing(const Tape* tape, int randCount) {
+	return (unsigned)(randCount - tape->start) >= TAPE_CHUNK;
+}
+
+//The 4 tape bytes at randCount, loading their chunk first if needed
+static inline uint32_t tapeGet32(Tape* tape, int randCount) {
+	uint32_t ret;
+	if (tapeMissing(tape, randCount)) {
+		tapeFill(1, tape, randCount);
+	}
+	memcpy(&ret, &tape->buf[randCount - tape->start], 4);
+	return ret;
+}
+
+//tapeGet32 for count tapes that are read in lockstep, refilling them together. They all hold
+//the same chunk, so only the first one's window is checked.
+static inline void tapesGet32(int count, Tape tapes[], int randCount, uint32_t r[]) {
+	if (tapeMissing(&tapes[0], randCount)) {
+		tapeFill(count, tapes, randCount);
+	}
+	int at = randCount - tapes[0].start;
+	for (int i = 0; i < count; i++) {
+		memcpy(&r[i], &tapes[i].buf[at], 4);
+	}
+}
+
+#endif /* TAPES_H_ */
@@ -0,0 +1,382 @@
+ /*
+ ============================================================================
+ Name        : zkboo_sha256.c
+ Author      : Sobuno
+ Version     : 0.1
+ Description : The SHA-256 calls of libzkboo, see zkboo.h
+ ============================================================================
+ */
+
+/*
+ * Built as its own object of the library: the SHA-1 code uses the same
+ * names for its own functions, so ../libzkboo/build.sh hides everything
+ * here but the zkboo_ calls. MPC_SHA256_BENCH.c includes this file to get
+ * at the prover's parts directly.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prover.h"
+#include "../libzkboo/context.h"
+
+_Static_assert((int)ZKBOO_PRG_SHAKE128 == PRG_SHAKE128 && (int)ZKBOO_HASH_TREE == HASH_TREE
+		&& (int)ZKBOO_SHA1 == CIRCUIT_SHA1 && (int)ZKBOO_SHA256 == CIRCUIT_SHA256 && ZKBOO_MAX_INPUT == MAX_INPUT_BYTES
+		&& ZKBOO_MAX_BLOCK_INPUT == BLOCK_INPUT_BYTES && ZKBOO_MAX_PREFIX == MAX_PREFIX_BYTES && ZKBOO_MAX_CHAIN == MAX_REHASHES + 1
+		&& ZKBOO_MAX_ROUNDS == CONTAINER_MAX_ROUNDS,
+		"zkboo.h numbers PRGs, hashes and circuits like backends.h and container.h");
+
+//The ProofParams of params for an input of inputLen bytes. Returns 0 if they are valid.
+static int proofParams(const zkboo_params* params, int inputLen, ProofParams* proof) {
+	zkboo_params defaults = { 0 };
+	if (!params) {
+		params = &defaults;
+	}
+	if ((unsigned)params->prg >= NUM_PRGS || (unsigned)params->hash >= NUM_HASHES) {
+		return 1;
+	}
+	proof->backends.prg = (PrgId)params->prg;
+	proof->backends.hash = (HashId)params->hash;
+	proof->compact = params->compact != 0;
+	proof->inputLen = inputLen;
+	proof->publicGates = 1;
+	proof->prefix = params->prefix;
+	proof->prefixLen = params->prefixLen;
+	proof->rehashes = params->chain > 1 ? params->chain - 1 : 0;
+	proof->hmac = params->hmac != 0;
+	return params->prefixLen > MAX_PREFIX_BYTES || (params->prefixLen > 0 && !params->prefix) || params->chain < 0 || params->chain > MAX_REHASHES + 1;
+}
+
+typedef struct {
+	zkboo_ctx* ctx;
+	zkboo_buffer* out;
+} bufferSink;
+
+static unsigned char* reserveBuffer(void* opaque, size_t bytes) {
+	bufferSink* sink = opaque;
+	return bufferReserve(sink->ctx, sink->out, bytes) == 0 ? sink->out->data : NULL;
+}
+
+//Proves knowledge of input into fd, or into out when fd is -1, in rounds rounds. All working
+//memory, views included, is the context's scratch block. Always inlined into proveSha256, which
+//has a copy of it for each of the SPECIALIZED_ROUNDS.
+static inline __attribute__((always_inline)) zkboo_status proveRounds(zkboo_ctx* ctx, const unsigned char* input, int inputLen,
+		const ProofParams* proof, int lowMemory, int fd, zkboo_buffer* out, int rounds) {
+	unsigned char (*keys)[NUM_BRANCHES][16] = NULL; //filled with 128 random bits
+	unsigned char (*rs)[NUM_BRANCHES][4] = NULL; //filled with random bits
+	unsigned char (*shares)[NUM_BRANCHES][inputLen] = NULL; //filled with random bits
+	View (*views)[NUM_BRANCHES] = NULL; //view per branch and round, not kept in low-memory mode or for several blocks
+	View (*threadViews)[MAX_COMMIT_BATCH][NUM_BRANCHES] = NULL; //a batch's views per thread otherwise
+	a* as = NULL; //commitments from all branches and all rounds
+	int *es = NULL, *batchStart = NULL, *batchSize = NULL;
+	uint64_t* index = NULL;
+	proofWriter* writer = NULL;
+	unsigned char* base = NULL;
+	int blocks = proofBlocks(proof);
+	int keepViews = !lowMemory && blocks == 1;
+	int threads = ctx->threads > 0 ? ctx->threads : omp_get_max_threads();
+	for (int pass = 0; pass < 2; pass++) {
+		size_t offset = 0;
+		writer = scratchPiece(base, &offset, sizeof(proofWriter));
+		keys = scratchPiece(base, &offset, sizeof(*keys) * rounds);
+		rs = scratchPiece(base, &offset, sizeof(*rs) * rounds);
+		shares = scratchPiece(base, &offset, sizeof(*shares) * rounds);
+		as = scratchPiece(base, &offset, sizeof(a) * rounds);
+		es = scratchPiece(base, &offset, sizeof(int) * rounds);
+		batchStart = scratchPiece(base, &offset, sizeof(int) * rounds);
+		batchSize = scratchPiece(base, &offset, sizeof(int) * rounds);
+		index = scratchPiece(base, &offset, sizeof(uint64_t) * (rounds + 1));
+		views = scratchPiece(base, &offset, keepViews ? sizeof(*views) * rounds : 0);
+		threadViews = scratchPiece(base, &offset, keepViews ? 0 : sizeof(*threadViews) * threads);
+		if (pass == 0 && !(base = ctxScratch(ctx, offset))) {
+			return ZKBOO_NO_MEMORY;
+		}
+	}
+
+	//Generating keys and rs
+	if(RAND_bytes((unsigned char *)keys, rounds * NUM_BRANCHES * 16) != 1) {
+		return ZKBOO_NO_RANDOMNESS;
+	}
+	if(RAND_bytes((unsigned char *)rs, rounds * NUM_BRANCHES * 4) != 1) {
+		return ZKBOO_NO_RANDOMNESS;
+	}
+
+	//Sharing secrets
+	if(RAND_bytes((unsigned char *)shares, rounds * NUM_BRANCHES * inputLen) != 1) {
+		return ZKBOO_NO_RANDOMNESS;
+	}
+
+	//fill shares for 3rd branch with input xored by other 2 branches.
+	for(int round=0; round<rounds; round++) {
+		for (int j = 0; j < inputLen; j++) { //iterate for the len of the input
+			shares[round][2][j] = input[j] ^ shares[round][0][j] ^ shares[round][1][j];
+		}
+	}
+	//A compact proof derives the shares of branches 0 and 1 and all rs from the keys instead
+	if(proof->compact) {
+		CryptoCtx crypto;
+		initCryptoCtx(&crypto, proof->backends);
+		for(int round=0; round<rounds; round++) {
+			compactShares(&crypto, inputLen, input, keys[round], shares[round], rs[round]);
+		}
+		cleanupCryptoCtx(&crypto);
+		if (crypto.failed) {
+			return ZKBOO_CRYPTO_ERROR;
+		}
+	}
+
+	//Rounds are committed in batches of as many rounds as the CPU runs side by side
+	int numBatches = planBatches(rounds, batchStart, batchSize);
+
+	bufferSink sink = { ctx, out };
+	if (fd >= 0) {
+		writerInit(writer, fd);
+	} else {
+		writerInitBuffer(writer, reserveBuffer, &sink);
+	}
+	int opensslFailed;
+	if(blocks > 1) {
+		opensslFailed = proveBlocks(proof, inputLen, shares, keys, rs, threadViews, as, es, index, rounds, threads, batchStart, batchSize, numBatches, writer);
+	} else if(lowMemory) {
+		opensslFailed = proveLowMemory(proof, inputLen, shares, keys, rs, threadViews, as, es, index, rounds, threads, batchStart, batchSize, numBatches, writer);
+	} else {
+		opensslFailed = proveInMemory(proof, inputLen, shares, keys, rs, views, as, es, index, rounds, threads, batchStart, batchSize, numBatches, writer);
+	}
+	if (opensslFailed) {
+		return ZKBOO_CRYPTO_ERROR;
+	}
+	if (writer->failed) {
+		return fd >= 0 ? ZKBOO_IO_ERROR : ZKBOO_NO_MEMORY;
+	}
+	return ZKBOO_OK;
+}
+
+static zkboo_status proveSha256(zkboo_ctx* ctx, const unsigned char* input, size_t len, const zkboo_params* params, int fd, zkboo_buffer* out) {
+	ProofParams proof;
+	int rounds = paramsRounds(params);
+	if (len > MAX_INPUT_BYTES || rounds < 0 || proofParams(params, len, &proof) != 0) {
+		return ZKBOO_BAD_INPUT;
+	}
+	//Compact openings derive the input shares of a single block from the keys
+	if (proof.compact && (proof.prefixLen % 64 + len > BLOCK_INPUT_BYTES || proof.rehashes > 0)) {
+		return ZKBOO_UNSUPPORTED;
+	}
+	//An HMAC key is a single block, of the full openings of a proof of its own
+	if (proof.hmac && (proof.compact || proof.rehashes > 0 || len > 64)) {
+		return ZKBOO_UNSUPPORTED;
+	}
+	int lowMemory = params && params->lowMemory;
+	return SPECIALIZED_ROUNDS(rounds, proveRounds, ctx, input, len, &proof, lowMemory, fd, out);
+}
+
+zkboo_status zkboo_prove_sha256(zkboo_ctx* ctx, const unsigned char* input, size_t len, const zkboo_params* params, zkboo_buffer* out) {
+	zkboo_status status = proveSha256(ctx, input, len, params, -1, out);
+	if (status != ZKBOO_OK) {
+		out->size = 0;
+	}
+	return status;
+}
+
+zkboo_status zkboo_prove_sha256_fd(zkboo_ctx* ctx, const unsigned char* input, size_t len, const zkboo_params* params, int fd) {
+	return fd < 0 ? ZKBOO_IO_ERROR : proveSha256(ctx, input, len, params, fd, NULL);
+}
+
+static zkboo_status openStatus(proofStatus status) {
+	switch (status) {
+	case PROOF_OK: return ZKBOO_OK;
+	case PROOF_OTHER_CIRCUIT: return ZKBOO_OTHER_CIRCUIT;
+	case PROOF_WRONG_ROUNDS: return ZKBOO_WRONG_ROUNDS;
+	case PROOF_NO_MEMORY: return ZKBOO_NO_MEMORY;
+	default: return ZKBOO_BAD_PROOF;
+	}
+}
+
+//Fills in what result says about the proof itself, y being NULL until its hash is known
+static void describeProof(zkboo_result* result, const mappedProof* proof, const uint32_t* y) {
+	result->circuit = (zkboo_circuit)proof->circuit;
+	result->rounds = proof->rounds;
+	result->params.prg = (zkboo_prg)proof->params.backends.prg;
+	result->params.hash = (zkboo_hash)proof->params.backends.hash;
+	result->params.compact = proof->params.compact;
+	result->params.rounds = proof->rounds;
+	result->params.prefixLen = proof->params.prefixLen;
+	result->params.chain = proof->params.rehashes + 1;
+	result->params.hmac = proof->params.hmac;
+	if (y) {
+		memcpy(result->hash, y, sizeof(uint32_t) * 8);
+		result->hashWords = 8;
+	}
+}
+
+//Whether proof was made with the public prefix ctx verifies against
+static int prefixMatches(const zkboo_ctx* ctx, const mappedProof* proof) {
+	return (size_t)proof->params.prefixLen == ctx->prefixLen
+			&& (ctx->prefixLen == 0 || memcmp(proof->params.prefix, ctx->prefix, ctx->prefixLen) == 0);
+}
+
+//ZKBOO_OK if proof is of the statement ctx verifies: a hash or an HMAC, its public prefix and
+//hash chain length. Otherwise ZKBOO_NOT_VERIFIED with the reason in result.
+static zkboo_status statementStatus(const zkboo_ctx* ctx, const mappedProof* proof, zkboo_result* result) {
+	if (proof->params.hmac != ctx->hmac) {
+		result->reason = proof->params.hmac ? "proof of an HMAC, not a hash" : "proof of a hash, not an HMAC";
+		return ZKBOO_NOT_VERIFIED;
+	}
+	if (!prefixMatches(ctx, proof)) {
+		result->reason = "public prefix mismatch";
+		return ZKBOO_NOT_VERIFIED;
+	}
+	if (proof->params.rehashes + 1 != ctx->chain) {
+		result->reason = "hash chain length mismatch";
+		return ZKBOO_NOT_VERIFIED;
+	}
+	return ZKBOO_OK;
+}
+
+static zkboo_status verifiedStatus(verifyResult verified, zkboo_result* result) {
+	if (verified.round < 0) {
+		return ZKBOO_OK;
+	}
+	if (verified.reason == VERIFY_BAD_FILE) {
+		return ZKBOO_BAD_PROOF;
+	}
+	if (verified.reason == VERIFY_CRYPTO_ERROR) {
+		return ZKBOO_CRYPTO_ERROR;
+	}
+	if (verified.reason == VERIFY_NO_MEMORY) {
+		return ZKBOO_NO_MEMORY;
+	}
+	result->failedRound = verified.round;
+	result->reason = verifyReasonString(verified.reason);
+	return ZKBOO_NOT_VERIFIED;
+}
+
+//Verifies a proof opened in place, of rounds rounds, with its challenges and the working memory
+//of compact openings in the context's scratch block. Inlined into verifyOpened for each of the SPECIALIZED_ROUNDS.
+static inline __attribute__((always_inline)) zkboo_status verifyRounds(zkboo_ctx* ctx, const proofMap* map, const mappedProof* proof,
+		zkboo_result* result, int rounds) {
+	int* es = NULL;
+	const zCompact** zcs = NULL;
+	a* rebuilt = NULL; //the commitments of compact openings
+	View (*threadViews)[VERIFY_BATCH][TWO_BRANCHES] = NULL; //a batch's compact views per thread
+	unsigned char* base = NULL;
+	int compact = proof->params.compact;
+	int threads = ctx->threads > 0 ? ctx->threads : omp_get_max_threads();
+	for (int pass = 0; pass < 2; pass++) {
+		size_t offset = 0;
+		es = scratchPiece(base, &offset, sizeof(int) * rounds);
+		zcs = scratchPiece(base, &offset, compact ? sizeof(const zCompact*) * rounds : 0);
+		rebuilt = scratchPiece(base, &offset, compact ? sizeof(a) * rounds : 0);
+		threadViews = scratchPiece(base, &offset, compact ? sizeof(*threadViews) * threads : 0);
+		if (pass == 0 && !(base = ctxScratch(ctx, offset))) {
+			return ZKBOO_NO_MEMORY;
+		}
+	}
+	CryptoCtx crypto;
+	initCryptoCtx(&crypto, proof->params.backends);
+	verifyResult verified;
+	if (compact) {
+		describeProof(result, proof, proof->y);
+		//The challenges give the size of every opening
+		esFromDigest(&crypto, proof->digest, rounds, es);
+		cleanupCryptoCtx(&crypto);
+		if (crypto.failed) {
+			return ZKBOO_CRYPTO_ERROR;
+		}
+		for (int round = 0; round < rounds; round++) {
+			zcs[round] = compactOpening(map, proof, round, es[round]);
+			if (!zcs[round]) {
+				return ZKBOO_BAD_PROOF;
+			}
+		}
+		verified = verifyCompactProof(&proof->params, proof->y, proof->digest, es, zcs, rounds, &proof->plan.first, threads, rebuilt, threadViews);
+	} else {
+		uint32_t y[8]; //xoring yps will get result = y = hash
+		reconstruct(proof->as[0].yp[0], proof->as[0].yp[1], proof->as[0].yp[2], y);
+		describeProof(result, proof, y);
+		calculateEs(&crypto, proof->header ? &proof->params : NULL, y, proof->as, rounds, es); //calculate Es for all rounds
+		cleanupCryptoCtx(&crypto);
+		if (crypto.failed) {
+			return ZKBOO_CRYPTO_ERROR;
+		}
+		verified = verifyProof(proof->params.backends, proof->as, es, proof->zs, &proof->plan, rounds, threads);
+	}
+	return verifiedStatus(verified, result);
+}
+
+static zkboo_status verifyOpened(zkboo_ctx* ctx, const proofMap* map, const mappedProof* proof, zkboo_result* result) {
+	zkboo_status status = statementStatus(ctx, proof, result);
+	if (status != ZKBOO_OK) {
+		return status;
+	}
+	return SPECIALIZED_ROUNDS(proof->rounds, verifyRounds, ctx, map, proof, result);
+}
+
+zkboo_status zkboo_verify_sha256(zkboo_ctx* ctx, const void* data, size_t len, zkboo_result* result) {
+	zkboo_result unused;
+	if (!result) {
+		result = &unused;
+	}
+	memset(result, 0, sizeof(*result));
+	result->circuit = ZKBOO_SHA256;
+	result->failedRound = -1;
+
+	//The proof is read in place as a, z and zCompact structs, which needs it aligned. The
+	//copy cannot be in the scratch block, which holds the challenges.
+	void* copy = NULL;
+	if ((uintptr_t)data % CONTAINER_ALIGN != 0) {
+		if (!(copy = ctxAlloc(ctx, len))) {
+			return ZKBOO_NO_MEMORY;
+		}
+		memcpy(copy, data, len);
+		data = copy;
+	}
+	proofMap map = { data, len };
+	mappedProof proof;
+	proofStatus status = openProof(&map, ctx->minRounds, &proof);
+	describeProof(result, &proof, NULL);
+	zkboo_status ret = status == PROOF_OK ? verifyOpened(ctx, &map, &proof, result) : openStatus(status);
+	ctxFree(ctx, copy);
+	return ret;
+}
+
+zkboo_status zkboo_verify_sha256_stream(zkboo_ctx* ctx, FILE* file, zkboo_result* result) {
+	zkboo_result unused;
+	if (!result) {
+		result = &unused;
+	}
+	memset(result, 0, sizeof(*result));
+	result->circuit = ZKBOO_SHA256;
+	result->failedRound = -1;
+
+	//The stream's memory comes from the context's allocator
+	streamAllocator allocator = { ctx->allocator.alloc, ctx->allocator.free, ctx->allocator.opaque };
+	proofStream stream;
+	proofStatus status = openProofStream(file, ctx->minRounds, &allocator, &stream);
+	describeProof(result, &stream.info, status == PROOF_OK ? stream.y : NULL);
+	zkboo_status ret = openStatus(status);
+	if (status == PROOF_OK) {
+		ret = statementStatus(ctx, &stream.info, result);
+	}
+	if (status == PROOF_OK && ret == ZKBOO_OK) {
+		ret = verifiedStatus(verifyProofStream(&stream, ctx->threads), result);
+	}
+	closeProofStream(&stream);
+	return ret;
+}
+
+const char* zkboo_prg_name(zkboo_prg prg) {
+	return (unsigned)prg < NUM_PRGS ? prgNames[prg] : NULL;
+}
+
+const char* zkboo_hash_name(zkboo_hash hash) {
+	return (unsigned)hash < NUM_HASHES ? hashNames[hash] : NULL;
+}
+
+int zkboo_prg_by_name(const char* name) {
+	return backendByName(prgNames, NUM_PRGS, name);
+}
+
+int zkboo_hash_by_name(const char* name) {
+	return backendByName(hashNames, NUM_HASHES, name);
+}
@@ -0,0 +1,205 @@
+ /*
+ ============================================================================
+ Name        : zkbpp.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : ZKB++ compact openings for the SHA-256 prover and verifier
+ ============================================================================
+ */
+
+/*
+ * Included at the end of shared.h. A compact proof is computed exactly
+ * like a full one, with the same views, commitments and challenges, but
+ * only stores what the verifier cannot recompute (ZKB++, eprint 2017/279):
+ *  - The input shares of branches 0 and 1 and the commitment randomness
+ *    of every branch come from the branch key, as the SEED_EXTRA_BLOCKS
+ *    tape blocks following the gate randomness. Only branch 2's input
+ *    share is sent, and only in rounds that open it.
+ *  - Of the two opened branches only branch e+1's gate words are sent.
+ *    The verifier computes branch e's from them and both tapes.
+ *  - No output shares are sent. The opened branches' follow from their
+ *    views and the third from the public hash.
+ *  - Of the commitments only the unopened branch's hash is sent.
+ * The verifier rebuilds every round's commitment from this, then checks
+ * that hashing them gives the challenge digest stored in the proof. A
+ * bad proof therefore fails as a whole and not at a particular round.
+ *
+ * In the proof file (container.h) the public section is the hash y and
+ * the challenge digest, then any public prefix, which the challenge digest
+ * covers as well, and every round's opening is ke0, ke1, h2, the
+ * gate words of y1 that the gate plan uses and, when e != 0, inputLen
+ * bytes of x2. x2 follows the used words directly, in the file and in
+ * a zCompact alike, see compactX2.
+ */
+
+#ifndef ZKBPP_H_
+#define ZKBPP_H_
+
+//The SEED_EXTRA_BLOCKS tape blocks after TAPE_BLOCKS derived from a branch key: branches 0 and
+//1 take their input share from the first 55 bytes, every branch its commitment randomness
+//from the last 4. Compact openings only hold inputs of one block.
+
+typedef struct {
+	unsigned char ke0[16]; //key of branch e
+	unsigned char ke1[16]; //key of branch e+1
+	unsigned char h2[32]; //commitment of the unopened branch e+2
+	uint32_t y1[ySize - 8]; //gate words of branch e+1
+	unsigned char x2[BLOCK_INPUT_BYTES]; //room for the input share of branch 2 when it is opened (e != 0)
+} zCompact;
+
+//Branch 2's input share in zc, straight after the plan's words of y1
+static inline const unsigned char* compactX2(const zCompact* zc, const gatePlan* plan) {
+	return (const unsigned char*)(zc->y1 + plan->words);
+}
+
+void seedExtras(CryptoCtx* crypto, const unsigned char key[16], unsigned char share[BLOCK_INPUT_BYTES], unsigned char r[4]) {
+	unsigned char extra[SEED_EXTRA_BLOCKS * 16];
+	unsigned char* out = extra;
+	keystreamForKeys(crypto, 1, &key, &out, TAPE_BLOCKS, SEED_EXTRA_BLOCKS);
+	memcpy(share, extra, BLOCK_INPUT_BYTES);
+	memcpy(r, extra + sizeof(extra) - 4, 4);
+}
+
+//The input shares and commitment randomness of one round of a compact proof, from its keys
+void compactShares(CryptoCtx* crypto, int inputLen, const unsigned char* input, unsigned char keys[NUM_BRANCHES][16],
+		unsigned char shares[NUM_BRANCHES][inputLen], unsigned char rs[NUM_BRANCHES][4]) {
+	unsigned char seeded[NUM_BRANCHES][BLOCK_INPUT_BYTES];
+	for (int branch = 0; branch < NUM_BRANCHES; branch++) {
+		seedExtras(crypto, keys[branch], seeded[branch], rs[branch]);
+	}
+	memcpy(shares[0], seeded[0], inputLen);
+	memcpy(shares[1], seeded[1], inputLen);
+	for (int j = 0; j < inputLen; j++) {
+		shares[2][j] = input[j] ^ shares[0][j] ^ shares[1][j];
+	}
+}
+
+zCompact getCompactProof(int e, const gatePlan* plan, unsigned char keys[NUM_BRANCHES][16], View views[NUM_BRANCHES], const a* a) {
+	zCompact zc;
+	memset(&zc, 0, sizeof(zc));
+	memcpy(zc.ke0, keys[e], 16);
+	memcpy(zc.ke1, keys[(e + 1) % NUM_BRANCHES], 16);
+	memcpy(zc.h2, a->h[(e + 2) % NUM_BRANCHES], 32);
+	memcpy(zc.y1, views[(e + 1) % NUM_BRANCHES].y, sizeof(uint32_t) * plan->words);
+	if (e != 0) {
+		memcpy((unsigned char*)compactX2(&zc, plan), views[2].x + plan->secretFrom, plan->inputLen);
+	}
+	return zc;
+}
+
+static inline size_t compactOpeningBytes(int e, const gatePlan* plan) {
+	return 16 + 16 + 32 + sizeof(uint32_t) * plan->words + (e != 0 ? plan->inputLen : 0);
+}
+
+//Writes an opening in its proof file layout, padded for the next one
+void writeCompactOpening(FILE* file, const zCompact* zc, int e, const gatePlan* plan) {
+	fwrite(zc->ke0, 1, 16, file);
+	fwrite(zc->ke1, 1, 16, file);
+	fwrite(zc->h2, 1, 32, file);
+	fwrite(zc->y1, sizeof(uint32_t), plan->words, file);
+	if (e != 0) {
+		fwrite(compactX2(zc, plan), 1, plan->inputLen, file);
+	}
+	containerPad(file, compactOpeningBytes(e, plan));
+}
+
+//Recomputes the two opened views of a round and their commitment randomness, and fills in the
+//output shares of a that follow from them and y. The hashes of a are left to the caller.
+void rebuildOpenedViews(const zCompact* zc, int e, const gatePlan* plan, const uint32_t y[8], CryptoCtx* crypto,
+		View views[TWO_BRANCHES], unsigned char rs[TWO_BRANCHES][4], a* a) {
+	const unsigned char* keys[TWO_BRANCHES] = { zc->ke0, zc->ke1 };
+	for (int i = 0; i < TWO_BRANCHES; i++) {
+		unsigned char share[BLOCK_INPUT_BYTES];
+		seedExtras(crypto, keys[i], share, rs[i]);
+		paddedBlock((e + i) % NUM_BRANCHES == 2 ? compactX2(zc, plan) : share, plan, 0, views[i].x);
+		//The words no gate uses are zero in the committed views
+		memset(&views[i].y[plan->words], 0, sizeof(uint32_t) * (NUM_GATES - plan->words));
+	}
+	memcpy(views[1].y, zc->y1, sizeof(uint32_t) * plan->words);
+
+	//Branch e's gate words are computed, so no gate can fail here; a wrong word only shows
+	//in the commitments and with them the challenge digest
+	openedViews opened = { &views[0], &views[1], views[0].y, plan, 0 };
+	uint32_t outputs[TWO_BRANCHES][8];
+	evalOpenedBranches(&opened, zc->ke0, zc->ke1, crypto, outputs);
+	memcpy(&views[0].y[ySize - 8], outputs[0], 32);
+	memcpy(&views[1].y[ySize - 8], outputs[1], 32);
+
+	for (int i = 0; i < 8; i++) {
+		a->yp[e][i] = outputs[0][i];
+		a->yp[(e + 1) % NUM_BRANCHES][i] = outputs[1][i];
+		a->yp[(e + 2) % NUM_BRANCHES][i] = y[i] ^ outputs[0][i] ^ outputs[1][i];
+	}
+	memcpy(a->h[(e + 2) % NUM_BRANCHES], zc->h2, 32);
+}
+
+//Rebuilds the commitments of rounds first to first + count - 1 into as, their openings being
+//batch[0] to batch[count - 1]. views is scratch space for VERIFY_BATCH rounds.
+void rebuildCompactBatch(CryptoCtx* crypto, const uint32_t y[8], const int* es, const zCompact* const batch[], int first, int count,
+		const gatePlan* plan, View views[][TWO_BRANCHES], a* as) {
+	unsigned char rs[VERIFY_BATCH][TWO_BRANCHES][4];
+	const unsigned char* hashKeys[VERIFY_BATCH * TWO_BRANCHES];
+	const unsigned char* hashRs[VERIFY_BATCH * TWO_BRANCHES];
+	const View* hashViews[VERIFY_BATCH * TWO_BRANCHES];
+	unsigned char* hashOut[VERIFY_BATCH * TWO_BRANCHES];
+	for (int i = 0; i < count; i++) {
+		int round = first + i, e = es[round];
+		rebuildOpenedViews(batch[i], e, plan, y, crypto, views[i], rs[i], &as[round]);
+		for (int branch = 0; branch < TWO_BRANCHES; branch++) {
+			hashKeys[2 * i + branch] = branch == 0 ? batch[i]->ke0 : batch[i]->ke1;
+			hashViews[2 * i + branch] = &views[i][branch];
+			hashRs[2 * i + branch] = rs[i][branch];
+			hashOut[2 * i + branch] = as[round].h[(e + branch) % NUM_BRANCHES];
+		}
+	}
+	commitHashes(crypto, count * TWO_BRANCHES, hashKeys, hashViews, hashRs, hashOut);
+}
+
+//The result of a compact proof made with params once all its commitments have been rebuilt into as
+verifyResult checkCompactChallenge(const ProofParams* params, const uint32_t y[8], const unsigned char digest[SHA256_DIGEST_LENGTH], const a* as, int rounds) {
+	verifyResult result = { -1, VERIFY_OK };
+	CryptoCtx crypto;
+	unsigned char recomputed[SHA256_DIGEST_LENGTH];
+	initCryptoCtx(&crypto, params->backends);
+	challengeDigest(&crypto, params, y, as, rounds, recomputed);
+	cleanupCryptoCtx(&crypto);
+	if (crypto.failed) {
+		return cryptoFailure();
+	}
+	if (memcmp(recomputed, digest, SHA256_DIGEST_LENGTH) != 0) {
+#if VERBOSE
+		printf("Failing at %d", __LINE__);
+#endif
+		result.round = 0;
+		result.reason = VERIFY_BAD_CHALLENGE;
+	}
+	return result;
+}
+
+//Verifies a compact proof made with params of y with challenge digest digest on threads threads.
+//es must be those esFromDigest gives for digest, zcs[round] is the opening of round and plan is
+//the proof's gate schedule. as is room for the commitments of all rounds and views for a batch's
+//views on each thread. The result's round is 0 when the proof does not verify, as the failure
+//cannot be narrowed down to a round.
+verifyResult verifyCompactProof(const ProofParams* params, const uint32_t y[8], const unsigned char digest[SHA256_DIGEST_LENGTH],
+		const int* es, const zCompact* const zcs[], int rounds, const gatePlan* plan, int threads,
+		a* as, View views[][VERIFY_BATCH][TWO_BRANCHES]) {
+	int failed = 0;
+	#pragma omp parallel num_threads(threads)
+	{
+		CryptoCtx crypto;
+		initCryptoCtx(&crypto, params->backends);
+		View (*own)[TWO_BRANCHES] = views[omp_get_thread_num()];
+		#pragma omp for schedule(dynamic)
+		for (int first = 0; first < rounds; first += VERIFY_BATCH) {
+			int count = rounds - first < VERIFY_BATCH ? rounds - first : VERIFY_BATCH;
+			rebuildCompactBatch(&crypto, y, es, &zcs[first], first, count, plan, own, as);
+		}
+		cryptoFailed(&crypto, &failed);
+		cleanupCryptoCtx(&crypto);
+	}
+
+	return failed ? cryptoFailure() : checkCompactChallenge(params, y, digest, as, rounds);
+}
+
+#endif /* ZKBPP_H_ */
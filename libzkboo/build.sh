@@ -0,0 +1,19 @@
+#!/bin/bash
+# Builds libzkboo.a and libzkboo.so. The SHA-1 and SHA-256 code define functions of the same
+# names, so each half is compiled with hidden visibility and its hidden symbols are made local
+# before the halves go into one library; only the zkboo_ calls of zkboo.h stay global.
+# Each half's prover and verifier kernels are first written out by circuit_gen.
+cd "$(dirname "$0")"
+rm -f *.o libzkboo.a libzkboo.so circuit_gen ../MPC_SHA256/sha256_kernels.h ../MPC_SHA1/sha1_kernels.h
+gcc -Wall -O2 circuit_gen.c -o circuit_gen || exit 1
+./circuit_gen sha256 > ../MPC_SHA256/sha256_kernels.h || exit 1
+./circuit_gen sha1 > ../MPC_SHA1/sha1_kernels.h || exit 1
+CFLAGS="-g -O2 -fPIC -fvisibility=hidden -fopenmp -I."
+gcc -Wall $CFLAGS -c zkboo.c -o zkboo.o || exit 1
+gcc -Wall $CFLAGS -c ../MPC_SHA256/zkboo_sha256.c -o zkboo_sha256.o || exit 1
+gcc -Wall $CFLAGS -c ../MPC_SHA1/zkboo_sha1.c -o zkboo_sha1.o || exit 1
+for o in zkboo.o zkboo_sha256.o zkboo_sha1.o; do
+	objcopy --localize-hidden $o
+done
+ar rcs libzkboo.a zkboo.o zkboo_sha256.o zkboo_sha1.o
+gcc -shared -fopenmp zkboo.o zkboo_sha256.o zkboo_sha1.o -lcrypto -o libzkboo.so
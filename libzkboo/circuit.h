@@ -0,0 +1,215 @@
+ /*
+ ============================================================================
+ Name        : circuit.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : Word circuits that the provers and verifiers interpret
+ ============================================================================
+ */
+
+/*
+ * A hash's compression function is written down once, as a circuit of
+ * gates on 32 bit registers, and the three-party prover, the two-branch
+ * verifier and the planner of gates on public values all run that same
+ * list, see circuit_mpc.h, or circuit_gen.c's straight-line copy of it.
+ * A circuit's registers start with its inputs, the 16 words of a message
+ * block and then the chaining value, and its outputs are the registers
+ * holding the next chaining value.
+ *
+ * Only AND, ADD, ADDK and MAJ are gates in the ZKBoo sense: each takes a
+ * 32 bit word of every party's tape and leaves a y word in every view,
+ * in circuit order. Their count, words, gives the size of the views and
+ * of the tapes. The other ops are linear and every party runs them alone.
+ *
+ * Included by both halves of the library, so everything here is static.
+ */
+
+#ifndef CIRCUIT_H_
+#define CIRCUIT_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define CIRCUIT_MAX_GATES 2048
+#define CIRCUIT_MAX_REGISTERS 256
+#define CIRCUIT_MAX_OUTPUTS 8
+
+typedef enum {
+	CIRCUIT_XOR, //z = x ^ y
+	CIRCUIT_NOT, //z = ~x
+	CIRCUIT_ROTR, //z = x rotated right by bits
+	CIRCUIT_SHR, //z = x >> bits
+	CIRCUIT_AND, //z = x & y, a gate
+	CIRCUIT_ADD, //z = x + y, a gate
+	CIRCUIT_ADDK, //z = x + k, a gate
+	CIRCUIT_MAJ //z = (x & y) ^ (x & w) ^ (y & w), one gate: (x ^ y) & (x ^ w) ^ x
+} circuitOp;
+
+typedef struct {
+	uint8_t op; //circuitOp
+	uint8_t bits; //ROTR and SHR
+	uint8_t z; //the register written, which may also be read
+	uint8_t x;
+	uint8_t y;
+	uint8_t w; //MAJ's third input
+	uint32_t k; //ADDK's constant
+} circuitGate;
+
+typedef struct {
+	int inputs; //input registers: the message words, then the chaining value
+	int registers; //registers used, the inputs first
+	int outputs;
+	int gates; //entries of gate, linear ops included
+	int words; //AND, ADD, ADDK and MAJ gates, each a y word of every view and 4 tape bytes
+	uint8_t output[CIRCUIT_MAX_OUTPUTS]; //the registers holding the outputs at the end
+	circuitGate gate[CIRCUIT_MAX_GATES];
+} circuit;
+
+//The tape bytes a circuit of words gates reads, in whole 16 byte AES blocks
+#define CIRCUIT_TAPE_BYTES(words) (((words) * 4 + 15) / 16 * 16)
+
+static inline int circuitIsGate(circuitOp op) {
+	return op == CIRCUIT_AND || op == CIRCUIT_ADD || op == CIRCUIT_ADDK || op == CIRCUIT_MAJ;
+}
+
+//Starts c with inputs input registers
+static inline void circuitBegin(circuit* c, int inputs) {
+	memset(c, 0, sizeof(*c));
+	c->inputs = inputs;
+	c->registers = inputs;
+}
+
+//A register no gate has written yet
+static inline int circuitRegister(circuit* c) {
+	return c->registers++;
+}
+
+static inline void circuitOpAdd(circuit* c, circuitOp op, int z, int x, int y, int w, int bits, uint32_t k) {
+	circuitGate* g = &c->gate[c->gates++];
+	g->op = op;
+	g->bits = bits;
+	g->z = z;
+	g->x = x;
+	g->y = y;
+	g->w = w;
+	g->k = k;
+	c->words += circuitIsGate(op);
+}
+
+static inline void circuitXor(circuit* c, int z, int x, int y) {
+	circuitOpAdd(c, CIRCUIT_XOR, z, x, y, 0, 0, 0);
+}
+
+static inline void circuitNot(circuit* c, int z, int x) {
+	circuitOpAdd(c, CIRCUIT_NOT, z, x, 0, 0, 0, 0);
+}
+
+static inline void circuitRotr(circuit* c, int z, int x, int bits) {
+	circuitOpAdd(c, CIRCUIT_ROTR, z, x, 0, 0, bits, 0);
+}
+
+static inline void circuitRotl(circuit* c, int z, int x, int bits) {
+	circuitOpAdd(c, CIRCUIT_ROTR, z, x, 0, 0, 32 - bits, 0);
+}
+
+static inline void circuitShr(circuit* c, int z, int x, int bits) {
+	circuitOpAdd(c, CIRCUIT_SHR, z, x, 0, 0, bits, 0);
+}
+
+static inline void circuitAnd(circuit* c, int z, int x, int y) {
+	circuitOpAdd(c, CIRCUIT_AND, z, x, y, 0, 0, 0);
+}
+
+static inline void circuitAdd(circuit* c, int z, int x, int y) {
+	circuitOpAdd(c, CIRCUIT_ADD, z, x, y, 0, 0, 0);
+}
+
+static inline void circuitAddK(circuit* c, int z, int x, uint32_t k) {
+	circuitOpAdd(c, CIRCUIT_ADDK, z, x, 0, 0, 0, k);
+}
+
+static inline void circuitMaj(circuit* c, int z, int x, int y, int w) {
+	circuitOpAdd(c, CIRCUIT_MAJ, z, x, y, w, 0, 0);
+}
+
+//z = CH(e, f, g) = (e & f) ^ (~e & g), as e & (f ^ g) ^ g: one AND gate, local when e or f ^ g
+//is public. t is a scratch register.
+static inline void circuitCh(circuit* c, int z, int e, int f, int g, int t) {
+	circuitXor(c, t, f, g);
+	circuitAnd(c, t, e, t);
+	circuitXor(c, z, t, g);
+}
+
+//Ends c with its outputs in registers output[0] to output[outputs - 1]
+static inline void circuitEnd(circuit* c, const int* output, int outputs) {
+	c->outputs = outputs;
+	for (int i = 0; i < outputs; i++) {
+		c->output[i] = output[i];
+	}
+}
+
+//Works out which gates of c need not be gates when the input registers for which publicIn is 1
+//hold public values, shared as (v, v, v): every party can then compute them alone. local gets
+//1 or 0 for each of c's words gates in turn; returns how many are left as gates. An AND is
+//local with either input public, a MAJ with two of them, an ADD with both; any other op's
+//output is public when all its inputs are.
+static inline int circuitLocalGates(const circuit* c, const unsigned char* publicIn, unsigned char* local) {
+	unsigned char pub[CIRCUIT_MAX_REGISTERS] = { 0 };
+	memcpy(pub, publicIn, c->inputs);
+	int words = 0;
+	int gate = 0;
+	for (int i = 0; i < c->gates; i++) {
+		const circuitGate* g = &c->gate[i];
+		int x = pub[g->x], y = pub[g->y], w = pub[g->w];
+		switch ((circuitOp)g->op) {
+		case CIRCUIT_XOR:
+			pub[g->z] = x && y;
+			break;
+		case CIRCUIT_NOT:
+		case CIRCUIT_ROTR:
+		case CIRCUIT_SHR:
+			pub[g->z] = x;
+			break;
+		case CIRCUIT_AND:
+			local[gate] = x || y;
+			pub[g->z] = x && y;
+			break;
+		case CIRCUIT_ADD:
+			local[gate] = x && y;
+			pub[g->z] = x && y;
+			break;
+		case CIRCUIT_ADDK:
+			local[gate] = x;
+			pub[g->z] = x;
+			break;
+		case CIRCUIT_MAJ:
+			local[gate] = x + y + w >= 2;
+			pub[g->z] = x && y && w;
+			break;
+		}
+		if (circuitIsGate(g->op)) {
+			words += !local[gate++];
+		}
+	}
+	return words;
+}
+
+//Runs c in the clear on the registers regs, inputs filled in: the hash function itself
+static inline void circuitEval(const circuit* c, uint32_t regs[]) {
+	for (int i = 0; i < c->gates; i++) {
+		const circuitGate* g = &c->gate[i];
+		uint32_t x = regs[g->x], y = regs[g->y], w = regs[g->w];
+		switch ((circuitOp)g->op) {
+		case CIRCUIT_XOR: regs[g->z] = x ^ y; break;
+		case CIRCUIT_NOT: regs[g->z] = ~x; break;
+		case CIRCUIT_ROTR: regs[g->z] = (x >> g->bits) | (x << ((32 - g->bits) & 31)); break;
+		case CIRCUIT_SHR: regs[g->z] = x >> g->bits; break;
+		case CIRCUIT_AND: regs[g->z] = x & y; break;
+		case CIRCUIT_ADD: regs[g->z] = x + y; break;
+		case CIRCUIT_ADDK: regs[g->z] = x + g->k; break;
+		case CIRCUIT_MAJ: regs[g->z] = (x & y) ^ (x & w) ^ (y & w); break;
+		}
+	}
+}
+
+#endif /* CIRCUIT_H_ */
@@ -0,0 +1,194 @@
+ /*
+ ============================================================================
+ Name        : circuit_gen.c
+ Author      : Sobuno
+ Version     : 0.1
+ Description : Writes out a circuit's prover and verifier as straight-line C
+ ============================================================================
+ */
+
+/*
+ * Run by build.sh before the library is compiled:
+ *
+ *   circuit_gen sha256 > ../MPC_SHA256/sha256_kernels.h
+ *   circuit_gen sha1 > ../MPC_SHA1/sha1_kernels.h
+ *
+ * For a circuit <name>Circuit it writes <name>ProveKernel and
+ * <name>VerifyKernel, which do what circuitProve and circuitVerify of
+ * circuit_mpc.h do for that circuit, gate by gate without a loop: every
+ * register is a local variable, the rotations and constants are literals
+ * and, for a circuit without gates on public values, every gate's tape
+ * offset and y word are too. The output is included by the shared.h of
+ * its half after circuit_mpc.h, whose gate functions it calls.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "../MPC_SHA256/sha256_circuit.h"
+#include "../MPC_SHA1/sha1_circuit.h"
+
+typedef struct {
+	const char* name;
+	void (*build)(circuit* c);
+	//Whether the kernels take the local flags of a gate plan, and so work out the tape offset
+	//and y word of each gate as they go
+	int planned;
+} circuitKind;
+
+static const circuitKind kinds[] = {
+	{ "sha256", buildSha256Circuit, 1 },
+	{ "sha1", buildSha1Circuit, 0 },
+};
+
+typedef enum { KERNEL_PROVE, KERNEL_VERIFY } kernelKind;
+
+//Tracking the hundreds of registers of a kernel for -g takes gcc longer than the rest of its build
+#define KERNEL_ATTRIBUTES "__attribute__ ((optimize (\"no-var-tracking-assignments\")))"
+
+//The gate's second operand: a register, or ADDK's constant in every share
+static void operand(char* out, size_t size, const circuitGate* g, const char* type) {
+	if (g->op == CIRCUIT_ADDK) {
+		snprintf(out, size, "(%s) { 0 } + 0x%08xu", type, g->k);
+	} else {
+		snprintf(out, size, "r%d", g->y);
+	}
+}
+
+//The gate computed by every party alone, for a gate plan that has it local
+static void emitLocal(FILE* f, const circuitGate* g, const char* v, const char* indent) {
+	switch ((circuitOp)g->op) {
+	case CIRCUIT_AND: fprintf(f, "%sr%d = r%d & %s;\n", indent, g->z, g->x, v); break;
+	case CIRCUIT_MAJ: fprintf(f, "%sr%d = (r%d & (%s ^ r%d)) ^ (%s & r%d);\n", indent, g->z, g->x, v, g->w, v, g->w); break;
+	default: fprintf(f, "%sr%d = r%d + %s;\n", indent, g->z, g->x, v); break;
+	}
+}
+
+//The gate run by the parties or checked on the branches, taking the tape bytes at randCount and
+//the y word at countY
+static void emitGate(FILE* f, kernelKind kind, const circuitGate* g, int i, const char* v, const char* randCount, const char* countY, const char* indent) {
+	const char* fn = g->op == CIRCUIT_AND ? "And" : g->op == CIRCUIT_MAJ ? "Maj" : "Add";
+	char w[16] = "";
+	if (g->op == CIRCUIT_MAJ) {
+		snprintf(w, sizeof(w), ", r%d", g->w);
+	}
+	if (kind == KERNEL_PROVE) {
+		fprintf(f, "%sr%d = circuitProve%s(r%d, %s%s, tapes, %s, y, %s);\n", indent, g->z, fn, g->x, v, w, randCount, countY);
+	} else {
+		fprintf(f, "%sif (circuitVerify%s(r%d, %s%s, tapes, %s, y0, y1, fill, %s, &r%d) != 0) {\n", indent, fn, g->x, v, w, randCount, countY, g->z);
+		fprintf(f, "%s\treturn %d;\n", indent, i);
+		fprintf(f, "%s}\n", indent);
+	}
+}
+
+static void emitKernel(FILE* f, const circuitKind* spec, const circuit* c, kernelKind kind) {
+	const char* type = kind == KERNEL_PROVE ? "parties" : "branches";
+	const char* local = spec->planned ? "const unsigned char* local, " : "";
+	if (kind == KERNEL_PROVE) {
+		fprintf(f, "//circuitProve(%sCircuit(), %s, ...), gate by gate\n", spec->name, spec->planned ? "local" : "NULL");
+		fprintf(f, "static void " KERNEL_ATTRIBUTES " %sProveKernel(%sparties regs[], CIRCUIT_TAPE tapes[3], uint32_t* y[3], int* countY) {\n", spec->name, local);
+	} else {
+		fprintf(f, "static inline __attribute__ ((always_inline)) int %sVerifyGates(%sbranches regs[], CIRCUIT_TAPE tapes[2], const uint32_t* y0, const uint32_t* y1, uint32_t* fill, int* countY) {\n", spec->name, local);
+	}
+	fprintf(f, "\tint n = *countY;\n");
+	if (spec->planned) {
+		fprintf(f, "\tint randCount = 0;\n");
+	}
+	for (int r = 0; r < c->inputs; r++) {
+		fprintf(f, "\t%s r%d = regs[%d];\n", type, r, r);
+	}
+	for (int r = c->inputs; r < c->registers; r++) {
+		fprintf(f, "\t%s r%d;\n", type, r);
+	}
+
+	int gate = 0;
+	for (int i = 0; i < c->gates; i++) {
+		const circuitGate* g = &c->gate[i];
+		char v[64];
+		operand(v, sizeof(v), g, type);
+		switch ((circuitOp)g->op) {
+		case CIRCUIT_XOR:
+			fprintf(f, "\tr%d = r%d ^ r%d;\n", g->z, g->x, g->y);
+			continue;
+		case CIRCUIT_NOT:
+			fprintf(f, "\tr%d = ~r%d;\n", g->z, g->x);
+			continue;
+		case CIRCUIT_ROTR:
+			if (g->bits % 32 == 0) {
+				fprintf(f, "\tr%d = r%d;\n", g->z, g->x);
+			} else {
+				fprintf(f, "\tr%d = (r%d >> %d) | (r%d << %d);\n", g->z, g->x, g->bits, g->x, 32 - g->bits);
+			}
+			continue;
+		case CIRCUIT_SHR:
+			fprintf(f, "\tr%d = r%d >> %d;\n", g->z, g->x, g->bits);
+			continue;
+		default:
+			break;
+		}
+		if (spec->planned) {
+			fprintf(f, "\tif (local[%d]) {\n", gate);
+			emitLocal(f, g, v, "\t\t");
+			fprintf(f, "\t} else {\n");
+			emitGate(f, kind, g, i, v, "randCount", "n", "\t\t");
+			fprintf(f, "\t\trandCount += 4;\n");
+			fprintf(f, "\t\tn++;\n");
+			fprintf(f, "\t}\n");
+		} else {
+			char randCount[16], countY[32];
+			snprintf(randCount, sizeof(randCount), "%d", gate * 4);
+			snprintf(countY, sizeof(countY), "n + %d", gate);
+			emitGate(f, kind, g, i, v, randCount, countY, "\t");
+		}
+		gate++;
+	}
+
+	for (int i = 0; i < c->outputs; i++) {
+		fprintf(f, "\tregs[%d] = r%d;\n", c->output[i], c->output[i]);
+	}
+	fprintf(f, spec->planned ? "\t*countY = n;\n" : "\t*countY = n + %d;\n", c->words);
+	if (kind == KERNEL_VERIFY) {
+		fprintf(f, "\treturn -1;\n");
+	}
+	fprintf(f, "}\n");
+
+	if (kind == KERNEL_VERIFY) {
+		const char* localArg = spec->planned ? "local, " : "";
+		fprintf(f, "\n//circuitVerify(%sCircuit(), %s, ...), gate by gate: a copy of the gates for checking\n", spec->name, spec->planned ? "local" : "NULL");
+		fprintf(f, "//the y words and one for filling them in\n");
+		fprintf(f, "static int " KERNEL_ATTRIBUTES " %sVerifyKernel(%sbranches regs[], CIRCUIT_TAPE tapes[2], const uint32_t* y0, const uint32_t* y1, uint32_t* fill, int* countY) {\n", spec->name, local);
+		fprintf(f, "\tif (fill) {\n");
+		fprintf(f, "\t\treturn %sVerifyGates(%sregs, tapes, y0, y1, fill, countY);\n", spec->name, localArg);
+		fprintf(f, "\t}\n");
+		fprintf(f, "\treturn %sVerifyGates(%sregs, tapes, y0, y1, NULL, countY);\n", spec->name, localArg);
+		fprintf(f, "}\n");
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const circuitKind* spec = NULL;
+	for (size_t i = 0; argc == 2 && i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+		if (strcmp(argv[1], kinds[i].name) == 0) {
+			spec = &kinds[i];
+		}
+	}
+	if (!spec) {
+		fprintf(stderr, "Usage: %s sha256 | sha1\n", argv[0]);
+		return 1;
+	}
+
+	static circuit c;
+	spec->build(&c);
+
+	char guard[64];
+	snprintf(guard, sizeof(guard), "%s", spec->name);
+	for (char* p = guard; *p; p++) {
+		*p = *p >= 'a' && *p <= 'z' ? *p - 'a' + 'A' : *p;
+	}
+	printf("/* Written by libzkboo/circuit_gen.c from %sCircuit: %d gates, %d of them words. Do not edit. */\n\n", spec->name, c.gates, c.words);
+	printf("#ifndef %s_KERNELS_H_\n#define %s_KERNELS_H_\n\n", guard, guard);
+	emitKernel(stdout, spec, &c, KERNEL_PROVE);
+	printf("\n");
+	emitKernel(stdout, spec, &c, KERNEL_VERIFY);
+	printf("\n#endif /* %s_KERNELS_H_ */\n", guard);
+	return fflush(stdout) != 0;
+}
@@ -0,0 +1,235 @@
+ /*
+ ============================================================================
+ Name        : circuit_mpc.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : The three-party prover and two-branch verifier of a circuit
+ ============================================================================
+ */
+
+/*
+ * Runs a circuit of circuit.h as ZKBoo's three parties and checks it as
+ * the two opened branches. Included by the shared.h of each half once its
+ * tapes are defined, with CIRCUIT_TAPE the type of one party's tape and
+ * CIRCUIT_RAND(n, tapes, randCount, r) reading the 32 bit word at byte
+ * randCount of tapes[0] to tapes[n - 1] into r[0] to r[n - 1].
+ *
+ * Every gate that is not local takes the next 4 bytes of the tapes and the
+ * next y word of every view, in circuit order. A local gate, on public
+ * values shared as (v, v, v), is computed by every party alone and takes
+ * neither.
+ */
+
+#ifndef CIRCUIT_MPC_H_
+#define CIRCUIT_MPC_H_
+
+#if !defined(CIRCUIT_TAPE) || !defined(CIRCUIT_RAND)
+#error "circuit_mpc.h needs CIRCUIT_TAPE and CIRCUIT_RAND"
+#endif
+
+#include <stdint.h>
+#include "circuit.h"
+
+//The three parties' words packed in one register (lane 3 is unused)
+typedef uint32_t parties __attribute__ ((vector_size (16)));
+//Lane p gets party p+1, which every gate pairs party p with
+#define NEXT_PARTY(v) __builtin_shuffle((v), (parties) { 1, 2, 0, 3 })
+
+//Carry words of all three parties for z = x + y. Each step computes the full carry equation
+//of every party and bit with word ops; bit i of t is the new carry bit i+1, and bits above i+1
+//of c are still zero when it is set, so no bit extraction or data-dependent branch is needed.
+static inline parties mpc_ADD_carries(parties x, parties y, parties r) {
+	parties c = { 0 };
+	parties rr = r ^ NEXT_PARTY(r);
+	for (int i = 0; i < 31; i++) {
+		parties a = x ^ c;
+		parties b = y ^ c;
+		parties t = (a & NEXT_PARTY(b)) ^ (NEXT_PARTY(a) & b) ^ (a & b) ^ c ^ rr;
+		c |= (t << 1) & (2u << i);
+	}
+	return c;
+}
+
+//Word-level gate checks: return 0 when party 0's y word is consistent with the inputs,
+//otherwise a nonzero word whose set bits are the failing bit equations.
+static inline uint32_t AND_mismatch(const uint32_t x[2], const uint32_t y[2], const uint32_t r[2], uint32_t y0) {
+	return y0 ^ (x[0] & y[1]) ^ (x[1] & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
+}
+
+//All 31 carry equations of an ADD at once: bit i of t must equal carry bit i+1 of party 0.
+static inline uint32_t ADD_mismatch(const uint32_t x[2], const uint32_t y[2], const uint32_t r[2], uint32_t c0, uint32_t c1) {
+	uint32_t a0 = x[0] ^ c0, a1 = x[1] ^ c1;
+	uint32_t b0 = y[0] ^ c0, b1 = y[1] ^ c1;
+	uint32_t t = (a0 & b1) ^ (a1 & b0) ^ (a0 & b0) ^ c0 ^ r[0] ^ r[1];
+	return ((c0 >> 1) ^ t) & 0x7fffffff;
+}
+
+//Party 0's carry word of an ADD given party 1's, the one ADD_mismatch accepts. Expanding the
+//carry equation gives c0[i+1] = g[i] ^ (p[i] & c0[i]) with g and p below, and composing those
+//steps is associative, so the 31 steps take 5 prefix rounds.
+static inline uint32_t ADD_carries0(const uint32_t x[2], const uint32_t y[2], const uint32_t r[2], uint32_t c1) {
+	uint32_t a1 = x[1] ^ c1, b1 = y[1] ^ c1;
+	uint32_t g = (x[0] & b1) ^ (a1 & y[0]) ^ (x[0] & y[0]) ^ r[0] ^ r[1];
+	uint32_t p = a1 ^ b1 ^ x[0] ^ y[0];
+	for (int d = 1; d < 32; d <<= 1) {
+		g ^= p & (g << d);
+		p &= p << d;
+	}
+	return g << 1;
+}
+
+static inline uint32_t circuitRotr32(uint32_t x, int bits) {
+	return (x >> bits) | (x << ((32 - bits) & 31));
+}
+
+//The gates every party of the prover runs together: each takes the 4 bytes at randCount of
+//every tape, writes party p's y word to y[p][countY] and returns the parties' shares of z
+static inline parties circuitProveAnd(parties x, parties v, CIRCUIT_TAPE tapes[3], int randCount, uint32_t* y[3], int countY) {
+	uint32_t rand[3];
+	CIRCUIT_RAND(3, tapes, randCount, rand);
+	parties r = { rand[0], rand[1], rand[2] };
+	parties out = (x & NEXT_PARTY(v)) ^ (NEXT_PARTY(x) & v) ^ (x & v) ^ r ^ NEXT_PARTY(r);
+	y[0][countY] = out[0];
+	y[1][countY] = out[1];
+	y[2][countY] = out[2];
+	return out;
+}
+
+//z = (x ^ v) & (x ^ w) ^ x
+static inline parties circuitProveMaj(parties x, parties v, parties w, CIRCUIT_TAPE tapes[3], int randCount, uint32_t* y[3], int countY) {
+	return circuitProveAnd(x ^ v, x ^ w, tapes, randCount, y, countY) ^ x;
+}
+
+static inline parties circuitProveAdd(parties x, parties v, CIRCUIT_TAPE tapes[3], int randCount, uint32_t* y[3], int countY) {
+	uint32_t rand[3];
+	CIRCUIT_RAND(3, tapes, randCount, rand);
+	parties r = { rand[0], rand[1], rand[2] };
+	parties out = mpc_ADD_carries(x, v, r);
+	y[0][countY] = out[0];
+	y[1][countY] = out[1];
+	y[2][countY] = out[2];
+	return x ^ v ^ out;
+}
+
+//Runs c on the three parties' shares in regs, the inputs filled in by the caller, with tapes at
+//the circuit's start. The gates for which local is 1, in turn, are computed by every party
+//alone; local may be NULL when there are none. Every other gate writes party p's y word to
+//y[p][*countY] and moves countY on. circuit_gen writes this out as straight-line code.
+static void __attribute__ ((unused)) circuitProve(const circuit* c, const unsigned char* local, parties regs[], CIRCUIT_TAPE tapes[3], uint32_t* y[3], int* countY) {
+	int randCount = 0;
+	int gate = 0;
+	for (int i = 0; i < c->gates; i++) {
+		const circuitGate* g = &c->gate[i];
+		parties x = regs[g->x], v = regs[g->y];
+		switch ((circuitOp)g->op) {
+		case CIRCUIT_XOR: regs[g->z] = x ^ v; continue;
+		case CIRCUIT_NOT: regs[g->z] = ~x; continue;
+		case CIRCUIT_ROTR: regs[g->z] = (x >> g->bits) | (x << ((32 - g->bits) & 31)); continue;
+		case CIRCUIT_SHR: regs[g->z] = x >> g->bits; continue;
+		case CIRCUIT_ADDK: v = (parties) { 0 } + g->k; break;
+		default: break;
+		}
+		parties w = regs[g->w];
+		if (local && local[gate++]) {
+			switch ((circuitOp)g->op) {
+			case CIRCUIT_AND: regs[g->z] = x & v; break;
+			case CIRCUIT_MAJ: regs[g->z] = (x & (v ^ w)) ^ (v & w); break; //two of x, v and w public
+			default: regs[g->z] = x + v; break;
+			}
+			continue;
+		}
+		switch ((circuitOp)g->op) {
+		case CIRCUIT_AND: regs[g->z] = circuitProveAnd(x, v, tapes, randCount, y, *countY); break;
+		case CIRCUIT_MAJ: regs[g->z] = circuitProveMaj(x, v, w, tapes, randCount, y, *countY); break;
+		default: regs[g->z] = circuitProveAdd(x, v, tapes, randCount, y, *countY); break;
+		}
+		randCount += 4;
+		(*countY)++;
+	}
+}
+
+//The two opened branches' words packed in one register
+typedef uint32_t branches __attribute__ ((vector_size (8)));
+
+//The same gates checked on the two opened branches: each takes the 4 bytes at randCount of both
+//tapes and checks branch 0's y word y0[countY] or, when fill is not NULL, computes it into fill,
+//which aliases y0. Returns 1 when the word is inconsistent, otherwise 0 with the branches'
+//shares of z in *z.
+static inline int circuitVerifyAnd(branches x, branches v, CIRCUIT_TAPE tapes[2], int randCount, const uint32_t* y0, const uint32_t* y1, uint32_t* fill, int countY, branches* z) {
+	uint32_t r[2];
+	CIRCUIT_RAND(2, tapes, randCount, r);
+	uint32_t xs[2] = { x[0], x[1] }, vs[2] = { v[0], v[1] };
+	if (fill) {
+		fill[countY] = (xs[0] & vs[1]) ^ (xs[1] & vs[0]) ^ (xs[0] & vs[0]) ^ r[0] ^ r[1];
+	} else if (AND_mismatch(xs, vs, r, y0[countY]) != 0) {
+		return 1;
+	}
+	*z = (branches) { y0[countY], y1[countY] };
+	return 0;
+}
+
+static inline int circuitVerifyMaj(branches x, branches v, branches w, CIRCUIT_TAPE tapes[2], int randCount, const uint32_t* y0, const uint32_t* y1, uint32_t* fill, int countY, branches* z) {
+	if (circuitVerifyAnd(x ^ v, x ^ w, tapes, randCount, y0, y1, fill, countY, z) != 0) {
+		return 1;
+	}
+	*z ^= x;
+	return 0;
+}
+
+static inline int circuitVerifyAdd(branches x, branches v, CIRCUIT_TAPE tapes[2], int randCount, const uint32_t* y0, const uint32_t* y1, uint32_t* fill, int countY, branches* z) {
+	uint32_t r[2];
+	CIRCUIT_RAND(2, tapes, randCount, r);
+	uint32_t xs[2] = { x[0], x[1] }, vs[2] = { v[0], v[1] };
+	if (fill) {
+		fill[countY] = ADD_carries0(xs, vs, r, y1[countY]);
+	} else if (ADD_mismatch(xs, vs, r, y0[countY], y1[countY]) != 0) {
+		return 1;
+	}
+	*z = x ^ v ^ (branches) { y0[countY], y1[countY] };
+	return 0;
+}
+
+//Runs c on the two opened branches' shares in regs, the inputs filled in by the caller, with
+//tapes at the circuit's start, y0 and y1 being the branches' y words and local as for
+//circuitProve. Checks branch 0's y word of every gate that is not local or, when fill is not
+//NULL, computes it into fill, which aliases y0. Returns the index of the first gate whose y
+//word is inconsistent, or -1. circuit_gen writes this out as straight-line code.
+static int __attribute__ ((unused)) circuitVerify(const circuit* c, const unsigned char* local, branches regs[], CIRCUIT_TAPE tapes[2], const uint32_t* y0, const uint32_t* y1, uint32_t* fill, int* countY) {
+	int randCount = 0;
+	int gate = 0;
+	for (int i = 0; i < c->gates; i++) {
+		const circuitGate* g = &c->gate[i];
+		branches x = regs[g->x], v = regs[g->y];
+		switch ((circuitOp)g->op) {
+		case CIRCUIT_XOR: regs[g->z] = x ^ v; continue;
+		case CIRCUIT_NOT: regs[g->z] = ~x; continue;
+		case CIRCUIT_ROTR: regs[g->z] = (x >> g->bits) | (x << ((32 - g->bits) & 31)); continue;
+		case CIRCUIT_SHR: regs[g->z] = x >> g->bits; continue;
+		case CIRCUIT_ADDK: v = (branches) { 0 } + g->k; break;
+		default: break;
+		}
+		branches w = regs[g->w];
+		if (local && local[gate++]) {
+			switch ((circuitOp)g->op) {
+			case CIRCUIT_AND: regs[g->z] = x & v; break;
+			case CIRCUIT_MAJ: regs[g->z] = (x & (v ^ w)) ^ (v & w); break; //two of x, v and w public
+			default: regs[g->z] = x + v; break;
+			}
+			continue;
+		}
+		int bad;
+		switch ((circuitOp)g->op) {
+		case CIRCUIT_AND: bad = circuitVerifyAnd(x, v, tapes, randCount, y0, y1, fill, *countY, &regs[g->z]); break;
+		case CIRCUIT_MAJ: bad = circuitVerifyMaj(x, v, w, tapes, randCount, y0, y1, fill, *countY, &regs[g->z]); break;
+		default: bad = circuitVerifyAdd(x, v, tapes, randCount, y0, y1, fill, *countY, &regs[g->z]); break;
+		}
+		if (bad) {
+			return i;
+		}
+		randCount += 4;
+		(*countY)++;
+	}
+	return -1;
+}
+
+#endif /* CIRCUIT_MPC_H_ */
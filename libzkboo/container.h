@@ -0,0 +1,228 @@
+ /*
+ ============================================================================
+ Name        : container.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : Versioned proof file with a per-round index, read in place through mmap
+ ============================================================================
+ */
+
+/*
+ * The same file is used by the SHA-1 and the SHA-256 code, and only deals
+ * in byte counts, so it knows nothing of a, z or View. Layout, all integers
+ * little-endian:
+ *
+ *   offset  bytes
+ *   0       64               containerHeader
+ *   64      8 * (rounds + 1) round index: the file offset of every round's
+ *                            opening, then the offset where the last ends
+ *   ...     publicBytes      public section at publicOffset: one a per round
+ *                            for full openings, the hash y and the challenge
+ *                            digest for compact (ZKB++) openings, then the
+ *                            public prefix of a SHA-256 input or the message
+ *                            of an HMAC, if any
+ *   ...                      the openings, round by round
+ *
+ * Every section and every opening starts at a multiple of 8 bytes, with
+ * zero padding in between that readers check is zero, so that a mapped file can be used in place as
+ * a, z and zCompact structs. Full openings all have the same size and are
+ * back to back, so they can also be used as one z array. A SHA-256 input of
+ * several blocks, or of a hash chain, has the opened views of every block in
+ * each full opening, between the keys and the rs. The index lets a reader go straight to any
+ * round without parsing the ones before it.
+ *
+ * Readers reject files whose version they do not know. Later versions may
+ * grow the header, headerBytes says where the index starts. A file of this
+ * version has its sections exactly where containerLayout puts them and its
+ * reserved field zero, so that no byte of it can change without the proof
+ * being rejected or proving something else.
+ */
+
+#ifndef CONTAINER_H_
+#define CONTAINER_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Proof files are little-endian and read in place, which needs a little-endian host"
+#endif
+
+#define CONTAINER_VERSION 1
+#define CONTAINER_ALIGN 8
+#define CONTAINER_COMPACT 1 //flags: ZKB++ openings
+#define CONTAINER_PUBLIC_GATES 2 //flags: gates on public values computed in the clear, which needs inputLen
+#define CONTAINER_HMAC 4 //flags: HMAC-SHA256 keyed by the input, of the message stored as the prefix
+#define CONTAINER_MAX_ROUNDS 4096 //readers refuse more, which bounds what a header makes them allocate
+#define CONTAINER_LEGACY_ROUNDS 136 //the round count of every file in the original headerless format
+
+typedef enum {
+	CIRCUIT_SHA1 = 1,
+	CIRCUIT_SHA256 = 2
+} CircuitId;
+
+static const unsigned char containerMagic[4] = { 'Z', 'K', 'B', 'o' };
+
+typedef struct {
+	unsigned char magic[4];
+	uint16_t version;
+	uint16_t headerBytes; //where the round index starts
+	uint8_t circuit; //CircuitId
+	uint8_t prg; //PrgId of the tape PRG, always 0 (AES-128-CTR) for SHA-1
+	uint8_t hash; //HashId of the commitment hash, always 0 (SHA-256) for SHA-1
+	uint8_t flags;
+	uint32_t rounds;
+	uint32_t viewWords; //ySize, the 32 bit words in a view
+	uint32_t outputWords; //32 bit words of the hash proven
+	uint32_t inputLen; //bytes of secret input for compact openings, public gates, a prefix or several blocks, else 0
+	uint32_t prefixLen; //bytes of public prefix hashed ahead of the input, or of HMAC message, at the end of the public section
+	uint64_t indexOffset;
+	uint64_t publicOffset;
+	uint64_t publicBytes;
+	uint32_t rehashes; //times a SHA-256 digest is hashed again in a hash chain, 1 for SHA256d
+	uint32_t reserved2; //zero
+} containerHeader;
+
+_Static_assert(sizeof(containerHeader) == 64, "containerHeader must have no padding");
+
+static inline uint64_t containerAlign(uint64_t offset) {
+	return (offset + CONTAINER_ALIGN - 1) & ~(uint64_t)(CONTAINER_ALIGN - 1);
+}
+
+//Fills in the magic, version and offsets of header, whose other fields the caller has set, and
+//the rounds + 1 entries of index for openings of openingBytes[round] bytes
+void containerLayout(containerHeader* header, const size_t openingBytes[], uint64_t index[]) {
+	memcpy(header->magic, containerMagic, 4);
+	header->version = CONTAINER_VERSION;
+	header->headerBytes = sizeof(containerHeader);
+	header->indexOffset = sizeof(containerHeader);
+	header->publicOffset = header->indexOffset + sizeof(uint64_t) * (header->rounds + 1);
+	uint64_t offset = containerAlign(header->publicOffset + header->publicBytes);
+	for (uint32_t round = 0; round < header->rounds; round++) {
+		index[round] = offset;
+		offset = containerAlign(offset + openingBytes[round]);
+	}
+	index[header->rounds] = offset;
+}
+
+//Writes zero bytes up to the next multiple of CONTAINER_ALIGN after bytes written
+void containerPad(FILE* file, size_t bytes) {
+	static const unsigned char zeros[CONTAINER_ALIGN] = { 0 };
+	fwrite(zeros, 1, containerAlign(bytes) - bytes, file);
+}
+
+//Writes the header and index laid out by containerLayout. The public section is next, then
+//every opening, each followed by containerPad.
+void writeContainerHead(FILE* file, const containerHeader* header, const uint64_t index[]) {
+	fwrite(header, sizeof(containerHeader), 1, file);
+	fwrite(index, sizeof(uint64_t), header->rounds + 1, file);
+}
+
+typedef struct {
+	const unsigned char* data;
+	size_t size;
+} proofMap;
+
+//Maps the file at path read-only. Returns 0 on success.
+int mapProof(const char* path, proofMap* map) {
+	map->data = NULL;
+	map->size = 0;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return 1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return 1;
+	}
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return 1;
+	}
+	madvise(data, st.st_size, MADV_WILLNEED);
+	map->data = data;
+	map->size = st.st_size;
+	return 0;
+}
+
+void unmapProof(proofMap* map) {
+	if (map->data) {
+		munmap((void*)map->data, map->size);
+	}
+	map->data = NULL;
+	map->size = 0;
+}
+
+//Whether map starts like a container, of any version
+int isContainer(const proofMap* map) {
+	return map->size >= 8 && memcmp(map->data, containerMagic, 4) == 0;
+}
+
+//Whether header is of this version and it and index describe a file of fileBytes bytes with the
+//sections where containerLayout puts them, the index only going forward and ending at the end
+//of the file
+int containerLayoutValid(const containerHeader* header, const uint64_t index[], uint64_t fileBytes) {
+	uint64_t indexEnd = header->indexOffset + sizeof(uint64_t) * ((uint64_t)header->rounds + 1);
+	if (header->version != CONTAINER_VERSION || header->headerBytes != sizeof(containerHeader)
+			|| header->rounds == 0 || header->indexOffset != header->headerBytes || header->reserved2 != 0
+			|| indexEnd > fileBytes || header->publicOffset != indexEnd
+			|| header->publicBytes > fileBytes - header->publicOffset) {
+		return 0;
+	}
+	uint64_t previous = header->publicOffset + header->publicBytes;
+	if (index[0] != containerAlign(previous)) {
+		return 0;
+	}
+	for (uint32_t round = 0; round <= header->rounds; round++) {
+		if (index[round] < previous || index[round] % CONTAINER_ALIGN != 0 || index[round] > fileBytes) {
+			return 0;
+		}
+		previous = index[round];
+	}
+	return previous == fileBytes;
+}
+
+//Whether the bytes bytes at data, padding between sections, are all zero
+static inline int containerZeros(const unsigned char* data, size_t bytes) {
+	for (size_t i = 0; i < bytes; i++) {
+		if (data[i] != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//The header of a container of this version whose sections all lie inside the mapped file, or NULL
+const containerHeader* containerCheck(const proofMap* map) {
+	if (map->size < sizeof(containerHeader) || !isContainer(map)) {
+		return NULL;
+	}
+	const containerHeader* header = (const containerHeader*)map->data;
+	if (header->indexOffset % CONTAINER_ALIGN != 0 || header->indexOffset > map->size
+			|| (map->size - header->indexOffset) / sizeof(uint64_t) <= header->rounds) {
+		return NULL;
+	}
+	const uint64_t* index = (const uint64_t*)(map->data + header->indexOffset);
+	return containerLayoutValid(header, index, map->size) ? header : NULL;
+}
+
+static inline const uint64_t* containerIndex(const proofMap* map, const containerHeader* header) {
+	return (const uint64_t*)(map->data + header->indexOffset);
+}
+
+static inline const void* containerPublic(const proofMap* map, const containerHeader* header) {
+	return map->data + header->publicOffset;
+}
+
+//The opening of round and the bytes up to the next one's, for a header from containerCheck
+static inline const void* containerOpening(const proofMap* map, const containerHeader* header, int round, size_t* bytes) {
+	const uint64_t* index = containerIndex(map, header);
+	*bytes = index[round + 1] - index[round];
+	return map->data + index[round];
+}
+
+#endif /* CONTAINER_H_ */
@@ -0,0 +1,106 @@
+ /*
+ ============================================================================
+ Name        : context.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : The zkboo_ctx behind the library calls
+ ============================================================================
+ */
+
+/*
+ * Included by zkboo.c and by the SHA-1 and SHA-256 halves of the library,
+ * which are built separately, so everything here is static. The working
+ * memory of a call, views included, is one scratch block that only ever
+ * grows, so a context that has made a proof makes the next one without
+ * allocating and without faulting its pages in again.
+ */
+
+#ifndef CONTEXT_H_
+#define CONTEXT_H_
+
+#include <stdlib.h>
+#include <string.h>
+#include "zkboo.h"
+
+#define SCRATCH_ALIGN 64
+
+struct zkboo_ctx {
+	zkboo_allocator allocator;
+	int threads; //0 for the OpenMP default
+	int minRounds; //the fewest rounds a proof needs to verify
+	unsigned char* prefix; //the public prefix a proof needs to verify, see zkboo_ctx_set_prefix
+	size_t prefixLen;
+	int chain; //the hash chain length a proof needs to verify, see zkboo_ctx_set_chain
+	int hmac; //whether a proof needs to be of an HMAC of the prefix to verify, see zkboo_ctx_set_hmac
+	void* scratch;
+	size_t scratchBytes;
+};
+
+static inline void* ctxAlloc(zkboo_ctx* ctx, size_t bytes) {
+	return ctx->allocator.alloc(ctx->allocator.opaque, bytes);
+}
+
+static inline void ctxFree(zkboo_ctx* ctx, void* ptr) {
+	if (ptr) {
+		ctx->allocator.free(ctx->allocator.opaque, ptr);
+	}
+}
+
+//Besides ZKBOO_DEFAULT_ROUNDS, the round count the prove and verify calls get a copy of their
+//body for with the round count a constant, see SPECIALIZED_ROUNDS: the one for 128 bits
+#define ROUNDS_128_BIT 219
+
+//Calls body(..., rounds) with rounds a constant when it is ZKBOO_DEFAULT_ROUNDS or
+//ROUNDS_128_BIT, so that an always_inline body gets a copy for each with its loops over the
+//rounds and the sizes of its per-round arrays fixed at compile time
+#define SPECIALIZED_ROUNDS(rounds, body, ...) \
+	((rounds) == ZKBOO_DEFAULT_ROUNDS ? body(__VA_ARGS__, ZKBOO_DEFAULT_ROUNDS) \
+	: (rounds) == ROUNDS_128_BIT ? body(__VA_ARGS__, ROUNDS_128_BIT) \
+	: body(__VA_ARGS__, rounds))
+
+//The round count params asks for, or -1 if it is out of range
+static inline int paramsRounds(const zkboo_params* params) {
+	int rounds = params && params->rounds ? params->rounds : ZKBOO_DEFAULT_ROUNDS;
+	return rounds >= 1 && rounds <= ZKBOO_MAX_ROUNDS ? rounds : -1;
+}
+
+//At least bytes of working memory, SCRATCH_ALIGN aligned, or NULL. Only valid until the next call.
+static inline void* ctxScratch(zkboo_ctx* ctx, size_t bytes) {
+	if (bytes > ctx->scratchBytes) {
+		ctxFree(ctx, ctx->scratch);
+		ctx->scratchBytes = 0;
+		ctx->scratch = ctxAlloc(ctx, bytes + SCRATCH_ALIGN);
+		if (!ctx->scratch) {
+			return NULL;
+		}
+		ctx->scratchBytes = bytes;
+	}
+	uintptr_t start = ((uintptr_t)ctx->scratch + SCRATCH_ALIGN - 1) & ~(uintptr_t)(SCRATCH_ALIGN - 1);
+	return (void*)start;
+}
+
+//Hands out consecutive SCRATCH_ALIGN aligned pieces of a block: called once with base NULL to
+//add up the bytes needed, then again with the block to get the pieces at the same offsets
+static inline void* scratchPiece(unsigned char* base, size_t* offset, size_t bytes) {
+	void* piece = base ? base + *offset : NULL;
+	*offset += (bytes + SCRATCH_ALIGN - 1) & ~(size_t)(SCRATCH_ALIGN - 1);
+	return piece;
+}
+
+//Makes out at least bytes long, replacing its data if it is too small
+static inline int bufferReserve(zkboo_ctx* ctx, zkboo_buffer* out, size_t bytes) {
+	if (out->capacity < bytes || !out->data) {
+		ctxFree(ctx, out->data);
+		out->capacity = 0;
+		out->size = 0;
+		out->data = ctxAlloc(ctx, bytes);
+		if (!out->data) {
+			return 1;
+		}
+		out->capacity = bytes;
+	}
+	out->size = bytes;
+	return 0;
+}
+
+#endif /* CONTEXT_H_ */
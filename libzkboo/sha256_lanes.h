@@ -0,0 +1,169 @@
+ /*
+ ============================================================================
+ Name        : sha256_lanes.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : Multi-buffer SHA-256 of branch commitments, one view per vector lane
+ ============================================================================
+ */
+
+/*
+ * This file is included once per vector width by the shared.h of the SHA-1
+ * and of the SHA-256 code with SHA_LANES (commitments per vector) and
+ * SHA_TARGET (gcc target string) defined, after View is declared. It
+ * hashes SHA_LANES commitment messages
+ * k || View || r side by side; every message has the same length, so all
+ * lanes walk the same blocks. Blocks that lie entirely inside the View are
+ * read in place, only the first and the padded last ones are assembled.
+ * The digests are bit-identical to hashing the same bytes with OpenSSL.
+ */
+
+#if !defined(SHA_LANES) || !defined(SHA_TARGET)
+#error "sha256_lanes.h needs SHA_LANES and SHA_TARGET"
+#endif
+
+#ifndef SHA256_LANES_COMMON_
+#define SHA256_LANES_COMMON_
+
+//Commitment message k || View || r and its SHA-256 padding
+#define COMMIT_BYTES (16 + sizeof(View) + 4)
+#define COMMIT_BLOCKS ((COMMIT_BYTES + 8) / 64 + 1)
+//First message byte of the blocks that are not entirely View bytes at the end
+#define COMMIT_TAIL_START (((16 + sizeof(View)) / 64) * 64)
+#define COMMIT_TAIL_BYTES (COMMIT_BLOCKS * 64 - COMMIT_TAIL_START)
+
+static const uint32_t sha256IV[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+static const uint32_t sha256K[64] = { 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+		0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98,
+		0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+		0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6,
+		0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3,
+		0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138,
+		0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e,
+		0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+		0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+		0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+		0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814,
+		0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+
+//Builds the first block (k and the start of the View) and the padded tail blocks of a commitment
+static inline void commitMessageEnds(const unsigned char k[16], const View* v, const unsigned char r[4],
+		unsigned char first[64], unsigned char tail[COMMIT_TAIL_BYTES]) {
+	const unsigned char* view = (const unsigned char*)v;
+	uint64_t bits = (uint64_t)COMMIT_BYTES * 8;
+	memcpy(first, k, 16);
+	memcpy(first + 16, view, 48);
+
+	memset(tail, 0, COMMIT_TAIL_BYTES);
+	int viewBytes = 16 + sizeof(View) - COMMIT_TAIL_START;
+	memcpy(tail, view + sizeof(View) - viewBytes, viewBytes);
+	memcpy(tail + viewBytes, r, 4);
+	tail[viewBytes + 4] = 0x80;
+	for (int i = 0; i < 8; i++) {
+		tail[COMMIT_TAIL_BYTES - 1 - i] = bits >> (8 * i);
+	}
+}
+#endif
+
+#define SHA_CAT_(name, n) name##_x##n
+#define SHA_CAT(name, n) SHA_CAT_(name, n)
+#define SHA_FN(name) SHA_CAT(name, SHA_LANES)
+#define SHA_T SHA_FN(sha256Lanes)
+#define SHA_INLINE static inline __attribute__ ((always_inline, target(SHA_TARGET)))
+
+typedef uint32_t SHA_T __attribute__ ((vector_size (SHA_LANES * 4)));
+
+SHA_INLINE SHA_T SHA_FN(rotr)(SHA_T x, int n) {
+	return (x >> n) | (x << (32 - n));
+}
+
+//One SHA-256 block for every lane, block[lane] pointing at that lane's 64 message bytes
+SHA_INLINE void SHA_FN(sha256Block)(SHA_T state[8], const unsigned char* block[SHA_LANES]) {
+	uint32_t words[16][SHA_LANES];
+	for (int lane = 0; lane < SHA_LANES; lane++) {
+		for (int j = 0; j < 16; j++) {
+			uint32_t word;
+			memcpy(&word, block[lane] + 4 * j, 4);
+			words[j][lane] = __builtin_bswap32(word);
+		}
+	}
+	SHA_T w[16];
+	memcpy(w, words, sizeof(w));
+
+	SHA_T a = state[0], b = state[1], c = state[2], d = state[3];
+	SHA_T e = state[4], f = state[5], g = state[6], h = state[7];
+	//Fully unrolled so that every w index is a constant and the schedule stays in registers
+	#pragma GCC unroll 64
+	for (int i = 0; i < 64; i++) {
+		if (i >= 16) {
+			SHA_T w15 = w[(i - 15) & 15], w2 = w[(i - 2) & 15];
+			SHA_T s0 = SHA_FN(rotr)(w15, 7) ^ SHA_FN(rotr)(w15, 18) ^ (w15 >> 3);
+			SHA_T s1 = SHA_FN(rotr)(w2, 17) ^ SHA_FN(rotr)(w2, 19) ^ (w2 >> 10);
+			w[i & 15] += s0 + w[(i - 7) & 15] + s1;
+		}
+		SHA_T s1 = SHA_FN(rotr)(e, 6) ^ SHA_FN(rotr)(e, 11) ^ SHA_FN(rotr)(e, 25);
+		SHA_T ch = (e & f) ^ (~e & g);
+		SHA_T temp1 = h + s1 + ch + sha256K[i] + w[i & 15];
+		SHA_T s0 = SHA_FN(rotr)(a, 2) ^ SHA_FN(rotr)(a, 13) ^ SHA_FN(rotr)(a, 22);
+		SHA_T maj = (a & b) ^ (a & c) ^ (b & c);
+		h = g;
+		g = f;
+		f = e;
+		e = d + temp1;
+		d = c;
+		c = b;
+		b = a;
+		a = temp1 + s0 + maj;
+	}
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+//SHA-256(k[lane] || v[lane] || r[lane]) into hash[lane] for SHA_LANES commitments
+static void __attribute__ ((target(SHA_TARGET))) SHA_FN(commitHashLanes)(const unsigned char* k[], const View* v[], const unsigned char* r[], unsigned char* hash[]) {
+	unsigned char first[SHA_LANES][64];
+	unsigned char tail[SHA_LANES][COMMIT_TAIL_BYTES];
+	const unsigned char* block[SHA_LANES];
+	for (int lane = 0; lane < SHA_LANES; lane++) {
+		commitMessageEnds(k[lane], v[lane], r[lane], first[lane], tail[lane]);
+	}
+
+	SHA_T state[8];
+	for (int i = 0; i < 8; i++) {
+		state[i] = (SHA_T){ 0 } + sha256IV[i];
+	}
+
+	for (int lane = 0; lane < SHA_LANES; lane++) {
+		block[lane] = first[lane];
+	}
+	SHA_FN(sha256Block)(state, block);
+	//Message bytes 64*i to 64*i+63 are View bytes 64*i-16 onwards
+	for (int i = 1; i < COMMIT_TAIL_START / 64; i++) {
+		for (int lane = 0; lane < SHA_LANES; lane++) {
+			block[lane] = (const unsigned char*)v[lane] + 64 * i - 16;
+		}
+		SHA_FN(sha256Block)(state, block);
+	}
+	for (int t = 0; t < COMMIT_TAIL_BYTES; t += 64) {
+		for (int lane = 0; lane < SHA_LANES; lane++) {
+			block[lane] = tail[lane] + t;
+		}
+		SHA_FN(sha256Block)(state, block);
+	}
+
+	for (int lane = 0; lane < SHA_LANES; lane++) {
+		for (int i = 0; i < 8; i++) {
+			uint32_t word = __builtin_bswap32(state[i][lane]);
+			memcpy(hash[lane] + 4 * i, &word, 4);
+		}
+	}
+}
+
+#undef SHA_INLINE
+#undef SHA_T
+#undef SHA_FN
+#undef SHA_CAT
+#undef SHA_CAT_
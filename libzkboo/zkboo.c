@@ -0,0 +1,125 @@
+ /*
+ ============================================================================
+ Name        : zkboo.c
+ Author      : Sobuno
+ Version     : 0.1
+ Description : Contexts and buffers of the library, shared by SHA-1 and SHA-256
+ ============================================================================
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "context.h"
+
+static void* mallocAlloc(void* opaque, size_t bytes) {
+	return malloc(bytes);
+}
+
+static void mallocFree(void* opaque, void* ptr) {
+	free(ptr);
+}
+
+zkboo_ctx* zkboo_ctx_new(const zkboo_allocator* allocator, int threads) {
+	zkboo_allocator chosen = { mallocAlloc, mallocFree, NULL };
+	if (allocator) {
+		chosen = *allocator;
+	}
+	zkboo_ctx* ctx = chosen.alloc(chosen.opaque, sizeof(zkboo_ctx));
+	if (!ctx) {
+		return NULL;
+	}
+	ctx->allocator = chosen;
+	ctx->threads = threads > 0 ? threads : 0;
+	ctx->minRounds = ZKBOO_DEFAULT_ROUNDS;
+	ctx->prefix = NULL;
+	ctx->prefixLen = 0;
+	ctx->chain = 1;
+	ctx->hmac = 0;
+	ctx->scratch = NULL;
+	ctx->scratchBytes = 0;
+	return ctx;
+}
+
+void zkboo_ctx_free(zkboo_ctx* ctx) {
+	if (!ctx) {
+		return;
+	}
+	ctxFree(ctx, ctx->scratch);
+	ctxFree(ctx, ctx->prefix);
+	ctx->allocator.free(ctx->allocator.opaque, ctx);
+}
+
+void zkboo_ctx_set_min_rounds(zkboo_ctx* ctx, int rounds) {
+	ctx->minRounds = rounds < 1 ? 1 : rounds > ZKBOO_MAX_ROUNDS ? ZKBOO_MAX_ROUNDS : rounds;
+}
+
+zkboo_status zkboo_ctx_set_prefix(zkboo_ctx* ctx, const unsigned char* prefix, size_t len) {
+	if (prefix && len > ZKBOO_MAX_PREFIX) {
+		return ZKBOO_BAD_INPUT;
+	}
+	unsigned char* copy = NULL;
+	if (prefix && len > 0) {
+		if (!(copy = ctxAlloc(ctx, len))) {
+			return ZKBOO_NO_MEMORY;
+		}
+		memcpy(copy, prefix, len);
+	}
+	ctxFree(ctx, ctx->prefix);
+	ctx->prefix = copy;
+	ctx->prefixLen = copy ? len : 0;
+	return ZKBOO_OK;
+}
+
+zkboo_status zkboo_ctx_set_chain(zkboo_ctx* ctx, int chain) {
+	if (chain < 0 || chain > ZKBOO_MAX_CHAIN) {
+		return ZKBOO_BAD_INPUT;
+	}
+	ctx->chain = chain > 1 ? chain : 1;
+	return ZKBOO_OK;
+}
+
+void zkboo_ctx_set_hmac(zkboo_ctx* ctx, int hmac) {
+	ctx->hmac = hmac != 0;
+}
+
+void zkboo_buffer_free(zkboo_ctx* ctx, zkboo_buffer* buffer) {
+	ctxFree(ctx, buffer->data);
+	buffer->data = NULL;
+	buffer->size = 0;
+	buffer->capacity = 0;
+}
+
+const char* zkboo_status_string(zkboo_status status) {
+	switch (status) {
+	case ZKBOO_OK: return "ok";
+	case ZKBOO_NOT_VERIFIED: return "not verified";
+	case ZKBOO_BAD_PROOF: return "unrecognised proof file";
+	case ZKBOO_OTHER_CIRCUIT: return "proof for another hash function";
+	case ZKBOO_WRONG_ROUNDS: return "wrong number of rounds";
+	case ZKBOO_BAD_INPUT: return "input too long or unknown parameters";
+	case ZKBOO_UNSUPPORTED: return "not supported for this hash function or input length";
+	case ZKBOO_NO_MEMORY: return "out of memory";
+	case ZKBOO_NO_RANDOMNESS: return "RAND_bytes failed";
+	case ZKBOO_IO_ERROR: return "unable to write the proof";
+	case ZKBOO_CRYPTO_ERROR: return "OpenSSL error";
+	}
+	return "unknown status";
+}
+
+//log2(3/2), the bits of soundness every round adds
+#define BITS_PER_ROUND 0.58496250072115618
+
+int zkboo_rounds_for_soundness(int bits) {
+	if (bits < 1 || bits > ZKBOO_MAX_ROUNDS * BITS_PER_ROUND) {
+		return -1;
+	}
+	int rounds = (int)(bits / BITS_PER_ROUND);
+	if (rounds * BITS_PER_ROUND < bits) {
+		rounds++;
+	}
+	return rounds;
+}
+
+double zkboo_soundness_bits(int rounds) {
+	return rounds * BITS_PER_ROUND;
+}
@@ -0,0 +1,191 @@
+ /*
+ ============================================================================
+ Name        : zkboo.h
+ Author      : Sobuno
+ Version     : 0.1
+ Description : In-process API for proving and verifying SHA-1 and SHA-256
+ ============================================================================
+ */
+
+/*
+ * The provers and verifiers of MPC_SHA1 and MPC_SHA256 as library calls
+ * over memory buffers, so that a service can make and check proofs without
+ * starting a process or touching the disk. build.sh builds libzkboo.a and
+ * libzkboo.so from it; the command line programs are thin wrappers around
+ * the same calls.
+ *
+ * All calls take a zkboo_ctx, which holds the allocator, the thread count
+ * and working memory that is kept from one call to the next, so that
+ * proving again with the same context allocates nothing. A context is used
+ * by one call at a time; calls on different contexts may run concurrently.
+ * Every call runs its rounds on the context's OpenMP threads.
+ *
+ * Proofs are byte-identical to the files the programs write, see
+ * container.h, and the verify calls accept those files read into memory,
+ * including ones in the original headerless format.
+ *
+ * Needs OpenSSL 1.1 or later, which initialises itself and is thread-safe.
+ */
+
+#ifndef ZKBOO_H_
+#define ZKBOO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ZKBOO_API __attribute__ ((visibility ("default")))
+
+#define ZKBOO_DEFAULT_ROUNDS 136 //the ZKBoo paper's choice for 80 bits, (2/3)^136 = 2^-79.6
+#define ZKBOO_MAX_ROUNDS 4096 //the most a proof may have, see container.h
+#define ZKBOO_MAX_INPUT 65536 //bytes of input to SHA-256, proven a 64 byte block at a time
+#define ZKBOO_MAX_BLOCK_INPUT 55 //bytes of input in a single padded block, the most for SHA-1 and compact proofs
+#define ZKBOO_MAX_PREFIX 1048576 //bytes of public prefix, see zkboo_params
+#define ZKBOO_MAX_CHAIN 65536 //times SHA-256 can be applied in a hash chain, see zkboo_params
+
+typedef enum {
+	ZKBOO_OK = 0, //the proof was made, or it verified
+	ZKBOO_NOT_VERIFIED, //a well-formed proof that does not verify, see zkboo_result
+	ZKBOO_BAD_PROOF, //not a proof, or a damaged or truncated one
+	ZKBOO_OTHER_CIRCUIT, //a proof for the other hash function, zkboo_result.circuit says which
+	ZKBOO_WRONG_ROUNDS, //a proof with fewer rounds than the context asks for, or over ZKBOO_MAX_ROUNDS
+	ZKBOO_BAD_INPUT, //input longer than ZKBOO_MAX_INPUT (SHA-1: ZKBOO_MAX_BLOCK_INPUT), prefix longer than ZKBOO_MAX_PREFIX, chain over ZKBOO_MAX_CHAIN, or unknown params or round count
+	ZKBOO_UNSUPPORTED, //params the hash function has no implementation for, such as compact proofs of inputs over ZKBOO_MAX_BLOCK_INPUT
+	ZKBOO_NO_MEMORY,
+	ZKBOO_NO_RANDOMNESS, //RAND_bytes failed
+	ZKBOO_IO_ERROR,
+	ZKBOO_CRYPTO_ERROR //an OpenSSL context or algorithm could not be had, or a call failed
+} zkboo_status;
+
+typedef enum {
+	ZKBOO_SHA1 = 1,
+	ZKBOO_SHA256 = 2
+} zkboo_circuit;
+
+//Tape PRGs and commitment hashes, see backends.h. SHA-1 proofs only use the first of each.
+typedef enum {
+	ZKBOO_PRG_AES_CTR,
+	ZKBOO_PRG_FIXED_AES,
+	ZKBOO_PRG_CHACHA20,
+	ZKBOO_PRG_SHAKE128
+} zkboo_prg;
+
+typedef enum {
+	ZKBOO_HASH_SHA256,
+	ZKBOO_HASH_SHA3_256,
+	ZKBOO_HASH_TREE
+} zkboo_hash;
+
+//How to make a proof. All zero, or a NULL pointer, gives the programs' defaults.
+//
+//A SHA-256 proof can be of H(prefix || input) for a public prefix. The prefix's whole 64 byte
+//blocks are hashed in the clear and the proof starts from their midstate, so only the input
+//and the last prefixLen % 64 bytes of the prefix cost gates. The prefix is stored in the proof
+//and only verifies on a context given the same one, see zkboo_ctx_set_prefix. Compact proofs
+//need prefixLen % 64 + len to fit ZKBOO_MAX_BLOCK_INPUT.
+//
+//chain makes it a proof of a hash chain, SHA-256 applied chain times: H(H(input)) for 2, which
+//is SHA256d. Only the last digest is revealed, the ones in between stay shared inside the
+//circuit. Every application after the first is one more block, and proofs grow with it, but
+//the prover and the streaming verifier hold one block's views at a time. Not for compact
+//proofs. A proof only verifies on a context that expects its chain, see zkboo_ctx_set_chain.
+//
+//hmac makes it a proof of HMAC-SHA256(input, prefix): the input, up to 64 bytes, is the secret
+//key and the prefix the public message, stored in the proof and matched against the context's
+//the same way. The key is shared once and the outer hash checked to use the same shares, so
+//the proof is one block longer than that of the message's inner hash and two more. Full
+//openings only, and no chain. A proof only verifies on a context that expects an HMAC, see
+//zkboo_ctx_set_hmac, and a proof of a plain hash only on one that does not.
+typedef struct {
+	zkboo_prg prg;
+	zkboo_hash hash;
+	int compact; //ZKB++ openings, SHA-256 only
+	int lowMemory; //recompute the opened views instead of keeping them all, SHA-256 only
+	int rounds; //0 for ZKBOO_DEFAULT_ROUNDS, see zkboo_rounds_for_soundness
+	const unsigned char* prefix; //public bytes hashed ahead of the input, SHA-256 only
+	size_t prefixLen;
+	int chain; //times SHA-256 is applied, 0 or 1 for once, up to ZKBOO_MAX_CHAIN, SHA-256 only
+	int hmac; //HMAC-SHA256 keyed by the input of the message in prefix, SHA-256 only
+} zkboo_params;
+
+//Where the context, its working memory and output buffers come from. opaque is passed back.
+typedef struct {
+	void* (*alloc)(void* opaque, size_t bytes);
+	void (*free)(void* opaque, void* ptr);
+	void* opaque;
+} zkboo_allocator;
+
+typedef struct zkboo_ctx zkboo_ctx;
+
+//A proof. A buffer whose capacity is large enough is written to in place, otherwise it is
+//replaced by one from the context's allocator, so reusing a buffer saves the allocation.
+//Start from all zero and give it back with zkboo_buffer_free.
+typedef struct {
+	unsigned char* data;
+	size_t size;
+	size_t capacity;
+} zkboo_buffer;
+
+typedef struct {
+	zkboo_circuit circuit; //also set for ZKBOO_OTHER_CIRCUIT
+	int rounds; //also set for ZKBOO_WRONG_ROUNDS
+	zkboo_params params; //what the proof was made with, lowMemory is always 0, prefix NULL and chain at least 1
+	uint32_t hash[8]; //the hash proven, as words, the last of a hash chain or the HMAC
+	int hashWords; //8 for SHA-256, 5 for SHA-1
+	int failedRound; //ZKBOO_NOT_VERIFIED: the first round that failed, 0 for a compact proof, which fails as a whole
+	const char* reason; //ZKBOO_NOT_VERIFIED: why, failedRound being -1 for a proof of another prefix, HMAC message or chain length
+} zkboo_result;
+
+//allocator NULL means malloc and free, threads 0 the OpenMP default. NULL if out of memory.
+//The context verifies proofs of ZKBOO_DEFAULT_ROUNDS rounds or more.
+ZKBOO_API zkboo_ctx* zkboo_ctx_new(const zkboo_allocator* allocator, int threads);
+ZKBOO_API void zkboo_ctx_free(zkboo_ctx* ctx);
+//The fewest rounds a proof needs to verify on ctx, from 1 to ZKBOO_MAX_ROUNDS
+ZKBOO_API void zkboo_ctx_set_min_rounds(zkboo_ctx* ctx, int rounds);
+//The public prefix, copied, that proofs need to have been made with to verify on ctx. None by
+//default; a NULL prefix goes back to that. ZKBOO_BAD_INPUT if longer than ZKBOO_MAX_PREFIX.
+ZKBOO_API zkboo_status zkboo_ctx_set_prefix(zkboo_ctx* ctx, const unsigned char* prefix, size_t len);
+//The hash chain length, zkboo_params.chain, that proofs need to have been made with to verify
+//on ctx: 0 or 1, the default, for a single hash. ZKBOO_BAD_INPUT if over ZKBOO_MAX_CHAIN.
+ZKBOO_API zkboo_status zkboo_ctx_set_chain(zkboo_ctx* ctx, int chain);
+//Whether proofs need to be of HMAC-SHA256 of the prefix, zkboo_params.hmac, rather than of a
+//hash, to verify on ctx. Not by default.
+ZKBOO_API void zkboo_ctx_set_hmac(zkboo_ctx* ctx, int hmac);
+ZKBOO_API void zkboo_buffer_free(zkboo_ctx* ctx, zkboo_buffer* buffer);
+ZKBOO_API const char* zkboo_status_string(zkboo_status status);
+
+//Proves knowledge of input, len bytes, whose hash (after params->prefix, if any) is public, into out
+ZKBOO_API zkboo_status zkboo_prove_sha256(zkboo_ctx* ctx, const unsigned char* input, size_t len, const zkboo_params* params, zkboo_buffer* out);
+ZKBOO_API zkboo_status zkboo_prove_sha1(zkboo_ctx* ctx, const unsigned char* input, size_t len, const zkboo_params* params, zkboo_buffer* out);
+//The same, written to fd with writev as the proof is made instead of into a buffer. SHA-256
+//inputs of more than ZKBOO_MAX_BLOCK_INPUT bytes need an fd that can seek.
+ZKBOO_API zkboo_status zkboo_prove_sha256_fd(zkboo_ctx* ctx, const unsigned char* input, size_t len, const zkboo_params* params, int fd);
+ZKBOO_API zkboo_status zkboo_prove_sha1_fd(zkboo_ctx* ctx, const unsigned char* input, size_t len, const zkboo_params* params, int fd);
+
+//Verifies the proof of len bytes at proof, which is only read. result may be NULL.
+ZKBOO_API zkboo_status zkboo_verify_sha256(zkboo_ctx* ctx, const void* proof, size_t len, zkboo_result* result);
+ZKBOO_API zkboo_status zkboo_verify_sha1(zkboo_ctx* ctx, const void* proof, size_t len, zkboo_result* result);
+//Verifies a SHA-256 proof while reading it from file, which must end with the proof (stream.h)
+ZKBOO_API zkboo_status zkboo_verify_sha256_stream(zkboo_ctx* ctx, FILE* file, zkboo_result* result);
+
+//Every round lets a cheating prover through with probability 2/3. The fewest rounds that get
+//that down to 2^-bits, or -1 if that is more than ZKBOO_MAX_ROUNDS: 137 for 80 bits, 219 for 128.
+ZKBOO_API int zkboo_rounds_for_soundness(int bits);
+//The soundness of rounds rounds in bits, -log2((2/3)^rounds)
+ZKBOO_API double zkboo_soundness_bits(int rounds);
+
+//Names of the PRGs and hashes as the programs take them, and back. -1 for an unknown name.
+ZKBOO_API const char* zkboo_prg_name(zkboo_prg prg);
+ZKBOO_API const char* zkboo_hash_name(zkboo_hash hash);
+ZKBOO_API int zkboo_prg_by_name(const char* name);
+ZKBOO_API int zkboo_hash_by_name(const char* name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZKBOO_H_ */